@@ -0,0 +1,181 @@
+#include "accumulate.h"
+#include "kernels.h"
+
+namespace linalg::accumulate {
+
+namespace {
+
+using detail::contiguous;
+using detail::lanes;
+using detail::strided;
+
+/// Blocks of this many terms end the recursion of the pairwise summation
+constexpr std::size_t pairwise_block = 256;
+
+/// Call `fn(term, n)` with a term `i -> x_i` using the cheapest access
+template <typename F> auto visit_sum(VectorView x, F &&fn) -> float {
+  if (x.is_contiguous()) {
+	const contiguous a{x.data()};
+	return fn([a](std::size_t i) { return a[i]; }, x.size());
+  }
+  const strided a{x.data(), x.stride()};
+  return fn([a](std::size_t i) { return a[i]; }, x.size());
+}
+
+/// Call `fn(a, b, n)` with accessors to both operands using the cheapest
+/// access
+template <typename F> auto visit_dot(VectorView x, VectorView y, F &&fn) -> float {
+  if (x.is_contiguous() && y.is_contiguous()) {
+	return fn(contiguous{x.data()}, contiguous{y.data()}, x.size());
+  }
+  return fn(strided{x.data(), x.stride()}, strided{y.data(), y.stride()},
+            x.size());
+}
+
+/// Sum the terms in [first, last) in independent float lanes
+template <typename Term>
+auto lane_sum(Term term, std::size_t first, std::size_t last) -> float {
+  float acc[lanes] = {};
+  std::size_t i = first;
+  for (; i + lanes <= last; i += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  acc[l] += term(i + l);
+	}
+  }
+  for (std::size_t l = 0; i < last; ++i, ++l) {
+	acc[l] += term(i);
+  }
+  return detail::reduce_lanes(acc);
+}
+
+/// Sum the terms in [first, last) by recursive halving
+template <typename Term>
+auto pairwise_sum(Term term, std::size_t first, std::size_t last) -> float {
+  const std::size_t n = last - first;
+  if (n <= pairwise_block) {
+	return lane_sum(term, first, last);
+  }
+  // split at a multiple of the block size, so the leaves stay full
+  const std::size_t half = (n / 2 + pairwise_block - 1) / pairwise_block * pairwise_block;
+  return pairwise_sum(term, first, first + half) +
+         pairwise_sum(term, first + half, last);
+}
+
+/// One step of compensated summation: add `v` to `s` and collect the exact
+/// rounding error in `c`. Knuth's two-sum gives the same error as Neumaier's
+/// magnitude test, but without a branch, so the lanes still vectorise.
+inline auto two_sum(float &s, float &c, float v) -> void {
+  const float t = s + v;
+  const float w = t - s;
+  c += (s - (t - w)) + (v - w);
+  s = t;
+}
+
+/// Sum `hi(i) + lo(i)` with compensation in independent lanes. `lo` is the
+/// part of a term which is already known to be an error term, it goes into
+/// the compensation directly.
+template <typename Hi, typename Lo>
+auto compensated_sum(Hi hi, Lo lo, std::size_t n) -> float {
+  float s[lanes] = {};
+  float c[lanes] = {};
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  two_sum(s[l], c[l], hi(i + l));
+	  c[l] += lo(i + l);
+	}
+  }
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+	two_sum(s[l], c[l], hi(i));
+	c[l] += lo(i);
+  }
+
+  float total = 0;
+  float comp = 0;
+  for (std::size_t l = 0; l < lanes; ++l) {
+	two_sum(total, comp, s[l]);
+  }
+  for (std::size_t l = 0; l < lanes; ++l) {
+	two_sum(total, comp, c[l]);
+  }
+  return total + comp;
+}
+
+/// Sum the terms in independent double lanes
+template <typename Term> auto wide_sum(Term term, std::size_t n) -> double {
+  double acc[lanes] = {};
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  acc[l] += term(i + l);
+	}
+  }
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+	acc[l] += term(i);
+  }
+  double result = 0;
+  for (std::size_t l = 0; l < lanes; ++l) {
+	result += acc[l];
+  }
+  return result;
+}
+
+} // namespace
+
+auto fast::sum(VectorView x) -> float {
+  return visit_sum(x, [](auto term, std::size_t n) { return lane_sum(term, 0, n); });
+}
+
+auto fast::dot(VectorView x, VectorView y) -> float {
+  return visit_dot(x, y, [](auto a, auto b, std::size_t n) {
+	return lane_sum([a, b](std::size_t i) { return a[i] * b[i]; }, 0, n);
+  });
+}
+
+auto pairwise::sum(VectorView x) -> float {
+  return visit_sum(x, [](auto term, std::size_t n) { return pairwise_sum(term, 0, n); });
+}
+
+auto pairwise::dot(VectorView x, VectorView y) -> float {
+  return visit_dot(x, y, [](auto a, auto b, std::size_t n) {
+	return pairwise_sum([a, b](std::size_t i) { return a[i] * b[i]; }, 0, n);
+  });
+}
+
+auto compensated::sum(VectorView x) -> float {
+  return visit_sum(x, [](auto term, std::size_t n) {
+	return compensated_sum(term, [](std::size_t) { return 0.f; }, n);
+  });
+}
+
+auto compensated::dot(VectorView x, VectorView y) -> float {
+  // the product of two floats is exact in double, splitting it into the
+  // rounded float product and its remainder makes the products error free
+  return visit_dot(x, y, [](auto a, auto b, std::size_t n) {
+	const auto hi = [a, b](std::size_t i) { return a[i] * b[i]; };
+	const auto lo = [a, b](std::size_t i) {
+	  const double exact = static_cast<double>(a[i]) * static_cast<double>(b[i]);
+	  return static_cast<float>(exact - static_cast<double>(a[i] * b[i]));
+	};
+	return compensated_sum(hi, lo, n);
+  });
+}
+
+auto fp64::sum(VectorView x) -> float {
+  return visit_sum(x, [](auto term, std::size_t n) {
+	return static_cast<float>(wide_sum(
+		[term](std::size_t i) { return static_cast<double>(term(i)); }, n));
+  });
+}
+
+auto fp64::dot(VectorView x, VectorView y) -> float {
+  return visit_dot(x, y, [](auto a, auto b, std::size_t n) {
+	return static_cast<float>(wide_sum(
+		[a, b](std::size_t i) {
+		  return static_cast<double>(a[i]) * static_cast<double>(b[i]);
+		},
+		n));
+  });
+}
+
+} // namespace linalg::accumulate
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cmath>
+#include <stdexcept>
+
+#include "view.h"
+
+namespace linalg {
+
+/*
+ * Accumulation strategies for `sum`, `dot` and `norm`.
+ *
+ * A strategy is a type with static `sum` and `dot` functions and is picked at
+ * compile time, e.g. `linalg::sum<linalg::accumulate::compensated>(x)`, so each
+ * instantiation is a straight loop without any runtime dispatch. The plain
+ * `sum(x)` uses `accumulate::fast`; the plain `dot(x, y)` and `norm(x)` use
+ * `accumulate::fp64`, they always accumulated in double.
+ *
+ * Worst case relative error bounds of the result for n coefficients, u = 2^-24
+ * is the unit roundoff of float and k = sum |x_i| / |sum x_i| the condition
+ * number of the sum (of the products x_i y_i for `dot`). The typical error is
+ * much smaller, about sqrt(n) instead of n for random data:
+ *
+ *   fast         ~ (n / 16) u k      16 independent float lanes, fastest
+ *   pairwise     ~ log2(n) u k       recursive halving down to blocks of 256
+ *   compensated  ~ 2 u + n u^2 k     Kahan-Babuska-Neumaier, in 16 lanes
+ *   fp64         ~ u + n 2^-53 k     float inputs, double accumulators
+ */
+namespace accumulate {
+
+/// Sum in 16 independent float accumulators, which map onto SIMD registers
+struct fast {
+  static auto sum(VectorView x) -> float;
+  static auto dot(VectorView x, VectorView y) -> float;
+};
+
+/// Split the range in halves until blocks of 256 coefficients remain, which
+/// are summed with the `fast` kernel
+struct pairwise {
+  static auto sum(VectorView x) -> float;
+  static auto dot(VectorView x, VectorView y) -> float;
+};
+
+/// Carry the rounding error of every addition along (Kahan-Babuska-Neumaier,
+/// which also handles terms larger than the running sum). Dot products also
+/// carry the rounding error of every product.
+struct compensated {
+  static auto sum(VectorView x) -> float;
+  static auto dot(VectorView x, VectorView y) -> float;
+};
+
+/// Accumulate the float coefficients (and their products) in doubles
+struct fp64 {
+  static auto sum(VectorView x) -> float;
+  static auto dot(VectorView x, VectorView y) -> float;
+};
+
+} // namespace accumulate
+
+/// Return the sum of the coefficients, accumulated with the given strategy
+template <typename Strategy> auto sum(VectorView x) -> float {
+  return Strategy::sum(x);
+}
+
+/// Return the dot product, accumulated with the given strategy
+///
+/// Throw an `std::invalid_argument` exceptions, if the given vector is of a
+/// different size
+template <typename Strategy> auto dot(VectorView x, VectorView y) -> float {
+  if (x.size() != y.size()) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  return Strategy::dot(x, y);
+}
+
+/// Return the euclidean norm, accumulated with the given strategy
+template <typename Strategy> auto norm(VectorView x) -> float {
+  return std::sqrt(Strategy::dot(x, x));
+}
+
+} // namespace linalg
@@ -0,0 +1,693 @@
+/*
+ * Micro benchmarks for the linalg kernels.
+ *
+ * Build the project with -DCMAKE_BUILD_TYPE=Release (and optionally
+ * -DHW06_NATIVE=ON), Debug builds measure the lack of optimization only.
+ *
+ * usage: linalg_bench [--max-size N] [--min-time SECONDS] [--json FILE]
+ *                     [section...]
+ *
+ * Sections: ops, matrix, search, compact, accumulate, sparse, io, statistics.
+ * Without a section all of them run. The "ops" section times every operator
+ * and reduction of `linalg::Vector` from 16 up to `--max-size` (default 10^8)
+ * coefficients against the peak memory bandwidth measured STREAM-style, and
+ * `--json` writes its results to a file.
+ */
+#include "hw06.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+/// Number of calls of the global `operator new` so far
+std::atomic<std::size_t> allocations{0};
+
+} // namespace
+
+// count every heap allocation, to report the allocations per call
+auto operator new(std::size_t size) -> void * {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+	return p;
+  }
+  throw std::bad_alloc{};
+}
+
+auto operator delete(void *p) noexcept -> void {
+  std::free(p);
+}
+
+auto operator delete(void *p, std::size_t) noexcept -> void {
+  std::free(p);
+}
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+/// Keeps results alive, so the compiler can't drop the benchmarked work
+volatile float sink;
+
+/// Minimum time every measurement runs for, set by `--min-time`
+double min_seconds = 0.2;
+
+/// Call `fn` repeatedly for at least `min_seconds`, return the seconds per
+/// call
+template <typename F> auto seconds_per_call(F &&fn) -> double {
+  fn(); // warm up caches and page in memory
+  std::size_t calls = 0;
+  const auto start = bench_clock::now();
+  const auto min_elapsed = std::chrono::duration<double>(min_seconds);
+  auto elapsed = bench_clock::duration{};
+  do {
+	fn();
+	++calls;
+	elapsed = bench_clock::now() - start;
+  } while (elapsed < min_elapsed);
+  return std::chrono::duration<double>(elapsed).count() /
+         static_cast<double>(calls);
+}
+
+/// Fill a container with uniformly distributed values in [-1, 1)
+template <typename C> auto fill_random(C &c, unsigned seed = 42) -> void {
+  std::mt19937 gen{seed};
+  std::uniform_real_distribution<float> dist{-1.f, 1.f};
+  for (auto &v : c) {
+	v = dist(gen);
+  }
+}
+
+/// Peak memory bandwidth in GB/s, measured STREAM-style on arrays far larger
+/// than the caches
+struct Bandwidth {
+  double copy;
+  double triad;
+
+  auto peak() const -> double { return std::max(copy, triad); }
+};
+
+auto measure_bandwidth() -> Bandwidth {
+  // 3 x 128 MB, well beyond any last level cache
+  const std::size_t n = std::size_t{1} << 25;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n, 0.f);
+  const float scalar = 3.f;
+
+  const double copy = seconds_per_call([&] {
+	std::copy(b.begin(), b.end(), c.begin());
+	sink = c[n / 2];
+  });
+  const double triad = seconds_per_call([&] {
+	for (std::size_t i = 0; i < n; ++i) {
+	  a[i] = b[i] + scalar * c[i];
+	}
+	sink = a[n / 2];
+  });
+  // STREAM counts the bytes read and written, without write-allocate traffic
+  return {8 * static_cast<double>(n) / copy * 1e-9,
+          12 * static_cast<double>(n) / triad * 1e-9};
+}
+
+/// The vectors an operation works on. `x` and `y` are never modified,
+/// in-place operations work on `z`.
+struct Operands {
+  linalg::Vector x;
+  linalg::Vector y;
+  linalg::Vector z;
+};
+
+/// One benchmarked operation with its memory traffic and arithmetic per
+/// coefficient
+struct Operation {
+  const char *name;
+  double bytes;
+  double flops;
+  std::function<void(Operands &)> run;
+};
+
+/// Every operator and reduction of `linalg::Vector`. The in-place scalar
+/// operations use neutral values, so `z` neither overflows nor turns
+/// subnormal over many calls.
+auto vector_operations() -> std::vector<Operation> {
+  using linalg::Vector;
+  return {
+	  {"z = s", 4, 0, [](Operands &o) { o.z = 1.f; }},
+	  {"z += s", 8, 1, [](Operands &o) { o.z += 0.f; }},
+	  {"z -= s", 8, 1, [](Operands &o) { o.z -= 0.f; }},
+	  {"z *= s", 8, 1, [](Operands &o) { o.z *= 1.f; }},
+	  {"z /= s", 8, 1, [](Operands &o) { o.z /= 1.f; }},
+	  {"z += y", 12, 1, [](Operands &o) { o.z += o.y; }},
+	  {"z -= y", 12, 1, [](Operands &o) { o.z -= o.y; }},
+	  {"+x", 8, 0, [](Operands &o) { sink = (+o.x)[0]; }},
+	  {"-x", 8, 1, [](Operands &o) { sink = (-o.x)[0]; }},
+	  {"x + y", 12, 1, [](Operands &o) { sink = (o.x + o.y)[0]; }},
+	  {"x - y", 12, 1, [](Operands &o) { sink = (o.x - o.y)[0]; }},
+	  {"x + s", 8, 1, [](Operands &o) { sink = (o.x + 2.f)[0]; }},
+	  {"x - s", 8, 1, [](Operands &o) { sink = (o.x - 2.f)[0]; }},
+	  {"x * s", 8, 1, [](Operands &o) { sink = (o.x * 2.f)[0]; }},
+	  {"x / s", 8, 1, [](Operands &o) { sink = (o.x / 2.f)[0]; }},
+	  {"s + x", 8, 1, [](Operands &o) { sink = (2.f + o.x)[0]; }},
+	  {"s - x", 8, 1, [](Operands &o) { sink = (2.f - o.x)[0]; }},
+	  {"s * x", 8, 1, [](Operands &o) { sink = (2.f * o.x)[0]; }},
+	  {"floor", 8, 1, [](Operands &o) { sink = linalg::floor(o.x)[0]; }},
+	  {"ceil", 8, 1, [](Operands &o) { sink = linalg::ceil(o.x)[0]; }},
+	  {"normalize", 12, 3, [](Operands &o) { linalg::normalize(o.z); }},
+	  {"normalized", 12, 3, [](Operands &o) { sink = linalg::normalized(o.x)[0]; }},
+	  {"min", 4, 1, [](Operands &o) { sink = linalg::min(o.x); }},
+	  {"max", 4, 1, [](Operands &o) { sink = linalg::max(o.x); }},
+	  {"argmin", 4, 1,
+	   [](Operands &o) { sink = static_cast<float>(linalg::argmin(o.x)); }},
+	  {"argmax", 4, 1,
+	   [](Operands &o) { sink = static_cast<float>(linalg::argmax(o.x)); }},
+	  {"non_zeros", 4, 1,
+	   [](Operands &o) { sink = static_cast<float>(linalg::non_zeros(o.x)); }},
+	  {"sum", 4, 1, [](Operands &o) { sink = linalg::sum(o.x); }},
+	  {"prod", 4, 1, [](Operands &o) { sink = linalg::prod(o.x); }},
+	  {"dot", 8, 2, [](Operands &o) { sink = linalg::dot(o.x, o.y); }},
+	  {"norm", 4, 2, [](Operands &o) { sink = linalg::norm(o.x); }},
+	  {"statistics", 4, 8,
+	   [](Operands &o) { sink = linalg::statistics(o.x).variance; }},
+  };
+}
+
+/// Sizes of the "ops" section, up to `max_size`
+auto suite_sizes(std::size_t max_size) -> std::vector<std::size_t> {
+  std::vector<std::size_t> sizes;
+  for (std::size_t n : {std::size_t{16}, std::size_t{256}, std::size_t{4096},
+                        std::size_t{65536}, std::size_t{1} << 20,
+                        std::size_t{10'000'000}, std::size_t{100'000'000}}) {
+	if (n <= max_size) {
+	  sizes.push_back(n);
+	}
+  }
+  return sizes;
+}
+
+auto bench_ops(std::size_t max_size, const char *json_path) -> void {
+  std::printf("== vector operations ==\n");
+  const Bandwidth bandwidth = measure_bandwidth();
+  std::printf("peak bandwidth: copy %.2f GB/s, triad %.2f GB/s\n",
+              bandwidth.copy, bandwidth.triad);
+
+  std::FILE *json = nullptr;
+  if (json_path != nullptr) {
+	json = std::fopen(json_path, "w");
+	if (json == nullptr) {
+	  std::fprintf(stderr, "cannot write %s\n", json_path);
+	  return;
+	}
+	std::fprintf(json,
+	             "{\n  \"bandwidth\": {\"copy_gbs\": %.4g, \"triad_gbs\": %.4g},\n"
+	             "  \"results\": [",
+	             bandwidth.copy, bandwidth.triad);
+  }
+
+  const auto operations = vector_operations();
+  bool first_result = true;
+  for (const std::size_t n : suite_sizes(max_size)) {
+	Operands operands{linalg::Vector(n), linalg::Vector(n), linalg::Vector(n)};
+	fill_random(operands.x, 11);
+	fill_random(operands.y, 12);
+	fill_random(operands.z, 13);
+
+	std::printf("n = %zu\n", n);
+	std::printf("%-12s %12s %10s %10s %8s %8s\n", "op", "us/call", "GB/s",
+	            "GFLOP/s", "% peak", "allocs");
+	for (const auto &op : operations) {
+	  const double seconds = seconds_per_call([&] { op.run(operands); });
+	  const std::size_t before = allocations.load();
+	  op.run(operands);
+	  const std::size_t allocs = allocations.load() - before;
+
+	  const double gbs = op.bytes * static_cast<double>(n) / seconds * 1e-9;
+	  const double gflops = op.flops * static_cast<double>(n) / seconds * 1e-9;
+	  const double fraction = gbs / bandwidth.peak();
+	  std::printf("%-12s %12.3f %10.2f %10.2f %7.0f%% %8zu\n", op.name,
+	              seconds * 1e6, gbs, gflops, fraction * 100, allocs);
+	  if (json != nullptr) {
+		std::fprintf(json,
+		             "%s\n    {\"op\": \"%s\", \"n\": %zu, \"seconds\": %.6g, "
+		             "\"gbs\": %.4g, \"gflops\": %.4g, \"peak_fraction\": %.4g, "
+		             "\"allocations\": %zu}",
+		             first_result ? "" : ",", op.name, n, seconds, gbs, gflops,
+		             fraction, allocs);
+		first_result = false;
+	  }
+	}
+  }
+
+  if (json != nullptr) {
+	std::fprintf(json, "\n  ]\n}\n");
+	std::fclose(json);
+  }
+}
+
+/// Textbook `y = a * x` with one dot product per row
+auto naive_gemv(const linalg::Matrix &a, const linalg::Vector &x,
+                linalg::Vector &y) -> void {
+  for (std::size_t r = 0; r < a.rows(); ++r) {
+	float acc = 0;
+	for (std::size_t c = 0; c < a.cols(); ++c) {
+	  acc += a(r, c) * x[static_cast<int>(c)];
+	}
+	y[static_cast<int>(r)] = acc;
+  }
+}
+
+/// Textbook `c = a * b` as triple loop in i-j-p order
+auto naive_gemm(const linalg::Matrix &a, const linalg::Matrix &b,
+                linalg::Matrix &c) -> void {
+  for (std::size_t i = 0; i < a.rows(); ++i) {
+	for (std::size_t j = 0; j < b.cols(); ++j) {
+	  float acc = 0;
+	  for (std::size_t p = 0; p < a.cols(); ++p) {
+		acc += a(i, p) * b(p, j);
+	  }
+	  c(i, j) = acc;
+	}
+  }
+}
+
+auto bench_matrix() -> void {
+  std::printf("== matrix ==\n");
+  std::printf("%-10s %8s %12s %12s %12s %8s\n", "kernel", "n", "footprint",
+              "naive GF/s", "linalg GF/s", "speedup");
+
+  // square matrices from L1 resident (16 KiB) to DRAM resident (256 MiB)
+  for (std::size_t n : {64, 256, 1024, 4096, 8192}) {
+	linalg::Matrix a(n, n);
+	linalg::Vector x(n);
+	linalg::Vector y(n);
+	fill_random(a);
+	fill_random(x);
+
+	const double flops = 2.0 * static_cast<double>(n * n);
+	const double naive = seconds_per_call([&] {
+	  naive_gemv(a, x, y);
+	  sink = y[0];
+	});
+	const double fast = seconds_per_call([&] {
+	  linalg::gemv(1.f, a, x, 0.f, y);
+	  sink = y[0];
+	});
+	std::printf("%-10s %8zu %10.1f K %12.2f %12.2f %7.2fx\n", "gemv", n,
+	            static_cast<double>(a.size() * sizeof(float)) / 1024.,
+	            flops / naive * 1e-9, flops / fast * 1e-9, naive / fast);
+  }
+
+  for (std::size_t n : {32, 128, 512, 1024}) {
+	linalg::Matrix a(n, n);
+	linalg::Matrix b(n, n);
+	linalg::Matrix c(n, n);
+	fill_random(a, 1);
+	fill_random(b, 2);
+
+	const double flops = 2.0 * static_cast<double>(n * n * n);
+	const double naive = seconds_per_call([&] {
+	  naive_gemm(a, b, c);
+	  sink = c(0, 0);
+	});
+	const double fast = seconds_per_call([&] {
+	  linalg::gemm(1.f, a, b, 0.f, c);
+	  sink = c(0, 0);
+	});
+	std::printf("%-10s %8zu %10.1f K %12.2f %12.2f %7.2fx\n", "gemm", n,
+	            static_cast<double>(3 * a.size() * sizeof(float)) / 1024.,
+	            flops / naive * 1e-9, flops / fast * 1e-9, naive / fast);
+  }
+
+  for (std::size_t n : {256, 1024, 4096}) {
+	linalg::Matrix a(n, n);
+	fill_random(a);
+	const double bytes = 2.0 * static_cast<double>(a.size() * sizeof(float));
+	const double fast = seconds_per_call([&] {
+	  auto t = linalg::transpose(a);
+	  sink = t(0, 0);
+	});
+	std::printf("%-10s %8zu %10.1f K %12s %9.2f GB/s\n", "transpose", n,
+	            static_cast<double>(a.size() * sizeof(float)) / 1024., "-",
+	            bytes / fast * 1e-9);
+  }
+}
+
+auto bench_search() -> void {
+  constexpr std::size_t count = 1'000'000;
+  constexpr std::size_t dim = 64;
+  constexpr std::size_t k = 10;
+  std::printf("== search (%zu vectors, dim %zu, top %zu) ==\n", count, dim, k);
+
+  std::mt19937 gen{7};
+  std::uniform_real_distribution<float> dist{-1.f, 1.f};
+  std::vector<linalg::Vector> vectors;
+  vectors.reserve(count);
+  linalg::VectorCollection collection{dim};
+  collection.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+	linalg::Vector v(dim);
+	for (auto &c : v) {
+	  c = dist(gen);
+	}
+	collection.push_back(v);
+	vectors.push_back(std::move(v));
+  }
+  linalg::Vector query(dim);
+  fill_random(query, 9);
+
+  // one dot call per stored vector and a full sort of all scores
+  const double naive = seconds_per_call([&] {
+	std::vector<linalg::Match> all;
+	all.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+	  all.push_back({i, linalg::dot(query, vectors[i])});
+	}
+	std::sort(all.begin(), all.end(), [](const auto &a, const auto &b) {
+	  return a.score > b.score;
+	});
+	sink = all[k - 1].score;
+  });
+  std::printf("%-28s %10.1f queries/s\n", "naive dot + sort", 1. / naive);
+
+  for (unsigned threads : {1u, 0u}) {
+	for (auto similarity : {linalg::Similarity::dot, linalg::Similarity::cosine}) {
+	  const double fast = seconds_per_call([&] {
+		sink = collection.top_k(query, k, similarity, threads)[k - 1].score;
+	  });
+	  std::printf("%-6s top_k, %3s threads %10.1f queries/s %7.2fx\n",
+	              similarity == linalg::Similarity::dot ? "dot" : "cosine",
+	              threads == 0 ? "all" : "1", 1. / fast, naive / fast);
+	}
+  }
+}
+
+/// Return `|approx - exact| / |exact|`
+auto relative_error(double approx, double exact) -> double {
+  return std::abs(approx - exact) / std::abs(exact);
+}
+
+template <typename Format>
+auto bench_compact_format(const char *name, const linalg::Vector &x,
+                          const linalg::Vector &y, double exact, double base)
+    -> void {
+  const linalg::CompactVector<Format> cx{x};
+  const linalg::CompactVector<Format> cy{y};
+  const double n = static_cast<double>(x.size());
+
+  const double mixed = seconds_per_call([&] { sink = linalg::dot(cx, y); });
+  std::printf("%-16s %10.2e %10.2f %10.2f %8.2fx\n",
+              (std::string{name} + " x f32").c_str(),
+              relative_error(linalg::dot(cx, y), exact),
+              (static_cast<double>(cx.bytes()) + 4 * n) / mixed * 1e-9,
+              mixed / n * 1e9, base / mixed);
+
+  const double both = seconds_per_call([&] { sink = linalg::dot(cx, cy); });
+  std::printf("%-16s %10.2e %10.2f %10.2f %8.2fx\n",
+              (std::string{name} + " x " + name).c_str(),
+              relative_error(linalg::dot(cx, cy), exact),
+              2 * static_cast<double>(cx.bytes()) / both * 1e-9,
+              both / n * 1e9, base / both);
+}
+
+auto bench_compact() -> void {
+  std::printf("== compact storage ==\n");
+  for (std::size_t n : {1'000'000, 10'000'000}) {
+	linalg::Vector x(n);
+	linalg::Vector y(n);
+	fill_random(x, 3);
+	fill_random(y, 4);
+	double exact = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+	  exact += static_cast<double>(x.data()[i]) * static_cast<double>(y.data()[i]);
+	}
+
+	std::printf("n = %zu\n", n);
+	std::printf("%-16s %10s %10s %10s %9s\n", "dot", "rel. err", "GB/s",
+	            "ns/elem", "speedup");
+	const double base = seconds_per_call([&] { sink = linalg::dot(x, y); });
+	std::printf("%-16s %10.2e %10.2f %10.2f %8.2fx\n", "f32 x f32",
+	            relative_error(linalg::dot(x, y), exact),
+	            8 * static_cast<double>(n) / base * 1e-9,
+	            base / static_cast<double>(n) * 1e9, 1.0);
+	bench_compact_format<linalg::bf16>("bf16", x, y, exact, base);
+	bench_compact_format<linalg::fp16>("fp16", x, y, exact, base);
+	bench_compact_format<linalg::int8>("int8", x, y, exact, base);
+  }
+}
+
+/// Print one accumulation strategy: its relative errors against a long double
+/// reference and the throughput of `sum` and `dot`
+template <typename Strategy>
+auto bench_strategy(const char *name, const linalg::Vector &x,
+                    const linalg::Vector &y, long double exact_sum,
+                    long double exact_dot) -> void {
+  const double n = static_cast<double>(x.size());
+  const double sum_time = seconds_per_call([&] { sink = linalg::sum<Strategy>(x); });
+  const double dot_time = seconds_per_call([&] { sink = linalg::dot<Strategy>(x, y); });
+  std::printf("%-12s %12.2e %10.2f %12.2e %10.2f\n", name,
+              relative_error(linalg::sum<Strategy>(x), static_cast<double>(exact_sum)),
+              4 * n / sum_time * 1e-9,
+              relative_error(linalg::dot<Strategy>(x, y), static_cast<double>(exact_dot)),
+              8 * n / dot_time * 1e-9);
+}
+
+auto bench_accumulate() -> void {
+  std::printf("== accumulation strategies ==\n");
+  // positive values, so the sums grow large and rounding errors pile up
+  const std::size_t n = 10'000'000;
+  linalg::Vector x(n);
+  linalg::Vector y(n);
+  fill_random(x, 5);
+  fill_random(y, 6);
+  long double exact_sum = 0;
+  long double exact_dot = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+	x.data()[i] = std::abs(x.data()[i]);
+	y.data()[i] = std::abs(y.data()[i]);
+	exact_sum += x.data()[i];
+	exact_dot += static_cast<long double>(x.data()[i]) * y.data()[i];
+  }
+
+  std::printf("n = %zu\n", n);
+  std::printf("%-12s %12s %10s %12s %10s\n", "strategy", "sum rel. err",
+              "sum GB/s", "dot rel. err", "dot GB/s");
+
+  // the baseline: one running float, as a plain loop would do
+  const auto sequential = [&] {
+	float acc = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+	  acc += x.data()[i];
+	}
+	return acc;
+  };
+  const double seq_time = seconds_per_call([&] { sink = sequential(); });
+  std::printf("%-12s %12.2e %10.2f %12s %10s\n", "sequential",
+              relative_error(sequential(), static_cast<double>(exact_sum)),
+              4 * static_cast<double>(n) / seq_time * 1e-9, "-", "-");
+
+  bench_strategy<linalg::accumulate::fast>("fast", x, y, exact_sum, exact_dot);
+  bench_strategy<linalg::accumulate::pairwise>("pairwise", x, y, exact_sum, exact_dot);
+  bench_strategy<linalg::accumulate::compensated>("compensated", x, y, exact_sum, exact_dot);
+  bench_strategy<linalg::accumulate::fp64>("fp64", x, y, exact_sum, exact_dot);
+}
+
+/// Return a random vector of size `n` with about `density * n` non-zeros
+auto random_sparse(std::size_t n, double density, unsigned seed) -> linalg::Vector {
+  std::mt19937 gen{seed};
+  std::uniform_real_distribution<float> dist{-1.f, 1.f};
+  std::bernoulli_distribution keep{density};
+  linalg::Vector x(n, 0.f);
+  for (std::size_t i = 0; i < n; ++i) {
+	if (keep(gen)) {
+	  x.data()[i] = dist(gen);
+	}
+  }
+  return x;
+}
+
+auto bench_sparse() -> void {
+  std::printf("== sparse vectors ==\n");
+  std::printf("%10s %8s %10s %10s %12s %12s %12s\n", "n", "density",
+              "dense MB", "sparse MB", "dense us", "sp x dn us", "sp x sp us");
+  for (std::size_t n : {100'000, 10'000'000}) {
+	for (double density : {0.01, 0.05, 0.2}) {
+	  const auto x = random_sparse(n, density, 7);
+	  const auto y = random_sparse(n, density, 8);
+	  const linalg::SparseVector sx{x};
+	  const linalg::SparseVector sy{y};
+
+	  const double dense = seconds_per_call([&] { sink = linalg::dot(x, y); });
+	  const double mixed = seconds_per_call([&] { sink = linalg::dot(sx, y); });
+	  const double sparse = seconds_per_call([&] { sink = linalg::dot(sx, sy); });
+	  std::printf("%10zu %8.2f %10.2f %10.2f %12.1f %12.1f %12.1f\n", n, density,
+	              4 * static_cast<double>(n) * 1e-6,
+	              static_cast<double>(sx.bytes()) * 1e-6, dense * 1e6,
+	              mixed * 1e6, sparse * 1e6);
+	}
+  }
+}
+
+auto bench_io() -> void {
+  std::printf("== binary files ==\n");
+  const std::size_t rows = 100'000;
+  const std::size_t dim = 128;
+  const auto dir = std::filesystem::temp_directory_path();
+  const auto text_path = dir / "linalg_bench.txt";
+  const auto bin_path = dir / "linalg_bench.bin";
+
+  {
+	std::vector<float> row(dim);
+	std::ofstream text{text_path};
+	linalg::VectorWriter writer{bin_path, dim};
+	for (std::size_t r = 0; r < rows; ++r) {
+	  fill_random(row, static_cast<unsigned>(r));
+	  for (const float v : row) {
+		text << v << ' ';
+	  }
+	  text << '\n';
+	  writer.write(linalg::VectorView{row});
+	}
+  }
+  std::printf("%zu x %zu floats, %.1f MB\n", rows, dim,
+              static_cast<double>(rows * dim * sizeof(float)) * 1e-6);
+  std::printf("%-22s %10s\n", "load", "ms");
+
+  const auto once = [](auto &&fn) {
+	const auto start = bench_clock::now();
+	fn();
+	return std::chrono::duration<double>(bench_clock::now() - start).count();
+  };
+  const double parse = once([&] {
+	std::ifstream text{text_path};
+	linalg::VectorCollection c{dim};
+	c.reserve(rows);
+	linalg::Vector row(dim);
+	for (std::size_t r = 0; r < rows; ++r) {
+	  for (auto &v : row) {
+		text >> v;
+	  }
+	  c.push_back(row);
+	}
+	sink = c.coeff(rows - 1, 0);
+  });
+  std::printf("%-22s %10.1f\n", "parse text", parse * 1e3);
+
+  const double read = once([&] {
+	sink = linalg::read_collection(bin_path).coeff(rows - 1, 0);
+  });
+  std::printf("%-22s %10.1f\n", "read_collection", read * 1e3);
+
+  const double open = once([&] {
+	const linalg::MappedVectors mapped{bin_path};
+	sink = mapped[rows - 1][0];
+  });
+  std::printf("%-22s %10.1f\n", "mmap, one row", open * 1e3);
+
+  const double scan = once([&] {
+	const linalg::MappedVectors mapped{bin_path};
+	sink = linalg::sum(mapped.data());
+  });
+  std::printf("%-22s %10.1f\n", "mmap, sum of all rows", scan * 1e3);
+
+  std::filesystem::remove(text_path);
+  std::filesystem::remove(bin_path);
+}
+
+auto bench_statistics() -> void {
+  std::printf("== fused statistics ==\n");
+  std::printf("%10s %14s %14s %8s %14s %14s %8s\n", "n", "separate ms",
+              "fused ms", "speedup", "to_range ms", "minmax ms", "speedup");
+  for (std::size_t n : {10'000, 1'000'000, 10'000'000}) {
+	linalg::Vector x(n);
+	fill_random(x, 9);
+
+	const double separate = seconds_per_call([&] {
+	  sink = linalg::min(x) + linalg::max(x) +
+	         static_cast<float>(linalg::argmin(x) + linalg::argmax(x)) +
+	         linalg::sum(x) + linalg::dot(x, x) +
+	         static_cast<float>(linalg::non_zeros(x));
+	});
+	const double fused = seconds_per_call([&] { sink = linalg::statistics(x).variance; });
+
+	// the previous normalize_to_range of run.cpp against a copy scaled in place
+	const double to_range = seconds_per_call([&] {
+	  const auto xmin = linalg::min(x);
+	  const auto xmax = linalg::max(x);
+	  sink = ((x - xmin) / (xmax - xmin))[0];
+	});
+	const double scaled = seconds_per_call([&] {
+	  auto y = x;
+	  linalg::minmax_scale(y);
+	  sink = y[0];
+	});
+	std::printf("%10zu %14.3f %14.3f %7.2fx %14.3f %14.3f %7.2fx\n", n,
+	            separate * 1e3, fused * 1e3, separate / fused, to_range * 1e3,
+	            scaled * 1e3, to_range / scaled);
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::size_t max_size = 100'000'000;
+  const char *json_path = nullptr;
+  std::vector<std::string_view> sections;
+  for (int i = 1; i < argc; ++i) {
+	const std::string_view arg = argv[i];
+	if ((arg == "--max-size" || arg == "--min-time" || arg == "--json") && i + 1 == argc) {
+	  std::fprintf(stderr, "%s needs a value\n", argv[i]);
+	  return 1;
+	}
+	if (arg == "--max-size") {
+	  max_size = static_cast<std::size_t>(std::strtod(argv[++i], nullptr));
+	} else if (arg == "--min-time") {
+	  min_seconds = std::strtod(argv[++i], nullptr);
+	} else if (arg == "--json") {
+	  json_path = argv[++i];
+	} else {
+	  sections.push_back(arg);
+	}
+  }
+  const auto wanted = [&](std::string_view section) {
+	return sections.empty() ||
+	       std::find(sections.begin(), sections.end(), section) != sections.end();
+  };
+
+  if (wanted("ops")) {
+	bench_ops(max_size, json_path);
+  }
+  if (wanted("matrix")) {
+	bench_matrix();
+  }
+  if (wanted("search")) {
+	bench_search();
+  }
+  if (wanted("compact")) {
+	bench_compact();
+  }
+  if (wanted("accumulate")) {
+	bench_accumulate();
+  }
+  if (wanted("sparse")) {
+	bench_sparse();
+  }
+  if (wanted("io")) {
+	bench_io();
+  }
+  if (wanted("statistics")) {
+	bench_statistics();
+  }
+  return 0;
+}
@@ -0,0 +1,243 @@
+#include "collection.h"
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace linalg {
+
+namespace {
+
+/// Fewer blocks than this per thread are not worth starting a thread for
+constexpr std::size_t min_blocks_per_thread = 256;
+
+/// Order matches best first, ties broken by the smaller index. NaN scores are
+/// the worst, so the heaps and sorts get a strict weak ordering
+auto better(const Match &a, const Match &b) -> bool {
+  const bool a_nan = std::isnan(a.score);
+  const bool b_nan = std::isnan(b.score);
+  if (a_nan != b_nan) {
+	return b_nan;
+  }
+  if (!a_nan && a.score != b.score) {
+	return a.score > b.score;
+  }
+  return a.index < b.index;
+}
+
+/// Gather the query into a contiguous buffer and compute its scale factor
+auto prepare_query(VectorView query, Similarity similarity,
+                   std::vector<float> &buffer) -> float {
+  buffer.assign(query.begin(), query.end());
+  if (similarity != Similarity::cosine) {
+	return 1.f;
+  }
+  const float n = std::sqrt(detail::dot(buffer.data(), buffer.data(), buffer.size()));
+  return n == 0.f ? 0.f : 1.f / n;
+}
+
+/// Split `blocks` into at most `threads` ranges and call `fn(first, last, t)`
+/// for every range, on its own thread if there is more than one
+template <typename F>
+auto parallel_blocks(std::size_t blocks, unsigned threads, F &&fn) -> void {
+  std::size_t workers = threads == 0 ? std::thread::hardware_concurrency() : threads;
+  workers = std::clamp<std::size_t>(workers, 1,
+                                    std::max<std::size_t>(1, blocks / min_blocks_per_thread));
+  if (workers == 1) {
+	fn(std::size_t{0}, blocks, std::size_t{0});
+	return;
+  }
+
+  std::vector<std::thread> pool;
+  pool.reserve(workers);
+  const std::size_t chunk = (blocks + workers - 1) / workers;
+  for (std::size_t t = 0; t < workers; ++t) {
+	const std::size_t first = std::min(t * chunk, blocks);
+	const std::size_t last = std::min(first + chunk, blocks);
+	pool.emplace_back([&fn, first, last, t] { fn(first, last, t); });
+  }
+  for (auto &thread : pool) {
+	thread.join();
+  }
+}
+
+/// Score one block of `block_width` vectors against a contiguous query, the
+/// cosine normalization is fused into the final scaling
+auto score_block(const float *block, const float *query, std::size_t dim,
+                 const float *inv_norms, float query_scale,
+                 Similarity similarity,
+                 float (&out)[VectorCollection::block_width]) -> void {
+  constexpr std::size_t width = VectorCollection::block_width;
+  float acc[width] = {};
+  for (std::size_t d = 0; d < dim; ++d) {
+	const float q = query[d];
+	const float *coeffs = block + d * width;
+	for (std::size_t l = 0; l < width; ++l) {
+	  acc[l] += q * coeffs[l];
+	}
+  }
+  if (similarity == Similarity::cosine) {
+	for (std::size_t l = 0; l < width; ++l) {
+	  acc[l] *= inv_norms[l] * query_scale;
+	}
+  }
+  std::copy(acc, acc + width, out);
+}
+
+} // namespace
+
+auto operator<<(std::ostream &ostr, const Match &m) -> std::ostream & {
+  return ostr << "(" << m.index << ": " << m.score << ")";
+}
+
+/// Construct an empty collection for vectors of dimension `dim`
+VectorCollection::VectorCollection(std::size_t dim) : dim_{dim} {}
+
+/// Return the dimension of the stored vectors
+auto VectorCollection::dim() const -> std::size_t {
+  return dim_;
+}
+
+/// Return the number of stored vectors
+auto VectorCollection::size() const -> std::size_t {
+  return size_;
+}
+
+/// Make room for `n` vectors without reallocating
+auto VectorCollection::reserve(std::size_t n) -> void {
+  const std::size_t blocks = (n + block_width - 1) / block_width;
+  data_.reserve(blocks * block_width * dim_);
+  inv_norms_.reserve(blocks * block_width);
+}
+
+/// Append a copy of `x` to the collection
+auto VectorCollection::push_back(VectorView x) -> void {
+  if (x.size() != dim_) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+
+  const std::size_t lane = size_ % block_width;
+  if (lane == 0) {
+	// open a new, zero padded block
+	data_.resize(data_.size() + block_width * dim_, 0.f);
+	inv_norms_.resize(inv_norms_.size() + block_width, 0.f);
+  }
+
+  float *block = data_.data() + (size_ / block_width) * block_width * dim_;
+  float squares = 0;
+  auto it = x.begin();
+  for (std::size_t d = 0; d < dim_; ++d, ++it) {
+	block[d * block_width + lane] = *it;
+	squares += *it * *it;
+  }
+  inv_norms_[size_] = squares == 0.f ? 0.f : 1.f / std::sqrt(squares);
+  ++size_;
+}
+
+/// Return a copy of the idx-th vector
+auto VectorCollection::operator[](std::size_t idx) const -> Vector {
+  if (idx >= size_) {
+	throw std::out_of_range("Index out of range");
+  }
+  Vector result(dim_);
+  for (std::size_t d = 0; d < dim_; ++d) {
+	result[static_cast<int>(d)] = coeff(idx, d);
+  }
+  return result;
+}
+
+/// Return coefficient `d` of vector `idx`. No bounds checking.
+auto VectorCollection::coeff(std::size_t idx, std::size_t d) const -> float {
+  return data_[(idx / block_width) * block_width * dim_ + d * block_width +
+               idx % block_width];
+}
+
+/// Return the euclidean norm of vector `idx`
+auto VectorCollection::norm(std::size_t idx) const -> float {
+  if (idx >= size_) {
+	throw std::out_of_range("Index out of range");
+  }
+  return inv_norms_[idx] == 0.f ? 0.f : 1.f / inv_norms_[idx];
+}
+
+/// Return the similarity of `query` to every stored vector
+auto VectorCollection::scores(VectorView query, Similarity similarity,
+                              unsigned threads) const -> Vector {
+  if (query.size() != dim_) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  std::vector<float> q;
+  const float query_scale = prepare_query(query, similarity, q);
+
+  Vector result(size_);
+  float *out = result.data();
+  const std::size_t blocks = (size_ + block_width - 1) / block_width;
+  parallel_blocks(blocks, threads, [&](std::size_t first, std::size_t last, std::size_t) {
+	for (std::size_t b = first; b < last; ++b) {
+	  float block_scores[block_width];
+	  score_block(data_.data() + b * block_width * dim_, q.data(), dim_,
+	              inv_norms_.data() + b * block_width, query_scale, similarity,
+	              block_scores);
+	  const std::size_t n = std::min(block_width, size_ - b * block_width);
+	  std::copy(block_scores, block_scores + n, out + b * block_width);
+	}
+  });
+  return result;
+}
+
+/// Return the `k` vectors most similar to `query`, best match first
+auto VectorCollection::top_k(VectorView query, std::size_t k,
+                             Similarity similarity, unsigned threads) const
+    -> std::vector<Match> {
+  if (query.size() != dim_) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  k = std::min(k, size_);
+  if (k == 0) {
+	return {};
+  }
+  std::vector<float> q;
+  const float query_scale = prepare_query(query, similarity, q);
+
+  // one bounded heap per thread, the worst kept candidate is on top
+  const std::size_t blocks = (size_ + block_width - 1) / block_width;
+  const std::size_t max_workers =
+	  threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+  std::vector<std::vector<Match>> heaps(max_workers);
+
+  parallel_blocks(blocks, threads, [&](std::size_t first, std::size_t last, std::size_t t) {
+	auto &heap = heaps[t];
+	heap.reserve(k);
+	for (std::size_t b = first; b < last; ++b) {
+	  float block_scores[block_width];
+	  score_block(data_.data() + b * block_width * dim_, q.data(), dim_,
+	              inv_norms_.data() + b * block_width, query_scale, similarity,
+	              block_scores);
+	  const std::size_t n = std::min(block_width, size_ - b * block_width);
+	  for (std::size_t l = 0; l < n; ++l) {
+		const Match candidate{b * block_width + l, block_scores[l]};
+		if (heap.size() < k) {
+		  heap.push_back(candidate);
+		  std::push_heap(heap.begin(), heap.end(), better);
+		} else if (better(candidate, heap.front())) {
+		  std::pop_heap(heap.begin(), heap.end(), better);
+		  heap.back() = candidate;
+		  std::push_heap(heap.begin(), heap.end(), better);
+		}
+	  }
+	}
+  });
+
+  std::vector<Match> result;
+  for (auto &heap : heaps) {
+	result.insert(result.end(), heap.begin(), heap.end());
+  }
+  std::partial_sort(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(k),
+                    result.end(), better);
+  result.resize(k);
+  return result;
+}
+
+} // namespace linalg
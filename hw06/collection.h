@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "vector.h"
+#include "view.h"
+
+namespace linalg {
+
+/// How a query is compared against the vectors of a collection
+enum class Similarity {
+  /// The plain dot product
+  dot,
+  /// The dot product of the normalized vectors, zero vectors score 0
+  cosine,
+};
+
+/// A search result: the position of a vector in the collection and its score
+struct Match {
+  std::size_t index;
+  float score;
+
+  bool operator==(const Match &) const = default;
+};
+
+/// Pretty print a match as `(index: score)`
+auto operator<<(std::ostream &ostr, const Match &m) -> std::ostream &;
+
+/// Many vectors of the same dimension stored in one contiguous buffer, built
+/// for scoring a query against all of them.
+///
+/// The vectors are kept in a blocked structure-of-arrays layout: groups of
+/// `block_width` vectors are interleaved coefficient by coefficient, i.e.
+/// coefficient `d` of vector `i` lives at
+/// `(i / block_width) * dim * block_width + d * block_width + i % block_width`.
+/// Scoring a block then broadcasts one query coefficient against
+/// `block_width` consecutive floats, which maps directly onto SIMD registers,
+/// and the whole collection is streamed front to back exactly once.
+class VectorCollection {
+public:
+  /// Number of vectors interleaved in one block
+  static constexpr std::size_t block_width = 16;
+
+  /// Construct an empty collection for vectors of dimension `dim`
+  explicit VectorCollection(std::size_t dim);
+
+  /// Return the dimension of the stored vectors
+  auto dim() const -> std::size_t;
+
+  /// Return the number of stored vectors
+  auto size() const -> std::size_t;
+
+  /// Make room for `n` vectors without reallocating
+  auto reserve(std::size_t n) -> void;
+
+  /// Append a copy of `x` to the collection
+  ///
+  /// Throw an `std::invalid_argument` exception if `x` has the wrong size
+  auto push_back(VectorView x) -> void;
+
+  /// Return a copy of the idx-th vector
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto operator[](std::size_t idx) const -> Vector;
+
+  /// Return coefficient `d` of vector `idx`. No bounds checking.
+  auto coeff(std::size_t idx, std::size_t d) const -> float;
+
+  /// Return the euclidean norm of vector `idx`, which is cached on insertion
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto norm(std::size_t idx) const -> float;
+
+  /// Return the similarity of `query` to every stored vector, in insertion
+  /// order. `threads == 0` uses all hardware threads.
+  ///
+  /// Throw an `std::invalid_argument` exception if `query` has the wrong size
+  auto scores(VectorView query, Similarity similarity = Similarity::dot,
+              unsigned threads = 0) const -> Vector;
+
+  /// Return the `k` vectors most similar to `query`, best match first. Ties
+  /// are broken by the smaller index, NaN scores come last. Each thread keeps
+  /// a bounded heap of its `k` best candidates, so no score array is
+  /// materialized.
+  ///
+  /// Throw an `std::invalid_argument` exception if `query` has the wrong size
+  auto top_k(VectorView query, std::size_t k,
+             Similarity similarity = Similarity::dot,
+             unsigned threads = 0) const -> std::vector<Match>;
+
+private:
+  std::size_t dim_;
+  std::size_t size_ = 0;
+  /// interleaved coefficients, the last block is padded with zeros
+  std::vector<float> data_;
+  /// reciprocal norm of every vector, zero for zero vectors
+  std::vector<float> inv_norms_;
+};
+
+} // namespace linalg
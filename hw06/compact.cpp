@@ -0,0 +1,149 @@
+#include "compact.h"
+#include "kernels.h"
+#include <stdexcept>
+
+namespace linalg {
+
+namespace {
+
+/// Integer products of int8 coefficients are summed exactly in blocks of
+/// this many elements, 127 * 127 * 65536 still fits into an int32
+constexpr std::size_t int8_block = 65536;
+
+/// Return `sum(decode(x_i) * y_i)` of contiguous arrays, without the scale
+template <typename Format>
+auto dot_kernel(const typename Format::storage_type *x, const float *y,
+                std::size_t n) -> float {
+  using detail::lanes;
+  float acc[lanes] = {};
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  acc[l] += Format::decode(x[i + l]) * y[i + l];
+	}
+  }
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+	acc[l] += Format::decode(x[i]) * y[i];
+  }
+  return detail::reduce_lanes(acc);
+}
+
+/// Return `sum(decode(x_i) * decode(y_i))` of contiguous arrays, without the
+/// scales
+template <typename Format>
+auto dot_kernel(const typename Format::storage_type *x,
+                const typename Format::storage_type *y, std::size_t n)
+    -> float {
+  using detail::lanes;
+  float acc[lanes] = {};
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  acc[l] += Format::decode(x[i + l]) * Format::decode(y[i + l]);
+	}
+  }
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+	acc[l] += Format::decode(x[i]) * Format::decode(y[i]);
+  }
+  return detail::reduce_lanes(acc);
+}
+
+/// int8 times int8 is summed in integers, which is exact and lets the
+/// compiler use the packed integer multiply-add instructions
+template <>
+auto dot_kernel<int8>(const std::int8_t *x, const std::int8_t *y,
+                      std::size_t n) -> float {
+  float result = 0;
+  for (std::size_t first = 0; first < n; first += int8_block) {
+	const std::size_t last = std::min(n, first + int8_block);
+	std::int32_t acc = 0;
+	for (std::size_t i = first; i < last; ++i) {
+	  acc += static_cast<std::int32_t>(x[i]) * static_cast<std::int32_t>(y[i]);
+	}
+	result += static_cast<float>(acc);
+  }
+  return result;
+}
+
+} // namespace
+
+/// Encode the given coefficients
+template <compact_format Format> CompactVector<Format>::CompactVector(VectorView x) {
+  data_.reserve(x.size());
+  float inv_scale = 1;
+  if constexpr (Format::scaled) {
+	float largest = 0;
+	for (auto v : x) {
+	  largest = std::max(largest, std::abs(v));
+	}
+	if (largest > 0) {
+	  scale_ = largest / 127.f;
+	  inv_scale = 127.f / largest;
+	}
+  }
+  for (auto v : x) {
+	data_.push_back(Format::encode(Format::scaled ? v * inv_scale : v));
+  }
+}
+
+/// Decode the idx-th coefficient
+template <compact_format Format>
+auto CompactVector<Format>::coeff(std::size_t idx) const -> float {
+  if (idx >= data_.size()) {
+	throw std::out_of_range("Index out of range");
+  }
+  return Format::decode(data_[idx]) * scale_;
+}
+
+/// Decode all coefficients into a float vector
+template <compact_format Format>
+auto CompactVector<Format>::to_vector() const -> Vector {
+  Vector result(data_.size());
+  float *out = result.data();
+  for (std::size_t i = 0; i < data_.size(); ++i) {
+	out[i] = Format::decode(data_[i]) * scale_;
+  }
+  return result;
+}
+
+/// Return the dot product of a compact and a float vector
+template <compact_format Format>
+auto dot(const CompactVector<Format> &x, VectorView y) -> float {
+  if (x.size() != y.size()) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  if (y.is_contiguous()) {
+	return dot_kernel<Format>(x.data(), y.data(), x.size()) * x.scale();
+  }
+  float acc = 0;
+  auto it = y.begin();
+  for (std::size_t i = 0; i < x.size(); ++i, ++it) {
+	acc += Format::decode(x.data()[i]) * *it;
+  }
+  return acc * x.scale();
+}
+
+/// Return the dot product of two compact vectors of the same format
+template <compact_format Format>
+auto dot(const CompactVector<Format> &x, const CompactVector<Format> &y)
+    -> float {
+  if (x.size() != y.size()) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  return dot_kernel<Format>(x.data(), y.data(), x.size()) * x.scale() *
+         y.scale();
+}
+
+template class CompactVector<bf16>;
+template class CompactVector<fp16>;
+template class CompactVector<int8>;
+
+template auto dot(const BF16Vector &x, VectorView y) -> float;
+template auto dot(const FP16Vector &x, VectorView y) -> float;
+template auto dot(const Int8Vector &x, VectorView y) -> float;
+
+template auto dot(const BF16Vector &x, const BF16Vector &y) -> float;
+template auto dot(const FP16Vector &x, const FP16Vector &y) -> float;
+template auto dot(const Int8Vector &x, const Int8Vector &y) -> float;
+
+} // namespace linalg
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vector.h"
+#include "view.h"
+
+namespace linalg {
+
+/*
+ * Compact storage formats for vectors whose `dot` and `norm` throughput is
+ * bound by memory bandwidth. Each format describes how one coefficient is
+ * encoded; kernels decode on the fly and always accumulate in fp32.
+ *
+ * Error bounds, per stored coefficient `x` and its decoded value `x'`
+ * (round to nearest even everywhere, u = unit roundoff):
+ *
+ *  - bf16: 8 significant bits, u = 2^-8. |x' - x| <= 2^-8 |x| for normal
+ *          floats, 1.2e-38 <= |x| < 3.39e38, so 2 bytes per coefficient lose
+ *          about 2 decimal digits. |x' - x| <= 2^-134 below that (subnormals),
+ *          larger magnitudes round to infinity.
+ *  - fp16: 11 significant bits, u = 2^-11. |x' - x| <= 2^-11 |x| for
+ *          6.1e-5 <= |x| <= 65504, |x' - x| <= 2^-25 below that (subnormals),
+ *          larger magnitudes overflow to infinity.
+ *  - int8: symmetric quantization with one scale `s = max|x_i| / 127` per
+ *          vector, |x' - x| <= s / 2, i.e. the error is relative to the largest
+ *          coefficient, not to `x` itself. NaNs are stored as 0.
+ *
+ * For a dot product of a compact `x` with a float `y` this gives
+ * |dot(x', y) - dot(x, y)| <= sum_i |x'_i - x_i| |y_i| plus the usual fp32
+ * accumulation error of about n * 2^-24 * sum_i |x_i y_i|.
+ */
+
+/// Brain floating point: the upper half of an IEEE float
+struct bf16 {
+  using storage_type = std::uint16_t;
+  static constexpr bool scaled = false;
+
+  static auto encode(float v) -> storage_type {
+	auto bits = std::bit_cast<std::uint32_t>(v);
+	if ((bits & 0x7fffffffu) > 0x7f800000u) {
+	  // keep NaNs quiet instead of rounding them to infinity
+	  return static_cast<storage_type>((bits >> 16) | 0x0040u);
+	}
+	bits += 0x7fffu + ((bits >> 16) & 1u);
+	return static_cast<storage_type>(bits >> 16);
+  }
+
+  static auto decode(storage_type v) -> float {
+	return std::bit_cast<float>(static_cast<std::uint32_t>(v) << 16);
+  }
+};
+
+/// IEEE 754 half precision
+struct fp16 {
+  using storage_type = std::uint16_t;
+  static constexpr bool scaled = false;
+
+  static auto encode(float v) -> storage_type {
+	const auto bits = std::bit_cast<std::uint32_t>(v);
+	const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+	std::uint32_t abs = bits & 0x7fffffffu;
+
+	if (abs >= 0x7f800000u) {
+	  // infinity stays infinity, NaN stays a (quiet) NaN
+	  return static_cast<storage_type>(sign | (abs > 0x7f800000u ? 0x7e00u : 0x7c00u));
+	}
+	if (abs >= 0x477ff000u) {
+	  // rounds to a value above 65504
+	  return static_cast<storage_type>(sign | 0x7c00u);
+	}
+	if (abs < 0x38800000u) {
+	  // below 2^-14 the result is subnormal, i.e. a multiple of 2^-24
+	  const auto m = std::nearbyint(std::bit_cast<float>(abs) * 16777216.f);
+	  return static_cast<storage_type>(sign | static_cast<std::uint32_t>(m));
+	}
+	// rebias the exponent from 127 to 15 and round the dropped 13 bits
+	abs += 0xc8000fffu + ((abs >> 13) & 1u);
+	return static_cast<storage_type>(sign | (abs >> 13));
+  }
+
+  static auto decode(storage_type v) -> float {
+	const std::uint32_t sign = static_cast<std::uint32_t>(v & 0x8000u) << 16;
+	const std::uint32_t rest = static_cast<std::uint32_t>(v & 0x7fffu) << 13;
+	// shifting into a float and scaling by 2^(127 - 15) fixes the exponent bias
+	// of normal and subnormal numbers alike, without a branch
+	const float magnitude = std::bit_cast<float>(rest) * 0x1p112f;
+	// infinities and NaNs only need their exponent widened, they are blended
+	// in with a mask so the loops calling this stay free of branches
+	const std::uint32_t special = rest | 0x7f800000u;
+	const std::uint32_t is_special =
+		0u - static_cast<std::uint32_t>((v & 0x7c00u) == 0x7c00u);
+	const std::uint32_t result =
+		(special & is_special) | (std::bit_cast<std::uint32_t>(magnitude) & ~is_special);
+	return std::bit_cast<float>(result | sign);
+  }
+};
+
+/// Symmetric 8 bit integers, scaled by one factor per vector
+struct int8 {
+  using storage_type = std::int8_t;
+  static constexpr bool scaled = true;
+
+  /// Encode `v`, which has already been divided by the vector scale
+  static auto encode(float v) -> storage_type {
+	// casting NaN to an integer is undefined
+	if (std::isnan(v)) {
+	  return 0;
+	}
+	return static_cast<storage_type>(std::clamp(std::nearbyint(v), -127.f, 127.f));
+  }
+
+  /// Decode to the unscaled value, multiply with the vector scale afterwards
+  static auto decode(storage_type v) -> float { return static_cast<float>(v); }
+};
+
+/// A coefficient format as above: a storage type with static `encode` and
+/// `decode` and whether the vector carries a scale
+template <typename Format>
+concept compact_format = requires(float v, typename Format::storage_type e) {
+  { Format::encode(v) } -> std::same_as<typename Format::storage_type>;
+  { Format::decode(e) } -> std::same_as<float>;
+  { Format::scaled } -> std::convertible_to<bool>;
+};
+
+/// A vector stored in one of the compact formats above. It is immutable: it is
+/// created from float coefficients and can be decoded back into a `Vector`.
+template <compact_format Format> class CompactVector {
+public:
+  using format = Format;
+  using storage_type = typename Format::storage_type;
+
+  /// Default constructor, an empty vector
+  CompactVector() = default;
+
+  /// Encode the given coefficients
+  explicit CompactVector(VectorView x);
+
+  /// Return the number of coefficients
+  auto size() const -> std::size_t { return data_.size(); }
+
+  /// Return the factor the decoded coefficients are multiplied with, this is
+  /// 1 for the floating point formats
+  auto scale() const -> float { return scale_; }
+
+  /// Return the encoded coefficients
+  auto data() const -> const storage_type * { return data_.data(); }
+
+  /// Return the number of bytes used by the coefficients
+  auto bytes() const -> std::size_t { return data_.size() * sizeof(storage_type); }
+
+  /// Decode the idx-th coefficient.
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto coeff(std::size_t idx) const -> float;
+
+  /// Decode all coefficients into a float vector
+  auto to_vector() const -> Vector;
+
+private:
+  std::vector<storage_type> data_;
+  float scale_ = 1;
+};
+
+using BF16Vector = CompactVector<bf16>;
+using FP16Vector = CompactVector<fp16>;
+using Int8Vector = CompactVector<int8>;
+
+/// Return the dot product of a compact and a float vector, decoding on the fly
+/// and accumulating in fp32
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+template <compact_format Format>
+auto dot(const CompactVector<Format> &x, VectorView y) -> float;
+
+/// Return the dot product of a float and a compact vector
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+template <compact_format Format>
+auto dot(VectorView x, const CompactVector<Format> &y) -> float {
+  return dot(y, x);
+}
+
+/// Return the dot product of two compact vectors of the same format
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+template <compact_format Format>
+auto dot(const CompactVector<Format> &x, const CompactVector<Format> &y)
+    -> float;
+
+/// Return the euclidean norm of a compact vector
+template <compact_format Format> auto norm(const CompactVector<Format> &x) -> float {
+  return std::sqrt(dot(x, x));
+}
+
+} // namespace linalg
@@ -1,3 +1,12 @@
 #pragma once
 
+#include "accumulate.h"
+#include "collection.h"
+#include "compact.h"
+#include "io.h"
+#include "matrix.h"
+#include "sparse.h"
+#include "static_vector.h"
+#include "statistics.h"
 #include "vector.h"
+#include "view.h"
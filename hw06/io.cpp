@@ -0,0 +1,274 @@
+#include "io.h"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace linalg {
+
+namespace {
+
+constexpr char magic[8] = {'L', 'I', 'N', 'A', 'L', 'G', 'V', '\0'};
+constexpr std::uint32_t version = 1;
+
+auto make_header(std::size_t rows, std::size_t dim) -> FileHeader {
+  FileHeader header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.dtype = DType::f32;
+  header.rows = rows;
+  header.dim = dim;
+  header.data_offset = sizeof(FileHeader);
+  return header;
+}
+
+/// Throw if the header doesn't describe a float32 file of at most
+/// `file_size` bytes
+auto check_header(const FileHeader &header, std::uint64_t file_size,
+                  const std::filesystem::path &path) -> void {
+  const auto fail = [&](const char *what) {
+	throw std::runtime_error(path.string() + ": " + what);
+  };
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+	fail("not a linalg vector file");
+  }
+  if (header.version != version) {
+	fail("unsupported version");
+  }
+  if (header.dtype != DType::f32) {
+	fail("unsupported dtype");
+  }
+  if (header.data_offset < sizeof(FileHeader) || header.data_offset % 64 != 0) {
+	fail("bad data offset");
+  }
+  if (header.dim == 0 && header.rows != 0) {
+	fail("rows without a dimension");
+  }
+  // compare without overflow: the offset first, then the rows that fit after it
+  if (header.data_offset > file_size) {
+	fail("truncated");
+  }
+  if (header.dim != 0 &&
+	  header.rows > (file_size - header.data_offset) / sizeof(float) / header.dim) {
+	fail("truncated");
+  }
+}
+
+/// Open `path` for reading and read its header
+auto open_file(const std::filesystem::path &path, std::ifstream &in) -> FileHeader {
+  in.open(path, std::ios::binary);
+  if (!in) {
+	throw std::runtime_error(path.string() + ": cannot open file");
+  }
+  FileHeader header{};
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+	throw std::runtime_error(path.string() + ": not a linalg vector file");
+  }
+  check_header(header, std::filesystem::file_size(path), path);
+  in.seekg(static_cast<std::streamoff>(header.data_offset));
+  return header;
+}
+
+} // namespace
+
+/// Write a single vector to `path`, replacing the file
+auto write(const std::filesystem::path &path, VectorView x) -> void {
+  VectorWriter writer{path, x.size()};
+  writer.write(x);
+  writer.close();
+}
+
+/// Write all vectors of a collection to `path`, replacing the file
+auto write(const std::filesystem::path &path, const VectorCollection &c) -> void {
+  VectorWriter writer{path, c.dim()};
+  for (std::size_t i = 0; i < c.size(); ++i) {
+	writer.write(c[i]);
+  }
+  writer.close();
+}
+
+/// Read a file with a single vector
+auto read_vector(const std::filesystem::path &path) -> Vector {
+  std::ifstream in;
+  const FileHeader header = open_file(path, in);
+  if (header.rows != 1) {
+	throw std::runtime_error(path.string() + ": expected exactly one vector");
+  }
+  Vector x(header.dim);
+  const auto bytes = static_cast<std::streamsize>(header.dim * sizeof(float));
+  if (!in.read(reinterpret_cast<char *>(x.data()), bytes)) {
+	throw std::runtime_error(path.string() + ": read failed");
+  }
+  return x;
+}
+
+/// Read all vectors of a file into a collection
+auto read_collection(const std::filesystem::path &path) -> VectorCollection {
+  const MappedVectors mapped{path};
+  VectorCollection result{mapped.dim()};
+  result.reserve(mapped.rows());
+  for (std::size_t i = 0; i < mapped.rows(); ++i) {
+	result.push_back(mapped[i]);
+  }
+  return result;
+}
+
+/// Map the file at `path`
+MappedVectors::MappedVectors(const std::filesystem::path &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+	throw std::runtime_error(path.string() + ": cannot open file");
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0 ||
+      static_cast<std::size_t>(info.st_size) < sizeof(FileHeader)) {
+	::close(fd);
+	throw std::runtime_error(path.string() + ": not a linalg vector file");
+  }
+  mapped_bytes_ = static_cast<std::size_t>(info.st_size);
+  mapping_ = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  if (mapping_ == MAP_FAILED) {
+	mapping_ = nullptr;
+	throw std::runtime_error(path.string() + ": cannot map file");
+  }
+
+  FileHeader header{};
+  std::memcpy(&header, mapping_, sizeof(header));
+  try {
+	check_header(header, mapped_bytes_, path);
+  } catch (...) {
+	::munmap(mapping_, mapped_bytes_);
+	throw;
+  }
+  data_ = reinterpret_cast<const float *>(static_cast<const char *>(mapping_) +
+                                          header.data_offset);
+  rows_ = header.rows;
+  dim_ = header.dim;
+}
+
+MappedVectors::MappedVectors(MappedVectors &&other) noexcept
+    : mapping_{std::exchange(other.mapping_, nullptr)},
+      mapped_bytes_{std::exchange(other.mapped_bytes_, 0)},
+      data_{std::exchange(other.data_, nullptr)},
+      rows_{std::exchange(other.rows_, 0)}, dim_{std::exchange(other.dim_, 0)} {}
+
+auto MappedVectors::operator=(MappedVectors &&other) noexcept -> MappedVectors & {
+  if (this != &other) {
+	if (mapping_ != nullptr) {
+	  ::munmap(mapping_, mapped_bytes_);
+	}
+	mapping_ = std::exchange(other.mapping_, nullptr);
+	mapped_bytes_ = std::exchange(other.mapped_bytes_, 0);
+	data_ = std::exchange(other.data_, nullptr);
+	rows_ = std::exchange(other.rows_, 0);
+	dim_ = std::exchange(other.dim_, 0);
+  }
+  return *this;
+}
+
+MappedVectors::~MappedVectors() {
+  if (mapping_ != nullptr) {
+	::munmap(mapping_, mapped_bytes_);
+  }
+}
+
+/// Return the number of vectors in the file
+auto MappedVectors::rows() const -> std::size_t {
+  return rows_;
+}
+
+/// Return the dimension of the vectors
+auto MappedVectors::dim() const -> std::size_t {
+  return dim_;
+}
+
+/// Return a view of the idx-th vector. No bounds checking.
+auto MappedVectors::operator[](std::size_t idx) const -> VectorView {
+  return VectorView{data_ + idx * dim_, dim_};
+}
+
+/// Return a view of the idx-th vector
+auto MappedVectors::row(std::size_t idx) const -> VectorView {
+  if (idx >= rows_) {
+	throw std::out_of_range("Index out of range");
+  }
+  return (*this)[idx];
+}
+
+/// Return a view of all coefficients, row after row
+auto MappedVectors::data() const -> VectorView {
+  return VectorView{data_, rows_ * dim_};
+}
+
+/// Create (or replace) the file at `path` for vectors of dimension `dim`
+VectorWriter::VectorWriter(const std::filesystem::path &path, std::size_t dim)
+    : out_{path, std::ios::binary | std::ios::trunc}, dim_{dim} {
+  if (!out_) {
+	throw std::runtime_error(path.string() + ": cannot create file");
+  }
+  // the header is written again with the row count on close
+  const FileHeader header = make_header(0, dim_);
+  out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  chunk_.reserve(chunk_bytes / sizeof(float));
+}
+
+/// Close the file, errors are swallowed
+VectorWriter::~VectorWriter() {
+  try {
+	close();
+  } catch (...) {
+  }
+}
+
+/// Return the number of vectors written so far
+auto VectorWriter::rows() const -> std::size_t {
+  return rows_;
+}
+
+/// Append a vector
+auto VectorWriter::write(VectorView x) -> void {
+  if (x.size() != dim_) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  if (!out_.is_open()) {
+	throw std::runtime_error("Writer is closed");
+  }
+  chunk_.insert(chunk_.end(), x.begin(), x.end());
+  ++rows_;
+  if (chunk_.size() * sizeof(float) >= chunk_bytes) {
+	flush();
+  }
+}
+
+/// Flush the last chunk, write the row count and close the file
+auto VectorWriter::close() -> void {
+  if (!out_.is_open()) {
+	return;
+  }
+  flush();
+  const FileHeader header = make_header(rows_, dim_);
+  out_.seekp(0);
+  out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out_.close();
+  if (!out_) {
+	throw std::runtime_error("Writing the vector file failed");
+  }
+}
+
+auto VectorWriter::flush() -> void {
+  out_.write(reinterpret_cast<const char *>(chunk_.data()),
+             static_cast<std::streamsize>(chunk_.size() * sizeof(float)));
+  chunk_.clear();
+  if (!out_) {
+	throw std::runtime_error("Writing the vector file failed");
+  }
+}
+
+} // namespace linalg
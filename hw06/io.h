@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "collection.h"
+#include "vector.h"
+#include "view.h"
+
+namespace linalg {
+
+/*
+ * Binary on-disk format for vectors and vector collections.
+ *
+ * A file is a 64 byte header followed by `rows * dim` coefficients, row after
+ * row, starting at `data_offset`. The header and the data offset are 64 byte
+ * aligned, so a memory mapped file can be used in place by the SIMD kernels.
+ * Integers and coefficients are stored in the byte order of the machine
+ * (little endian on every platform we run on), a file from a machine with the
+ * other byte order fails the version check.
+ *
+ *   offset  size  field
+ *        0     8  magic "LINALGV\0"
+ *        8     4  version, currently 1
+ *       12     4  dtype, 1 = float32
+ *       16     8  rows, 1 for a single vector
+ *       24     8  dim, the coefficients per row
+ *       32     8  data_offset, 64 for version 1
+ *       40    24  reserved, zero
+ *
+ * I/O errors and malformed files throw `std::runtime_error`.
+ */
+
+/// Coefficient types of the binary format
+enum class DType : std::uint32_t {
+  f32 = 1,
+};
+
+/// The header at the start of every file
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  DType dtype;
+  std::uint64_t rows;
+  std::uint64_t dim;
+  std::uint64_t data_offset;
+  char reserved[24];
+};
+static_assert(sizeof(FileHeader) == 64, "the header is exactly 64 bytes");
+
+/// Write a single vector to `path`, replacing the file
+auto write(const std::filesystem::path &path, VectorView x) -> void;
+
+/// Write all vectors of a collection to `path`, replacing the file
+auto write(const std::filesystem::path &path, const VectorCollection &c) -> void;
+
+/// Read a file with a single vector
+///
+/// Throw an `std::runtime_error` if the file can't be read, is malformed or
+/// holds more than one vector
+auto read_vector(const std::filesystem::path &path) -> Vector;
+
+/// Read all vectors of a file into a collection
+///
+/// Throw an `std::runtime_error` if the file can't be read or is malformed
+auto read_collection(const std::filesystem::path &path) -> VectorCollection;
+
+/// A file memory mapped read-only. Opening it only reads the header, the
+/// coefficients are paged in by the OS on first access, and the rows are
+/// handed out as views into the mapping without copying. The views are valid
+/// as long as the `MappedVectors` is alive.
+class MappedVectors {
+public:
+  /// Map the file at `path`
+  ///
+  /// Throw an `std::runtime_error` if the file can't be mapped or is malformed
+  explicit MappedVectors(const std::filesystem::path &path);
+
+  MappedVectors(const MappedVectors &) = delete;
+  auto operator=(const MappedVectors &) -> MappedVectors & = delete;
+  MappedVectors(MappedVectors &&other) noexcept;
+  auto operator=(MappedVectors &&other) noexcept -> MappedVectors &;
+  ~MappedVectors();
+
+  /// Return the number of vectors in the file
+  auto rows() const -> std::size_t;
+
+  /// Return the dimension of the vectors
+  auto dim() const -> std::size_t;
+
+  /// Return a view of the idx-th vector. No bounds checking.
+  auto operator[](std::size_t idx) const -> VectorView;
+
+  /// Return a view of the idx-th vector.
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto row(std::size_t idx) const -> VectorView;
+
+  /// Return a view of all coefficients, row after row
+  auto data() const -> VectorView;
+
+private:
+  void *mapping_ = nullptr;
+  std::size_t mapped_bytes_ = 0;
+  const float *data_ = nullptr;
+  std::size_t rows_ = 0;
+  std::size_t dim_ = 0;
+};
+
+/// Write vectors of one dimension to a file as they are produced. Rows are
+/// collected into chunks of `chunk_bytes`, which are written with one call
+/// each, and the row count in the header is filled in by `close`.
+class VectorWriter {
+public:
+  /// Size of the chunks the rows are buffered in
+  static constexpr std::size_t chunk_bytes = 1 << 20;
+
+  /// Create (or replace) the file at `path` for vectors of dimension `dim`
+  ///
+  /// Throw an `std::runtime_error` if the file can't be created
+  VectorWriter(const std::filesystem::path &path, std::size_t dim);
+
+  VectorWriter(const VectorWriter &) = delete;
+  auto operator=(const VectorWriter &) -> VectorWriter & = delete;
+
+  /// Close the file, errors are swallowed, call `close` to see them
+  ~VectorWriter();
+
+  /// Return the number of vectors written so far
+  auto rows() const -> std::size_t;
+
+  /// Append a vector
+  ///
+  /// Throw an `std::invalid_argument` exception if `x` has the wrong size and
+  /// an `std::runtime_error` if the writer is closed or writing fails
+  auto write(VectorView x) -> void;
+
+  /// Flush the last chunk, write the row count and close the file. Calling it
+  /// again does nothing.
+  ///
+  /// Throw an `std::runtime_error` if writing fails
+  auto close() -> void;
+
+private:
+  auto flush() -> void;
+
+  std::ofstream out_;
+  std::size_t dim_;
+  std::size_t rows_ = 0;
+  std::vector<float> chunk_;
+};
+
+} // namespace linalg
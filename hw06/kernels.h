@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Low level kernels on contiguous float arrays, shared by the linalg types.
+ *
+ * They are written as loops over `lanes` independent accumulators instead of
+ * one running sum. Floating point addition is not associative, so a compiler
+ * may not vectorise a plain `sum += x[i]` loop without -ffast-math, but it
+ * does map the fixed-width inner loops below onto SIMD registers (SSE, AVX or
+ * NEON, depending on the target flags).
+ */
+namespace linalg::detail {
+
+/// Number of independent accumulators, wide enough for two AVX-512 or four
+/// SSE registers so the FMA latency is hidden
+inline constexpr std::size_t lanes = 16;
+
+/// Unit stride access to a float array, which the compiler can vectorise
+struct contiguous {
+  const float *data;
+  auto operator[](std::size_t i) const -> float { return data[i]; }
+};
+
+/// Access to every `stride`-th float of an array
+struct strided {
+  const float *data;
+  std::size_t stride;
+  auto operator[](std::size_t i) const -> float { return data[i * stride]; }
+};
+
+/// Add up the partial sums of all lanes
+inline auto reduce_lanes(const float (&acc)[lanes]) -> float {
+  float result = 0;
+  for (std::size_t l = 0; l < lanes; ++l) {
+	result += acc[l];
+  }
+  return result;
+}
+
+/// Return `sum(x_i * y_i)` of two contiguous arrays of length `n`
+inline auto dot(const float *x, const float *y, std::size_t n) -> float {
+  float acc[lanes] = {};
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  acc[l] += x[i + l] * y[i + l];
+	}
+  }
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+	acc[l] += x[i] * y[i];
+  }
+  return reduce_lanes(acc);
+}
+
+/// Compute the dot products of four contiguous rows with the same `x` at once,
+/// so every loaded coefficient of `x` is used four times
+inline auto dot4(const float *a0, const float *a1, const float *a2,
+                 const float *a3, const float *x, std::size_t n,
+                 float (&out)[4]) -> void {
+  constexpr std::size_t width = lanes / 2;
+  float acc0[width] = {};
+  float acc1[width] = {};
+  float acc2[width] = {};
+  float acc3[width] = {};
+  std::size_t i = 0;
+  for (; i + width <= n; i += width) {
+	for (std::size_t l = 0; l < width; ++l) {
+	  const float xi = x[i + l];
+	  acc0[l] += a0[i + l] * xi;
+	  acc1[l] += a1[i + l] * xi;
+	  acc2[l] += a2[i + l] * xi;
+	  acc3[l] += a3[i + l] * xi;
+	}
+  }
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+	acc0[l] += a0[i] * x[i];
+	acc1[l] += a1[i] * x[i];
+	acc2[l] += a2[i] * x[i];
+	acc3[l] += a3[i] * x[i];
+  }
+  out[0] = out[1] = out[2] = out[3] = 0;
+  for (std::size_t l = 0; l < width; ++l) {
+	out[0] += acc0[l];
+	out[1] += acc1[l];
+	out[2] += acc2[l];
+	out[3] += acc3[l];
+  }
+}
+
+/// Compute `y_i += alpha * x_i` for two contiguous arrays of length `n`
+inline auto axpy(float alpha, const float *x, float *y, std::size_t n)
+    -> void {
+  for (std::size_t i = 0; i < n; ++i) {
+	y[i] += alpha * x[i];
+  }
+}
+
+/// Compute `y_k_i += alpha_k * x_i` for four output rows at once, so every
+/// loaded coefficient of `x` is used four times
+inline auto axpy4(const float (&alpha)[4], const float *x, float *y0,
+                  float *y1, float *y2, float *y3, std::size_t n) -> void {
+  for (std::size_t i = 0; i < n; ++i) {
+	const float xi = x[i];
+	y0[i] += alpha[0] * xi;
+	y1[i] += alpha[1] * xi;
+	y2[i] += alpha[2] * xi;
+	y3[i] += alpha[3] * xi;
+  }
+}
+
+} // namespace linalg::detail
@@ -0,0 +1,282 @@
+#include "matrix.h"
+#include "kernels.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace linalg {
+
+namespace {
+
+/// Columns of `x` processed per gemv pass, 8 KiB of `x` stay in L1
+constexpr std::size_t gemv_block = 2048;
+
+/// Block sizes of gemm: a `gemm_kc x gemm_nc` panel of `b` (256 KiB) stays in
+/// L2, while `gemm_mc` rows of `c` are updated with it
+constexpr std::size_t gemm_mc = 64;
+constexpr std::size_t gemm_kc = 128;
+constexpr std::size_t gemm_nc = 512;
+
+/// Edge length of the square tiles used by transpose
+constexpr std::size_t transpose_tile = 32;
+
+/// Scale `n` coefficients by `beta`, overwriting them with zeros if `beta` is
+/// zero (so NaNs in uninitialized memory do not survive)
+auto scale(float *y, std::size_t n, float beta) -> void {
+  if (beta == 0.f) {
+	std::fill(y, y + n, 0.f);
+  } else if (beta != 1.f) {
+	std::transform(y, y + n, y, [beta](float elem) { return elem * beta; });
+  }
+}
+
+} // namespace
+
+/// Construct a zero initialized matrix with the given shape
+Matrix::Matrix(std::size_t rows, std::size_t cols)
+    : rows_{rows}, cols_{cols}, data_(rows * cols) {}
+
+/// Construct a matrix with the given shape, all coefficients are `val`
+Matrix::Matrix(std::size_t rows, std::size_t cols, float val)
+    : rows_{rows}, cols_{cols}, data_(rows * cols, val) {}
+
+/// Construct a matrix from a list of rows
+Matrix::Matrix(std::initializer_list<std::initializer_list<float>> rows)
+    : rows_{rows.size()}, cols_{rows.size() == 0 ? 0 : rows.begin()->size()} {
+  data_.reserve(rows_ * cols_);
+  for (auto &&row : rows) {
+	if (row.size() != cols_) {
+	  throw std::invalid_argument("Rows differ in length");
+	}
+	data_.insert(data_.end(), row.begin(), row.end());
+  }
+}
+
+/// Return the number of rows
+auto Matrix::rows() const -> std::size_t {
+  return rows_;
+}
+
+/// Return the number of columns
+auto Matrix::cols() const -> std::size_t {
+  return cols_;
+}
+
+/// Return the number of coefficients
+auto Matrix::size() const -> std::size_t {
+  return data_.size();
+}
+
+/// Return a pointer to the row-major coefficients
+auto Matrix::data() -> float * {
+  return data_.data();
+}
+
+/// Return a pointer to the row-major coefficients
+auto Matrix::data() const -> const float * {
+  return data_.data();
+}
+
+/// Return an begin iterator over all coefficients in row-major order
+auto Matrix::begin() -> iterator {
+  return data_.begin();
+}
+
+/// Return an end iterator over all coefficients in row-major order
+auto Matrix::end() -> iterator {
+  return data_.end();
+}
+
+/// Return an begin const_iterator over all coefficients in row-major order
+auto Matrix::begin() const -> const_iterator {
+  return data_.begin();
+}
+
+/// Return an end const_iterator over all coefficients in row-major order
+auto Matrix::end() const -> const_iterator {
+  return data_.end();
+}
+
+/// Access the coefficient in row `r` and column `c`. No bounds checking.
+auto Matrix::operator()(std::size_t r, std::size_t c) -> float & {
+  return data_[r * cols_ + c];
+}
+
+/// Access the coefficient in row `r` and column `c`. No bounds checking.
+auto Matrix::operator()(std::size_t r, std::size_t c) const -> const float & {
+  return data_[r * cols_ + c];
+}
+
+/// Access the coefficient in row `r` and column `c`.
+///
+/// Throw an `std::out_of_range` exception if the index out of bounds.
+auto Matrix::coeff(std::size_t r, std::size_t c) -> float & {
+  if (r >= rows_ || c >= cols_) {
+	throw std::out_of_range("Index out of range");
+  }
+  return data_[r * cols_ + c];
+}
+
+/// Access the coefficient in row `r` and column `c`.
+///
+/// Throw an `std::out_of_range` exception if the index out of bounds.
+auto Matrix::coeff(std::size_t r, std::size_t c) const -> const float & {
+  if (r >= rows_ || c >= cols_) {
+	throw std::out_of_range("Index out of range");
+  }
+  return data_[r * cols_ + c];
+}
+
+/// Return a contiguous view of row `r`
+auto Matrix::row(std::size_t r) const -> VectorView {
+  if (r >= rows_) {
+	throw std::out_of_range("Index out of range");
+  }
+  return {data_.data() + r * cols_, cols_};
+}
+
+/// Return a strided view of column `c`
+auto Matrix::col(std::size_t c) const -> VectorView {
+  if (c >= cols_) {
+	throw std::out_of_range("Index out of range");
+  }
+  return {data_.data() + c, rows_, cols_};
+}
+
+auto operator<<(std::ostream &ostr, const Matrix &a) -> std::ostream & {
+  ostr << "[";
+  for (std::size_t r = 0; r < a.rows(); ++r) {
+	ostr << (r == 0 ? " " : "\n  ") << a.row(r);
+  }
+  ostr << " ]";
+  return ostr;
+}
+
+/// Return the transposed matrix, copied tile by tile
+auto transpose(const Matrix &a) -> Matrix {
+  Matrix result(a.cols(), a.rows());
+  const std::size_t rows = a.rows();
+  const std::size_t cols = a.cols();
+  const float *src = a.data();
+  float *dst = result.data();
+
+  for (std::size_t r0 = 0; r0 < rows; r0 += transpose_tile) {
+	const std::size_t r1 = std::min(r0 + transpose_tile, rows);
+	for (std::size_t c0 = 0; c0 < cols; c0 += transpose_tile) {
+	  const std::size_t c1 = std::min(c0 + transpose_tile, cols);
+	  for (std::size_t r = r0; r < r1; ++r) {
+		for (std::size_t c = c0; c < c1; ++c) {
+		  dst[c * rows + r] = src[r * cols + c];
+		}
+	  }
+	}
+  }
+  return result;
+}
+
+/// General matrix-vector product `y = alpha * a * x + beta * y`
+auto gemv(float alpha, const Matrix &a, VectorView x, float beta, Vector &y)
+    -> void {
+  if (a.cols() != x.size() || a.rows() != y.size()) {
+	throw std::invalid_argument("Matrix and vector sizes don't match");
+  }
+
+  // the kernels want unit stride and y is overwritten while x is read, so a
+  // strided or aliasing x is gathered once
+  std::vector<float> gathered;
+  const float *xs = x.data();
+  const bool aliases_y = xs != nullptr && xs + x.size() * x.stride() > y.data() &&
+                         xs < y.data() + y.size();
+  if (!x.is_contiguous() || aliases_y) {
+	gathered.assign(x.begin(), x.end());
+	xs = gathered.data();
+  }
+
+  const std::size_t rows = a.rows();
+  const std::size_t cols = a.cols();
+  float *ys = y.data();
+  scale(ys, rows, beta);
+
+  // each row of `a` is streamed exactly once, while a block of `x` stays in L1
+  // and is shared by four rows at a time
+  for (std::size_t c0 = 0; c0 < cols; c0 += gemv_block) {
+	const std::size_t n = std::min(gemv_block, cols - c0);
+	const float *row = a.data() + c0;
+	std::size_t r = 0;
+	for (; r + 4 <= rows; r += 4) {
+	  float out[4];
+	  detail::dot4(row + r * cols, row + (r + 1) * cols, row + (r + 2) * cols,
+	               row + (r + 3) * cols, xs + c0, n, out);
+	  for (std::size_t k = 0; k < 4; ++k) {
+		ys[r + k] += alpha * out[k];
+	  }
+	}
+	for (; r < rows; ++r) {
+	  ys[r] += alpha * detail::dot(row + r * cols, xs + c0, n);
+	}
+  }
+}
+
+/// General matrix-matrix product `c = alpha * a * b + beta * c`
+auto gemm(float alpha, const Matrix &a, const Matrix &b, float beta, Matrix &c)
+    -> void {
+  if (a.cols() != b.rows() || a.rows() != c.rows() || b.cols() != c.cols()) {
+	throw std::invalid_argument("Matrix sizes don't match");
+  }
+  if (&c == &a || &c == &b) {
+	throw std::invalid_argument("Output matrix must not alias an input");
+  }
+
+  const std::size_t m = a.rows();
+  const std::size_t k = a.cols();
+  const std::size_t n = b.cols();
+  const float *as = a.data();
+  const float *bs = b.data();
+  float *cs = c.data();
+  scale(cs, c.size(), beta);
+
+  // loop order j-p-i over cache blocks: the current panel of `b` stays in L2
+  // and the touched part of each row of `c` stays in L1 across the p loop
+  for (std::size_t j0 = 0; j0 < n; j0 += gemm_nc) {
+	const std::size_t nb = std::min(gemm_nc, n - j0);
+	for (std::size_t p0 = 0; p0 < k; p0 += gemm_kc) {
+	  const std::size_t p1 = std::min(p0 + gemm_kc, k);
+	  for (std::size_t i0 = 0; i0 < m; i0 += gemm_mc) {
+		const std::size_t i1 = std::min(i0 + gemm_mc, m);
+		std::size_t i = i0;
+		for (; i + 4 <= i1; i += 4) {
+		  float *c0 = cs + i * n + j0;
+		  for (std::size_t p = p0; p < p1; ++p) {
+			const float factors[4] = {
+				alpha * as[i * k + p], alpha * as[(i + 1) * k + p],
+				alpha * as[(i + 2) * k + p], alpha * as[(i + 3) * k + p]};
+			detail::axpy4(factors, bs + p * n + j0, c0, c0 + n, c0 + 2 * n,
+			              c0 + 3 * n, nb);
+		  }
+		}
+		for (; i < i1; ++i) {
+		  for (std::size_t p = p0; p < p1; ++p) {
+			detail::axpy(alpha * as[i * k + p], bs + p * n + j0,
+			             cs + i * n + j0, nb);
+		  }
+		}
+	  }
+	}
+  }
+}
+
+/// Return the matrix-vector product `a * x`
+auto operator*(const Matrix &a, VectorView x) -> Vector {
+  Vector y(a.rows());
+  gemv(1.f, a, x, 0.f, y);
+  return y;
+}
+
+/// Return the matrix-matrix product `a * b`
+auto operator*(const Matrix &a, const Matrix &b) -> Matrix {
+  Matrix c(a.rows(), b.cols());
+  gemm(1.f, a, b, 0.f, c);
+  return c;
+}
+
+} // namespace linalg
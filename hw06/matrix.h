@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <ostream>
+#include <vector>
+
+#include "vector.h"
+#include "view.h"
+
+namespace linalg {
+
+/// A dense, row-major matrix of floats. Rows are stored one after the other,
+/// so `row(i)` is a contiguous view and `col(j)` is a strided view.
+class Matrix {
+public:
+  using container = std::vector<float>;
+  using iterator = container::iterator;
+  using const_iterator = container::const_iterator;
+
+  /// Default constructor, a 0x0 matrix
+  Matrix() = default;
+
+  /// Construct a zero initialized matrix with the given shape
+  Matrix(std::size_t rows, std::size_t cols);
+
+  /// Construct a matrix with the given shape, all coefficients are `val`
+  Matrix(std::size_t rows, std::size_t cols, float val);
+
+  /// Construct a matrix from a list of rows, i.e. `Matrix{{1, 2}, {3, 4}}`
+  ///
+  /// Throw an `std::invalid_argument` exception if the rows differ in length
+  Matrix(std::initializer_list<std::initializer_list<float>> rows);
+
+  /// Return the number of rows
+  auto rows() const -> std::size_t;
+
+  /// Return the number of columns
+  auto cols() const -> std::size_t;
+
+  /// Return the number of coefficients, i.e. `rows() * cols()`
+  auto size() const -> std::size_t;
+
+  /// Return a pointer to the row-major coefficients
+  auto data() -> float *;
+
+  /// Return a pointer to the row-major coefficients
+  auto data() const -> const float *;
+
+  /// Return an begin iterator over all coefficients in row-major order
+  auto begin() -> iterator;
+
+  /// Return an end iterator over all coefficients in row-major order
+  auto end() -> iterator;
+
+  /// Return an begin const_iterator over all coefficients in row-major order
+  auto begin() const -> const_iterator;
+
+  /// Return an end const_iterator over all coefficients in row-major order
+  auto end() const -> const_iterator;
+
+  /// Access the coefficient in row `r` and column `c`. No bounds checking.
+  auto operator()(std::size_t r, std::size_t c) -> float &;
+
+  /// Access the coefficient in row `r` and column `c`. No bounds checking.
+  auto operator()(std::size_t r, std::size_t c) const -> const float &;
+
+  /// Access the coefficient in row `r` and column `c`.
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto coeff(std::size_t r, std::size_t c) -> float &;
+
+  /// Access the coefficient in row `r` and column `c`.
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto coeff(std::size_t r, std::size_t c) const -> const float &;
+
+  /// Return a contiguous view of row `r`
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto row(std::size_t r) const -> VectorView;
+
+  /// Return a strided view of column `c`
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto col(std::size_t c) const -> VectorView;
+
+private:
+  std::size_t rows_ = 0;
+  std::size_t cols_ = 0;
+  container data_;
+};
+
+/// Pretty print a matrix, one row per line
+auto operator<<(std::ostream &ostr, const Matrix &a) -> std::ostream &;
+
+/// Return the transposed matrix. The copy is done in cache sized tiles, so
+/// neither the reads nor the writes stride through the whole matrix.
+auto transpose(const Matrix &a) -> Matrix;
+
+/// General matrix-vector product `y = alpha * a * x + beta * y`.
+/// If `beta` is zero, `y` is not read, so it may hold garbage.
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+auto gemv(float alpha, const Matrix &a, VectorView x, float beta, Vector &y)
+    -> void;
+
+/// General matrix-matrix product `c = alpha * a * b + beta * c`, computed in
+/// blocks which fit into the caches. If `beta` is zero, `c` is not read.
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+auto gemm(float alpha, const Matrix &a, const Matrix &b, float beta, Matrix &c)
+    -> void;
+
+/// Return the matrix-vector product `a * x`
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+auto operator*(const Matrix &a, VectorView x) -> Vector;
+
+/// Return the matrix-matrix product `a * b`
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+auto operator*(const Matrix &a, const Matrix &b) -> Matrix;
+
+} // namespace linalg
@@ -7,9 +7,9 @@ float distance(const linalg::Vector &x, const linalg::Vector &y) {
 }
 
 linalg::Vector normalize_to_range(const linalg::Vector &x) {
-  auto xmin{linalg::min(x)};
-  auto xmax{linalg::max(x)};
-  return (x - xmin) / (xmax - xmin);
+  auto result{x};
+  linalg::minmax_scale(result);
+  return result;
 }
 
 int main() {
@@ -0,0 +1,224 @@
+#include "sparse.h"
+#include "kernels.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace linalg {
+
+namespace {
+
+/// Return `sum(xv_p * yv_q)` over all `xi_p == yi_q` of two sorted, duplicate
+/// free index lists.
+///
+/// A merge of both lists, which advances the smaller index (or both) without
+/// a branch. Where the indices of the two vectors interleave randomly, a
+/// branching merge mispredicts on about every second step; comparing whole
+/// blocks of indices against each other with SIMD needs 64 comparisons to
+/// advance by 8 to 16 entries and measured slower than this loop.
+auto intersect_dot(const std::uint32_t *xi, const float *xv, std::size_t nx,
+                   const std::uint32_t *yi, const float *yv, std::size_t ny)
+    -> float {
+  float result = 0;
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < nx && j < ny) {
+	const std::uint32_t a = xi[i];
+	const std::uint32_t b = yi[j];
+	const float product = xv[i] * yv[j];
+	result += a == b ? product : 0.f;
+	i += a <= b;
+	j += b <= a;
+  }
+  return result;
+}
+
+/// Return `n`, or throw an `std::length_error` if its indices don't fit into
+/// 32 bits
+auto checked_size(std::size_t n) -> std::size_t {
+  if (n > std::numeric_limits<std::uint32_t>::max()) {
+	throw std::length_error("Sparse vectors hold at most 2^32 - 1 coefficients");
+  }
+  return n;
+}
+
+} // namespace
+
+/// Construct a zero vector of size `n`
+SparseVector::SparseVector(std::size_t n) : size_{checked_size(n)} {}
+
+/// Construct from a dense vector, keeping its non-zero coefficients
+SparseVector::SparseVector(VectorView x) : size_{checked_size(x.size())} {
+  const std::size_t n = non_zeros(x);
+  indices_.reserve(n);
+  values_.reserve(n);
+  std::size_t idx = 0;
+  for (const float v : x) {
+	if (v != 0.f) {
+	  indices_.push_back(static_cast<std::uint32_t>(idx));
+	  values_.push_back(v);
+	}
+	++idx;
+  }
+}
+
+/// Construct a vector of size `n` from its non-zero coefficients
+SparseVector::SparseVector(std::size_t n, std::vector<std::uint32_t> indices,
+                           std::vector<float> values)
+    : size_{checked_size(n)}, indices_{std::move(indices)}, values_{std::move(values)} {
+  if (indices_.size() != values_.size()) {
+	throw std::invalid_argument("Index and value counts don't match");
+  }
+  for (std::size_t k = 0; k < indices_.size(); ++k) {
+	if (indices_[k] >= n || (k > 0 && indices_[k] <= indices_[k - 1])) {
+	  throw std::invalid_argument("Indices must be increasing and in range");
+	}
+  }
+}
+
+/// Return the size of the vector, including the zeros
+auto SparseVector::size() const -> std::size_t {
+  return size_;
+}
+
+/// Return the number of stored coefficients
+auto SparseVector::nnz() const -> std::size_t {
+  return indices_.size();
+}
+
+/// Return the sorted indices of the stored coefficients
+auto SparseVector::indices() const -> std::span<const std::uint32_t> {
+  return indices_;
+}
+
+/// Return the values of the stored coefficients
+auto SparseVector::values() const -> std::span<const float> {
+  return values_;
+}
+
+/// Return the number of bytes used by the indices and values
+auto SparseVector::bytes() const -> std::size_t {
+  return indices_.size() * sizeof(std::uint32_t) + values_.size() * sizeof(float);
+}
+
+/// Append the coefficient `value` at index `idx`, zeros are skipped
+auto SparseVector::push_back(std::size_t idx, float value) -> void {
+  if (idx >= size_ || (!indices_.empty() && idx <= indices_.back())) {
+	throw std::invalid_argument("Indices must be increasing and in range");
+  }
+  if (value != 0.f) {
+	indices_.push_back(static_cast<std::uint32_t>(idx));
+	values_.push_back(value);
+  }
+}
+
+/// Return the idx-th coefficient, found by binary search
+auto SparseVector::coeff(std::size_t idx) const -> float {
+  if (idx >= size_) {
+	throw std::out_of_range("Index out of range");
+  }
+  const auto it = std::lower_bound(indices_.begin(), indices_.end(), idx);
+  if (it == indices_.end() || *it != idx) {
+	return 0.f;
+  }
+  return values_[static_cast<std::size_t>(it - indices_.begin())];
+}
+
+/// Expand into a dense vector
+auto SparseVector::to_vector() const -> Vector {
+  Vector result(size_, 0.f);
+  float *out = result.data();
+  for (std::size_t k = 0; k < indices_.size(); ++k) {
+	out[indices_[k]] = values_[k];
+  }
+  return result;
+}
+
+auto operator<<(std::ostream &ostr, const SparseVector &x) -> std::ostream & {
+  ostr << "{" << x.size() << ": [ ";
+  for (std::size_t k = 0; k < x.nnz(); ++k) {
+	ostr << x.indices()[k] << ": " << x.values()[k] << ", ";
+  }
+  return ostr << "]}";
+}
+
+/// Return the minimum coefficient, which is 0 if not all are stored
+auto min(const SparseVector &x) -> float {
+  if (x.size() == 0) {
+	throw std::invalid_argument("Empty Vector");
+  }
+  float result = x.nnz() < x.size() ? 0.f : std::numeric_limits<float>::infinity();
+  for (const float v : x.values()) {
+	result = std::min(result, v);
+  }
+  return result;
+}
+
+/// Return the maximum coefficient, which is 0 if not all are stored
+auto max(const SparseVector &x) -> float {
+  if (x.size() == 0) {
+	throw std::invalid_argument("Empty Vector");
+  }
+  float result = x.nnz() < x.size() ? 0.f : -std::numeric_limits<float>::infinity();
+  for (const float v : x.values()) {
+	result = std::max(result, v);
+  }
+  return result;
+}
+
+/// Return the number of non-zero coefficients
+auto non_zeros(const SparseVector &x) -> std::size_t {
+  return non_zeros(VectorView{x.values()});
+}
+
+/// Return the sum of the coefficients
+auto sum(const SparseVector &x) -> float {
+  return sum(VectorView{x.values()});
+}
+
+/// Return the euclidean norm of the vector
+auto norm(const SparseVector &x) -> float {
+  return norm(VectorView{x.values()});
+}
+
+/// Return the dot product of a sparse and a dense vector
+auto dot(const SparseVector &x, VectorView y) -> float {
+  if (x.size() != y.size()) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  using detail::lanes;
+  const std::uint32_t *idx = x.indices().data();
+  const float *val = x.values().data();
+  const float *dense = y.data();
+  const std::size_t stride = y.stride();
+  const std::size_t n = x.nnz();
+
+  float acc[lanes] = {};
+  std::size_t k = 0;
+  for (; k + lanes <= n; k += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  acc[l] += val[k + l] * dense[idx[k + l] * stride];
+	}
+  }
+  for (std::size_t l = 0; k < n; ++k, ++l) {
+	acc[l] += val[k] * dense[idx[k] * stride];
+  }
+  return detail::reduce_lanes(acc);
+}
+
+/// Return the dot product of a dense and a sparse vector
+auto dot(VectorView x, const SparseVector &y) -> float {
+  return dot(y, x);
+}
+
+/// Return the dot product of two sparse vectors
+auto dot(const SparseVector &x, const SparseVector &y) -> float {
+  if (x.size() != y.size()) {
+	throw std::invalid_argument("Vector sizes don't match");
+  }
+  return intersect_dot(x.indices().data(), x.values().data(), x.nnz(),
+                       y.indices().data(), y.values().data(), y.nnz());
+}
+
+} // namespace linalg
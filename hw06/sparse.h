@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "vector.h"
+#include "view.h"
+
+namespace linalg {
+
+/// A vector which stores only its non-zero coefficients, as a sorted list of
+/// indices with their values (the row format of CSR matrices). At 5% density
+/// it needs a tenth of the memory of a `Vector`, and `dot` touches only the
+/// stored coefficients.
+///
+/// Indices are 32 bit, so the size is limited to 2^32 - 1 coefficients: the
+/// constructors throw an `std::length_error` for larger sizes.
+class SparseVector {
+public:
+  /// Default constructor, an empty vector
+  SparseVector() = default;
+
+  /// Construct a zero vector of size `n`
+  explicit SparseVector(std::size_t n);
+
+  /// Construct from a dense vector, keeping its non-zero coefficients
+  explicit SparseVector(VectorView x);
+
+  /// Construct a vector of size `n` from its non-zero coefficients
+  ///
+  /// Throw an `std::invalid_argument` exception if the indices are not
+  /// strictly increasing, not smaller than `n` or of a different count than
+  /// the values
+  SparseVector(std::size_t n, std::vector<std::uint32_t> indices,
+               std::vector<float> values);
+
+  /// Return the size of the vector, including the zeros
+  auto size() const -> std::size_t;
+
+  /// Return the number of stored coefficients
+  auto nnz() const -> std::size_t;
+
+  /// Return the sorted indices of the stored coefficients
+  auto indices() const -> std::span<const std::uint32_t>;
+
+  /// Return the values of the stored coefficients
+  auto values() const -> std::span<const float>;
+
+  /// Return the number of bytes used by the indices and values
+  auto bytes() const -> std::size_t;
+
+  /// Append the coefficient `value` at index `idx`, zeros are skipped
+  ///
+  /// Throw an `std::invalid_argument` exception if `idx` is not larger than the
+  /// last stored index or not smaller than the size
+  auto push_back(std::size_t idx, float value) -> void;
+
+  /// Return the idx-th coefficient, found by binary search
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto coeff(std::size_t idx) const -> float;
+
+  /// Expand into a dense vector
+  auto to_vector() const -> Vector;
+
+private:
+  std::size_t size_ = 0;
+  std::vector<std::uint32_t> indices_;
+  std::vector<float> values_;
+};
+
+/// Pretty print the stored coefficients as `{size: [index: value, ...]}`
+auto operator<<(std::ostream &ostr, const SparseVector &x) -> std::ostream &;
+
+/// Return the minimum coefficient, which is 0 if not all are stored
+///
+/// Throw an `std::invalid_argument` exceptions, if the vector is empty
+auto min(const SparseVector &x) -> float;
+
+/// Return the maximum coefficient, which is 0 if not all are stored
+///
+/// Throw an `std::invalid_argument` exceptions, if the vector is empty
+auto max(const SparseVector &x) -> float;
+
+/// Return the number of non-zero coefficients
+auto non_zeros(const SparseVector &x) -> std::size_t;
+
+/// Return the sum of the coefficients
+auto sum(const SparseVector &x) -> float;
+
+/// Return the euclidean norm of the vector
+auto norm(const SparseVector &x) -> float;
+
+/// Return the dot product of a sparse and a dense vector, gathering the dense
+/// coefficients at the stored indices
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+auto dot(const SparseVector &x, VectorView y) -> float;
+
+/// Return the dot product of a dense and a sparse vector
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+auto dot(VectorView x, const SparseVector &y) -> float;
+
+/// Return the dot product of two sparse vectors, by merging their index lists
+///
+/// Throw an `std::invalid_argument` exceptions, if the sizes don't match
+auto dot(const SparseVector &x, const SparseVector &y) -> float;
+
+} // namespace linalg
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "view.h"
+
+namespace linalg {
+
+/// A vector whose size is part of its type, e.g. for 3D and 4D geometry. The
+/// coefficients live inline (on the stack for local variables), every
+/// operation is `constexpr` and is unrolled over the `N` coefficients at
+/// compile time. Mixing sizes is a compile error instead of an
+/// `std::invalid_argument` exception.
+template <typename T, std::size_t N> class StaticVector {
+public:
+  static_assert(std::is_arithmetic_v<T>, "StaticVector holds numbers");
+
+  using value_type = T;
+  using iterator = typename std::array<T, N>::iterator;
+  using const_iterator = typename std::array<T, N>::const_iterator;
+
+  /// Number of coefficients
+  static constexpr std::size_t extent = N;
+
+  /// Default constructor, all coefficients are zero
+  constexpr StaticVector() = default;
+
+  /// Construct with all coefficients equal to `val`
+  constexpr explicit StaticVector(T val) { data_.fill(val); }
+
+  /// Construct from exactly `N` coefficients, e.g. `Vector3{1, 2, 3}`
+  template <typename... Args>
+    requires(sizeof...(Args) == N && N > 1 && (std::convertible_to<Args, T> && ...))
+  constexpr StaticVector(Args... args) : data_{static_cast<T>(args)...} {}
+
+  /// Return the number of coefficients
+  static constexpr auto size() -> std::size_t { return N; }
+
+  constexpr auto data() -> T * { return data_.data(); }
+  constexpr auto data() const -> const T * { return data_.data(); }
+
+  constexpr auto begin() -> iterator { return data_.begin(); }
+  constexpr auto end() -> iterator { return data_.end(); }
+  constexpr auto begin() const -> const_iterator { return data_.begin(); }
+  constexpr auto end() const -> const_iterator { return data_.end(); }
+
+  /// Return the idx-th coefficient. No bounds checking.
+  constexpr auto operator[](std::size_t idx) -> T & { return data_[idx]; }
+  constexpr auto operator[](std::size_t idx) const -> const T & {
+	return data_[idx];
+  }
+
+  /// Return the idx-th coefficient.
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  constexpr auto coeff(std::size_t idx) const -> const T & {
+	if (idx >= N) {
+	  throw std::out_of_range("Index out of range");
+	}
+	return data_[idx];
+  }
+
+  /// View the coefficients, so the `VectorView` functions accept them too
+  operator VectorView() const
+    requires std::same_as<T, float>
+  {
+	return VectorView{data_.data(), N};
+  }
+
+  constexpr auto operator+=(const StaticVector &y) -> StaticVector & {
+	apply([&](std::size_t i) { data_[i] += y.data_[i]; });
+	return *this;
+  }
+
+  constexpr auto operator-=(const StaticVector &y) -> StaticVector & {
+	apply([&](std::size_t i) { data_[i] -= y.data_[i]; });
+	return *this;
+  }
+
+  constexpr auto operator*=(T val) -> StaticVector & {
+	apply([&](std::size_t i) { data_[i] *= val; });
+	return *this;
+  }
+
+  constexpr auto operator/=(T val) -> StaticVector & {
+	apply([&](std::size_t i) { data_[i] /= val; });
+	return *this;
+  }
+
+  constexpr auto operator==(const StaticVector &) const -> bool = default;
+
+  /// Call `fn(i)` for every index, unrolled at compile time
+  template <typename F> static constexpr auto apply(F &&fn) -> void {
+	[&]<std::size_t... I>(std::index_sequence<I...>) {
+	  (fn(I), ...);
+	}(std::make_index_sequence<N>{});
+  }
+
+private:
+  std::array<T, N> data_{};
+};
+
+using Vector2 = StaticVector<float, 2>;
+using Vector3 = StaticVector<float, 3>;
+using Vector4 = StaticVector<float, 4>;
+
+/// Satisfied by the `StaticVector` instantiations, the functions below accept
+/// exactly these types
+template <typename V>
+concept static_vector =
+	std::same_as<std::remove_cvref_t<V>,
+	             StaticVector<typename std::remove_cvref_t<V>::value_type,
+	                          std::remove_cvref_t<V>::extent>>;
+
+namespace detail {
+
+/// Square root usable in constant expressions: Newton's method at compile
+/// time, `std::sqrt` at run time
+template <std::floating_point T> constexpr auto sqrt(T x) -> T {
+  if (!std::is_constant_evaluated()) {
+	return std::sqrt(x);
+  }
+  if (!(x > 0) || x == std::numeric_limits<T>::infinity()) {
+	return x == 0 ? x : (x > 0 ? x : std::numeric_limits<T>::quiet_NaN());
+  }
+  T guess = x < 1 ? T{1} : x;
+  for (;;) {
+	const T next = (guess + x / guess) / 2;
+	if (next >= guess) {
+	  return guess;
+	}
+	guess = next;
+  }
+}
+
+} // namespace detail
+
+template <static_vector V> constexpr auto operator+(V x, const V &y) -> V {
+  return x += y;
+}
+
+template <static_vector V> constexpr auto operator-(V x, const V &y) -> V {
+  return x -= y;
+}
+
+template <static_vector V> constexpr auto operator-(V x) -> V {
+  return x *= typename V::value_type{-1};
+}
+
+template <static_vector V>
+constexpr auto operator*(V x, typename V::value_type val) -> V {
+  return x *= val;
+}
+
+template <static_vector V>
+constexpr auto operator*(typename V::value_type val, V x) -> V {
+  return x *= val;
+}
+
+template <static_vector V>
+constexpr auto operator/(V x, typename V::value_type val) -> V {
+  return x /= val;
+}
+
+/// This will pretty print a vector for you by e.g. `std::cout << x << "\n";`
+template <static_vector V>
+auto operator<<(std::ostream &ostr, const V &x) -> std::ostream & {
+  ostr << "[ ";
+  for (const auto v : x) {
+	ostr << v << ", ";
+  }
+  return ostr << "]";
+}
+
+/// Return the sum of the coefficients
+template <static_vector V>
+constexpr auto sum(const V &x) -> typename V::value_type {
+  typename V::value_type result{};
+  V::apply([&](std::size_t i) { result += x[i]; });
+  return result;
+}
+
+/// Return the minimum coefficient
+template <static_vector V>
+  requires(V::extent > 0)
+constexpr auto min(const V &x) -> typename V::value_type {
+  auto result = x[0];
+  V::apply([&](std::size_t i) { result = x[i] < result ? x[i] : result; });
+  return result;
+}
+
+/// Return the maximum coefficient
+template <static_vector V>
+  requires(V::extent > 0)
+constexpr auto max(const V &x) -> typename V::value_type {
+  auto result = x[0];
+  V::apply([&](std::size_t i) { result = x[i] > result ? x[i] : result; });
+  return result;
+}
+
+/// Return the dot product, both vectors have the same size by construction
+template <static_vector V>
+constexpr auto dot(const V &x, const V &y) -> typename V::value_type {
+  typename V::value_type result{};
+  V::apply([&](std::size_t i) { result += x[i] * y[i]; });
+  return result;
+}
+
+/// Return the euclidean norm of the vector
+template <static_vector V>
+  requires std::floating_point<typename V::value_type>
+constexpr auto norm(const V &x) -> typename V::value_type {
+  return detail::sqrt(dot(x, x));
+}
+
+/// Normalize the vector, i.e. the norm should be 1 after the normalization
+template <static_vector V>
+  requires std::floating_point<typename V::value_type>
+constexpr auto normalize(V &x) -> void {
+  x /= norm(x);
+}
+
+/// Return a normalized copy of the vector
+template <static_vector V>
+  requires std::floating_point<typename V::value_type>
+constexpr auto normalized(V x) -> V {
+  return x /= norm(x);
+}
+
+/// Return the cross product of two 3D vectors
+template <static_vector V>
+  requires(V::extent == 3)
+constexpr auto cross(const V &x, const V &y) -> V {
+  return V{x[1] * y[2] - x[2] * y[1], x[2] * y[0] - x[0] * y[2],
+           x[0] * y[1] - x[1] * y[0]};
+}
+
+} // namespace linalg
@@ -0,0 +1,226 @@
+#include "statistics.h"
+#include "kernels.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace linalg {
+
+namespace {
+
+using detail::lanes;
+
+/// The vector is processed in chunks of at most this many coefficients, so
+/// the lane indices and counters fit into 32 bits, which are as wide as the
+/// float lanes they are blended with
+constexpr std::size_t max_chunk = std::size_t{1} << 31;
+
+/// Map the bits of a float to an integer with the same order, by flipping the
+/// magnitude bits of negative numbers. The mapping is its own inverse.
+///
+/// Min and max are tracked on these keys: integer comparisons can't raise
+/// floating point exceptions, so unlike float comparisons the compiler may
+/// turn the selects into SIMD blends.
+inline auto ordered_key(std::uint32_t bits) -> std::int32_t {
+  const auto s = static_cast<std::int32_t>(bits);
+  return s ^ static_cast<std::int32_t>(static_cast<std::uint32_t>(s >> 31) >> 1);
+}
+
+/// Return the float of an ordered key
+inline auto from_key(std::int32_t key) -> float {
+  return std::bit_cast<float>(static_cast<std::uint32_t>(ordered_key(static_cast<std::uint32_t>(key))));
+}
+
+/// Statistics of one chunk, with the sums relative to the shift
+struct Partial {
+  std::int32_t min = std::numeric_limits<std::int32_t>::max();
+  std::int32_t max = std::numeric_limits<std::int32_t>::min();
+  std::size_t argmin = 0;
+  std::size_t argmax = 0;
+  double shifted_sum = 0;
+  double shifted_squares = 0;
+  std::size_t non_zeros = 0;
+};
+
+/// Compute the statistics of `n <= max_chunk` coefficients in SIMD lanes. The
+/// minimum and maximum of every lane are tracked with blend masks, the strict
+/// comparisons keep the first index within a lane. NaNs get keys which never
+/// win.
+template <typename Access>
+auto chunk_statistics(Access x, std::size_t n, float shift) -> Partial {
+  constexpr std::int32_t never_min = std::numeric_limits<std::int32_t>::max();
+  constexpr std::int32_t never_max = std::numeric_limits<std::int32_t>::min();
+  std::int32_t mins[lanes];
+  std::int32_t maxs[lanes];
+  std::uint32_t argmins[lanes] = {};
+  std::uint32_t argmaxs[lanes] = {};
+  // double lanes, float ones would lose the small deviations of long vectors
+  double sums[lanes] = {};
+  double squares[lanes] = {};
+  std::uint32_t non_zeros[lanes] = {};
+  for (std::size_t l = 0; l < lanes; ++l) {
+	mins[l] = never_min;
+	maxs[l] = never_max;
+  }
+
+  const auto step = [&](std::size_t l, std::size_t i) {
+	const float v = x[i];
+	const auto bits = std::bit_cast<std::uint32_t>(v);
+	const auto idx = static_cast<std::uint32_t>(i);
+	// all-ones masks blend the values without a branch
+	const std::uint32_t nan = 0u - static_cast<std::uint32_t>((bits & 0x7fffffffu) > 0x7f800000u);
+	const std::int32_t key = ordered_key(bits);
+	const auto min_key = static_cast<std::int32_t>(
+		(static_cast<std::uint32_t>(key) & ~nan) | (static_cast<std::uint32_t>(never_min) & nan));
+	const auto max_key = static_cast<std::int32_t>(
+		(static_cast<std::uint32_t>(key) & ~nan) | (static_cast<std::uint32_t>(never_max) & nan));
+	const std::uint32_t lower = 0u - static_cast<std::uint32_t>(min_key < mins[l]);
+	const std::uint32_t higher = 0u - static_cast<std::uint32_t>(max_key > maxs[l]);
+	mins[l] = std::min(min_key, mins[l]);
+	argmins[l] = (idx & lower) | (argmins[l] & ~lower);
+	maxs[l] = std::max(max_key, maxs[l]);
+	argmaxs[l] = (idx & higher) | (argmaxs[l] & ~higher);
+	const double d = static_cast<double>(v) - static_cast<double>(shift);
+	sums[l] += d;
+	squares[l] += d * d;
+	non_zeros[l] += (bits & 0x7fffffffu) != 0;
+  };
+
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+	for (std::size_t l = 0; l < lanes; ++l) {
+	  step(l, i + l);
+	}
+  }
+  for (std::size_t l = 0; i < n; ++i, ++l) {
+	step(l, i);
+  }
+
+  Partial result;
+  for (std::size_t l = 0; l < lanes; ++l) {
+	if (mins[l] < result.min || (mins[l] == result.min && argmins[l] < result.argmin)) {
+	  result.min = mins[l];
+	  result.argmin = argmins[l];
+	}
+	if (maxs[l] > result.max || (maxs[l] == result.max && argmaxs[l] < result.argmax)) {
+	  result.max = maxs[l];
+	  result.argmax = argmaxs[l];
+	}
+	result.shifted_sum += sums[l];
+	result.shifted_squares += squares[l];
+	result.non_zeros += non_zeros[l];
+  }
+  return result;
+}
+
+/// Compute `x_i = (x_i - center) * scale + lo` in place. The center is
+/// subtracted first: folding it into one offset `lo - center * scale` would
+/// cancel the digits of values on a large common offset. It is split into a
+/// float and the float of the rest, so values close to it are centered
+/// exactly without leaving float.
+auto scale_in_place(Vector &x, double center, double scale, double lo) -> void {
+  const auto center_high = static_cast<float>(center);
+  const auto center_low = static_cast<float>(center - static_cast<double>(center_high));
+  const auto scale_f = static_cast<float>(scale);
+  const auto lo_f = static_cast<float>(lo);
+  float *data = x.data();
+  const std::size_t n = x.size();
+  for (std::size_t i = 0; i < n; ++i) {
+	data[i] = ((data[i] - center_high) - center_low) * scale_f + lo_f;
+  }
+}
+
+/// Compute the statistics of all of `x`, with the sums relative to `shift`
+auto total_statistics(VectorView x, float shift) -> Partial {
+  Partial total;
+  bool first = true;
+  for (std::size_t start = 0; start < x.size(); start += max_chunk) {
+	const std::size_t n = std::min(max_chunk, x.size() - start);
+	const Partial chunk =
+		x.is_contiguous()
+			? chunk_statistics(detail::contiguous{x.data() + start}, n, shift)
+			: chunk_statistics(detail::strided{x.data() + start * x.stride(), x.stride()},
+			                   n, shift);
+	// later chunks only win on strictly better values, as within a chunk
+	if (first || chunk.min < total.min) {
+	  total.min = chunk.min;
+	  total.argmin = chunk.argmin + start;
+	}
+	if (first || chunk.max > total.max) {
+	  total.max = chunk.max;
+	  total.argmax = chunk.argmax + start;
+	}
+	total.shifted_sum += chunk.shifted_sum;
+	total.shifted_squares += chunk.shifted_squares;
+	total.non_zeros += chunk.non_zeros;
+	first = false;
+  }
+  return total;
+}
+
+/// Return the mean and the population variance of the sums of `total`
+auto mean_and_variance(const Partial &total, std::size_t size, float shift)
+	-> std::pair<double, double> {
+  const auto n = static_cast<double>(size);
+  const double s1 = total.shifted_sum;
+  return {static_cast<double>(shift) + s1 / n,
+		  std::max(0.0, (total.shifted_squares - s1 * s1 / n) / n)};
+}
+
+} // namespace
+
+/// Return all summary statistics of `x` in a single pass over the data
+auto statistics(VectorView x) -> Statistics {
+  if (x.size() == 0) {
+	throw std::invalid_argument("Empty Vector");
+  }
+  const float shift = x[0];
+  const Partial total = total_statistics(x, shift);
+  const auto [mean, variance] = mean_and_variance(total, x.size(), shift);
+
+  // undo the shift: x = d + shift
+  const auto n = static_cast<double>(x.size());
+  const double s1 = total.shifted_sum;
+  const double s2 = total.shifted_squares;
+  const auto k = static_cast<double>(shift);
+
+  Statistics result{};
+  result.size = x.size();
+  result.min = from_key(total.min);
+  result.max = from_key(total.max);
+  result.argmin = total.argmin;
+  result.argmax = total.argmax;
+  result.sum = static_cast<float>(s1 + n * k);
+  result.sum_of_squares = static_cast<float>(s2 + 2 * k * s1 + n * k * k);
+  result.mean = static_cast<float>(mean);
+  result.variance = static_cast<float>(variance);
+  result.non_zeros = total.non_zeros;
+  return result;
+}
+
+/// Scale `x` in place to the range [lo, hi]
+auto minmax_scale(Vector &x, float lo, float hi) -> void {
+  const Statistics stats = statistics(x);
+  const double range = static_cast<double>(stats.max) - static_cast<double>(stats.min);
+  const double scale = range > 0 ? (static_cast<double>(hi) - lo) / range : 0.0;
+  scale_in_place(x, stats.min, scale, lo);
+}
+
+/// Standardize `x` in place to mean 0 and variance 1
+auto standardize(Vector &x) -> void {
+  if (x.size() == 0) {
+	throw std::invalid_argument("Empty Vector");
+  }
+  // the mean in double, rounded to float it may be off by half the spacing
+  // of the values on a large offset
+  const float shift = x[0];
+  const auto [mean, variance] = mean_and_variance(total_statistics(x, shift), x.size(), shift);
+  const double deviation = std::sqrt(variance);
+  scale_in_place(x, mean, deviation > 0 ? 1.0 / deviation : 0.0, 0.0);
+}
+
+} // namespace linalg
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+#include "vector.h"
+#include "view.h"
+
+namespace linalg {
+
+/// Summary statistics of a vector, as computed by `statistics`
+struct Statistics {
+  std::size_t size;
+  float min;
+  float max;
+  /// index of the first minimum
+  std::size_t argmin;
+  /// index of the first maximum
+  std::size_t argmax;
+  float sum;
+  float sum_of_squares;
+  float mean;
+  /// population variance, i.e. divided by `size`
+  float variance;
+  std::size_t non_zeros;
+};
+
+/// Return all summary statistics of `x` in a single pass over the data, in
+/// SIMD lanes. Replaces separate calls of `min`, `max`, `argmin`, `argmax`,
+/// `sum` and `non_zeros`, each of which reads the whole vector.
+///
+/// The sums are accumulated in double, relative to the first coefficient,
+/// which keeps the variance accurate even if the mean is large compared to
+/// the spread.
+/// NaNs are skipped by min and max.
+///
+/// Throw an `std::invalid_argument` exceptions, if the vector is empty
+auto statistics(VectorView x) -> Statistics;
+
+/// Scale `x` in place to the range [lo, hi], i.e. the minimum becomes `lo` and
+/// the maximum `hi` up to rounding. A constant vector becomes `lo`. One pass
+/// to find the range and one pass computing `(x - min) * scale + lo`.
+///
+/// Throw an `std::invalid_argument` exceptions, if the vector is empty
+auto minmax_scale(Vector &x, float lo = 0, float hi = 1) -> void;
+
+/// Standardize `x` in place to mean 0 and variance 1 (z-scores). A constant
+/// vector becomes 0. One pass for mean and variance and one pass computing
+/// `(x - mean) * scale`.
+///
+/// Throw an `std::invalid_argument` exceptions, if the vector is empty
+auto standardize(Vector &x) -> void;
+
+} // namespace linalg
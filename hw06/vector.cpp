@@ -1,4 +1,6 @@
 #include "vector.h"
+#include "accumulate.h"
+#include <functional>
 #include <cmath>
 #include <vector>
 #include <iostream>
@@ -48,6 +50,16 @@ auto Vector::size() const -> std::size_t {
   return data_.size();
 }
 
+/// Return a pointer to the contiguous coefficients of the vector
+auto Vector::data() -> float * {
+  return data_.data();
+}
+
+/// Return a pointer to the contiguous coefficients of the vector
+auto Vector::data() const -> const float * {
+  return data_.data();
+}
+
 /// Return an begin iterator to the vector
 auto Vector::begin() -> iterator {
   return data_.begin();
@@ -227,7 +239,7 @@ auto Vector::operator-=(const Vector &y) -> Vector & {
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto min(const Vector &x) -> float {
+auto min(VectorView x) -> float {
   if (x.size() == 0) {
 	throw std::invalid_argument("Empty Vector");
   }
@@ -239,7 +251,7 @@ auto min(const Vector &x) -> float {
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto max(const Vector &x) -> float {
+auto max(VectorView x) -> float {
   if (x.size() == 0) {
 	throw std::invalid_argument("Empty Vector");
   }
@@ -251,7 +263,7 @@ auto max(const Vector &x) -> float {
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto argmin(const Vector &x) -> std::size_t {
+auto argmin(VectorView x) -> std::size_t {
   if (x.size() == 0) {
 	throw std::invalid_argument("Empty Vector");
   }
@@ -263,7 +275,7 @@ auto argmin(const Vector &x) -> std::size_t {
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto argmax(const Vector &x) -> std::size_t {
+auto argmax(VectorView x) -> std::size_t {
   if (x.size() == 0) {
 	throw std::invalid_argument("Empty Vector");
 
@@ -273,22 +285,18 @@ auto argmax(const Vector &x) -> std::size_t {
 }
 
 /// Return the number of non-zero elements in the vector
-auto non_zeros(const Vector &x) -> std::size_t {
+auto non_zeros(VectorView x) -> std::size_t {
   return x.size() - static_cast<unsigned long>(std::count(x.begin(), x.end(), 0));
 }
 
 /// Return the sum of the coefficients of the given vector
-auto sum(const Vector &x) -> float {
-  return static_cast<float>(std::reduce(x.begin(), x.end(), 0.0, [](float x, float y) -> float {
-	return x + y;
-  }));
+auto sum(VectorView x) -> float {
+  return sum<accumulate::fast>(x);
 }
 
 /// Return the product of the coefficients of the given vector
-auto prod(const Vector &x) -> float {
-  return static_cast<float>(std::reduce(x.begin(), x.end(), 1, [](float x, float y) -> float {
-	return x * y;
-  }));
+auto prod(VectorView x) -> float {
+  return std::reduce(x.begin(), x.end(), 1.f, std::multiplies<float>{});
 }
 
 /// Return the dot product of the two vectors. i.e. the sum of products of the
@@ -296,17 +304,14 @@ auto prod(const Vector &x) -> float {
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto dot(const Vector &x, const Vector &y) -> float {
-  if (x.size() != y.size()) {
-	throw std::invalid_argument("Vector sizes don't match");
-  }
-  return static_cast<float>(std::inner_product(std::begin(x), std::end(x), std::begin(y), 0.0));
+auto dot(VectorView x, VectorView y) -> float {
+  return dot<accumulate::fp64>(x, y);
 }
 
 /// Return the euclidean norm of the vector. i.e. the sum of the square of the
 /// coefficients: `sum(x_i * x_i) forall i in [0, x.size())`
-auto norm(const Vector &x) -> float {
-  return std::sqrt(dot(x, x));
+auto norm(VectorView x) -> float {
+  return norm<accumulate::fp64>(x);
 }
 
 /// Normalize the vector, i.e. the norm should be 1 after the normalization
@@ -392,7 +397,6 @@ auto operator-(const Vector &x, const Vector &y) -> Vector {
 
   std::transform(new_object.begin(), new_object.end(), y.begin(), new_object.begin(), std::minus<>());
 
-  std::cout << new_object;
   return new_object;
 
 }
@@ -1,9 +1,13 @@
+#pragma once
+
 #include <functional>
 #include <initializer_list>
 #include <ostream>
 #include <utility>
 #include <vector>
 
+#include "view.h"
+
 namespace linalg {
 
 /// A linear algebra like vector. This class should behave similarly to a vector
@@ -45,6 +49,12 @@ public:
   /// Return the size of the vector
   auto size() const -> std::size_t;
 
+  /// Return a pointer to the contiguous coefficients of the vector
+  auto data() -> float *;
+
+  /// Return a pointer to the contiguous coefficients of the vector
+  auto data() const -> const float *;
+
   /// Return an begin iterator to the vector
   auto begin() -> iterator;
 
@@ -134,49 +144,53 @@ private:
 /// This will pretty print a vector for you by e.g. `std::cout << x << "\n";`
 auto operator<<(std::ostream &ostr, const Vector &x) -> std::ostream &;
 
+/* Read-only functions take a `VectorView`, so they work on a `Vector` as well
+ * as on external memory without copying it into a `Vector` first. */
+
 /// Return the minimum value of Vector
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto min(const Vector &x) -> float;
+auto min(VectorView x) -> float;
 
 /// Return the maximum value of Vector
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto max(const Vector &x) -> float;
+auto max(VectorView x) -> float;
 
 /// Return the index into the vector of the minimum value of Vector
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto argmin(const Vector &x) -> std::size_t;
+auto argmin(VectorView x) -> std::size_t;
 
 /// Return the index into the vector of the maximum value of Vector
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto argmax(const Vector &x) -> std::size_t;
+auto argmax(VectorView x) -> std::size_t;
 
 /// Return the number of non-zero elements in the vector
-auto non_zeros(const Vector &x) -> std::size_t;
+auto non_zeros(VectorView x) -> std::size_t;
 
-/// Return the sum of the coefficients of the given vector
-auto sum(const Vector &x) -> float;
+/// Return the sum of the coefficients of the given vector, see `accumulate.h`
+/// for the more accurate strategies
+auto sum(VectorView x) -> float;
 
 /// Return the product of the coefficients of the given vector
-auto prod(const Vector &x) -> float;
+auto prod(VectorView x) -> float;
 
 /// Return the dot product of the two vectors. i.e. the sum of products of the
 /// coefficients: `sum(x_i * y_i) forall i in [0, x.size())`
 ///
 /// Throw an `std::invalid_argument` exceptions, if the given vector is of a
 /// different size
-auto dot(const Vector &x, const Vector &y) -> float;
+auto dot(VectorView x, VectorView y) -> float;
 
 /// Return the euclidean norm of the vector. i.e. the sum of the square of the
 /// coefficients: `sum(x_i * x_i) forall i in [0, x.size())`
-auto norm(const Vector &x) -> float;
+auto norm(VectorView x) -> float;
 
 /// Normalize the vector, i.e. the norm should be 1 after the normalization
 auto normalize(Vector &x) -> void;
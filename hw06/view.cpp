@@ -0,0 +1,68 @@
+#include "view.h"
+#include "vector.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace linalg {
+
+/// View every `stride`-th coefficient of `data`, starting with the first one
+VectorView::VectorView(std::span<const float> data, std::size_t stride)
+    : data_{data.data()}, stride_{stride} {
+  if (stride == 0) {
+	throw std::invalid_argument("Stride must not be zero");
+  }
+  size_ = (data.size() + stride - 1) / stride;
+}
+
+/// View the given pointer as `size` coefficients, which are `stride` floats
+/// apart from each other
+VectorView::VectorView(const float *data, std::size_t size, std::size_t stride)
+    : data_{data}, size_{size}, stride_{stride} {
+  if (stride == 0) {
+	throw std::invalid_argument("Stride must not be zero");
+  }
+}
+
+/// View all coefficients of the given vector
+VectorView::VectorView(const Vector &x) : data_{x.data()}, size_{x.size()} {}
+
+/// Access the idx-th viewed coefficient, negative indices wrap around once
+auto VectorView::operator[](int idx) const -> const float & {
+  if (idx < 0) {
+	return data_[(size_ + static_cast<std::size_t>(idx)) * stride_];
+  }
+  return data_[static_cast<std::size_t>(idx) * stride_];
+}
+
+/// Access the idx-th viewed coefficient without wrapping behaviour.
+///
+/// Throw an `std::out_of_range` exception if the index out of bounds.
+auto VectorView::coeff(int idx) const -> const float & {
+  if (idx < 0 || static_cast<std::size_t>(idx) >= size_) {
+	throw std::out_of_range("Index out of range");
+  }
+  return data_[static_cast<std::size_t>(idx) * stride_];
+}
+
+/// Return a view of `count` coefficients of this view, starting at `start`
+/// and taking every `step`-th one.
+auto VectorView::slice(std::size_t start, std::size_t count,
+                       std::size_t step) const -> VectorView {
+  if (step == 0) {
+	throw std::invalid_argument("Stride must not be zero");
+  }
+  if (count != 0 && (start >= size_ || (count - 1) * step >= size_ - start)) {
+	throw std::out_of_range("Slice out of range");
+  }
+  return {data_ + start * stride_, count, stride_ * step};
+}
+
+auto operator<<(std::ostream &ostr, VectorView x) -> std::ostream & {
+  ostr << "[ ";
+  std::copy(x.begin(), x.end(), std::ostream_iterator<float>(ostr, ", "));
+  ostr << "]";
+  return ostr;
+}
+
+} // namespace linalg
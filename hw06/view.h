@@ -0,0 +1,163 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <span>
+
+namespace linalg {
+
+class Vector;
+
+/// A non-owning, read-only view onto float coefficients which live somewhere
+/// else, e.g. in a `Vector`, a memory mapped file or a network buffer. The view
+/// can skip over coefficients with a stride, so a column of a row-major matrix
+/// can be viewed without copying it. The viewed memory has to outlive the view.
+class VectorView {
+public:
+  /// Random access iterator walking the view with its stride
+  class const_iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = float;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const float *;
+    using reference = const float &;
+
+    const_iterator() = default;
+    const_iterator(const float *data, std::size_t stride, std::size_t idx)
+        : data_{data}, stride_{stride}, idx_{idx} {}
+
+    auto operator*() const -> reference { return data_[idx_ * stride_]; }
+    auto operator->() const -> pointer { return &**this; }
+    auto operator[](difference_type n) const -> reference {
+      return *(*this + n);
+    }
+
+    auto operator++() -> const_iterator & {
+      ++idx_;
+      return *this;
+    }
+    auto operator++(int) -> const_iterator {
+      auto old = *this;
+      ++idx_;
+      return old;
+    }
+    auto operator--() -> const_iterator & {
+      --idx_;
+      return *this;
+    }
+    auto operator--(int) -> const_iterator {
+      auto old = *this;
+      --idx_;
+      return old;
+    }
+
+    auto operator+=(difference_type n) -> const_iterator & {
+      idx_ = static_cast<std::size_t>(static_cast<difference_type>(idx_) + n);
+      return *this;
+    }
+    auto operator-=(difference_type n) -> const_iterator & {
+      return *this += -n;
+    }
+
+    friend auto operator+(const_iterator it, difference_type n)
+        -> const_iterator {
+      return it += n;
+    }
+    friend auto operator+(difference_type n, const_iterator it)
+        -> const_iterator {
+      return it += n;
+    }
+    friend auto operator-(const_iterator it, difference_type n)
+        -> const_iterator {
+      return it -= n;
+    }
+    friend auto operator-(const const_iterator &a, const const_iterator &b)
+        -> difference_type {
+      return static_cast<difference_type>(a.idx_) -
+             static_cast<difference_type>(b.idx_);
+    }
+
+    friend auto operator==(const const_iterator &a, const const_iterator &b)
+        -> bool {
+      return a.idx_ == b.idx_;
+    }
+    friend auto operator<=>(const const_iterator &a, const const_iterator &b)
+        -> std::strong_ordering {
+      return a.idx_ <=> b.idx_;
+    }
+
+  private:
+    const float *data_ = nullptr;
+    std::size_t stride_ = 1;
+    std::size_t idx_ = 0;
+  };
+  using iterator = const_iterator;
+
+  /// Default constructor, an empty view
+  VectorView() = default;
+
+  /// View every `stride`-th coefficient of `data`, starting with the first one
+  ///
+  /// Throw an `std::invalid_argument` exception if the stride is zero
+  explicit VectorView(std::span<const float> data, std::size_t stride = 1);
+
+  /// View the given pointer as `size` coefficients, which are `stride`
+  /// floats apart from each other
+  VectorView(const float *data, std::size_t size, std::size_t stride = 1);
+
+  /// View all coefficients of the given vector
+  VectorView(const Vector &x);
+
+  /// Return the number of viewed coefficients
+  auto size() const -> std::size_t { return size_; }
+
+  /// Return the distance (in floats) between two viewed coefficients
+  auto stride() const -> std::size_t { return stride_; }
+
+  /// Return a pointer to the first viewed coefficient
+  auto data() const -> const float * { return data_; }
+
+  /// Return true if the coefficients are densely packed in memory
+  auto is_contiguous() const -> bool { return stride_ == 1; }
+
+  /// Return a begin const_iterator to the view
+  auto begin() const -> const_iterator { return {data_, stride_, 0}; }
+
+  /// Return an end const_iterator to the view
+  auto end() const -> const_iterator { return {data_, stride_, size_}; }
+
+  /// Return a begin const_iterator to the view
+  auto cbegin() const -> const_iterator { return begin(); }
+
+  /// Return an end const_iterator to the view
+  auto cend() const -> const_iterator { return end(); }
+
+  /// Access the idx-th viewed coefficient, negative indices wrap around once,
+  /// just like `Vector::operator[]`
+  auto operator[](int idx) const -> const float &;
+
+  /// Access the idx-th viewed coefficient without wrapping behaviour.
+  ///
+  /// Throw an `std::out_of_range` exception if the index out of bounds.
+  auto coeff(int idx) const -> const float &;
+
+  /// Return a view of `count` coefficients of this view, starting at `start`
+  /// and taking every `step`-th one.
+  ///
+  /// Throw an `std::out_of_range` exception if the slice does not fit.
+  auto slice(std::size_t start, std::size_t count, std::size_t step = 1) const
+      -> VectorView;
+
+private:
+  const float *data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t stride_ = 1;
+};
+
+/// Pretty print a view, the same way a `Vector` is printed
+auto operator<<(std::ostream &ostr, VectorView x) -> std::ostream &;
+
+} // namespace linalg
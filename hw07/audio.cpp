@@ -23,7 +23,6 @@ unsigned Audio::get_duration() { return this->duration; }
 
 
 void Audio::update(FileContent &&new_content, unsigned int new_duration) {
-  content.update(std::move(new_content));
-  duration = new_duration;
+  replace_content(std::move(new_content), [&] { duration = new_duration; });
 
 }
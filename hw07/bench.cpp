@@ -0,0 +1,784 @@
+/*
+ * Benchmarks for the filesystem.
+ *
+ * Build the project with -DCMAKE_BUILD_TYPE=Release, Debug builds measure the
+ * lack of optimization only.
+ *
+ * usage: fs_bench [--files N] [--threads N] [--min-time SECONDS] [section...]
+ *
+ * Sections: lookup, concurrent, memory, compression, snapshot, wal,
+ * directories, streaming, versions, eviction, ingest. Without a section all
+ * of them run.
+ *   lookup      get_file latency from 10^3 up to `--files` (default 10^6) files
+ *   concurrent  mixed lookups, renames and registrations from `--threads`
+ *               threads (default: hardware threads, at least 4), one shared
+ *               filesystem behind an external mutex vs. sharded locking
+ *   memory      heap bytes per document for `--files` small documents,
+ *               std::make_shared vs. the slab pools, before and after
+ *               deleting every second one (glibc only)
+ *   compression stored bytes per document for text documents, and the cost of
+ *               `get()` with and without the decompression cache
+ *   snapshot    building a filesystem of `--files` text documents from
+ *               scratch vs. saving it and loading the snapshot again
+ *   wal         mutations per second of a persistent filesystem from 1 and
+ *               `--threads` threads, per durability level
+ *   directories listing and sizing one of 1000 directories of `--files`
+ *               files with the directory tree vs. scanning all names for the
+ *               prefix, and renaming a directory
+ *   streaming   counting the lines of a 256 MiB file mapped as content,
+ *               through `get()` vs. `chunks()`, and the heap each needs
+ *   versions    100 small edits to a 1 MiB document keeping all versions:
+ *               bytes of the history vs. whole copies, and time per update
+ *   eviction    Zipf distributed lookups of 10^4 files of 4 KiB under a
+ *               memory budget of 10%, applied every 100 lookups, with and
+ *               without scans in between: hit ratio and lookups per second
+ *   ingest      registering and removing `--files` small documents one by one
+ *               vs. with the batch calls, in files per second
+ */
+#include "hw07.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+/** Minimum time every measurement runs for, set by `--min-time` */
+double min_seconds = 0.5;
+
+/** Keeps results alive, so the compiler can't drop the benchmarked work */
+std::atomic<size_t> sink;
+
+std::string file_name(size_t i) {
+  return "some/longer/directory/file_" + std::to_string(i) + ".txt";
+}
+
+/** Create a filesystem with `count` small documents */
+std::shared_ptr<Filesystem> make_filesystem(size_t count, size_t shards) {
+  auto fs = std::make_shared<Filesystem>(shards);
+  for (size_t i = 0; i < count; ++i) {
+	fs->register_file(file_name(i),
+	                  std::make_shared<Document>(FileContent{"content " + std::to_string(i)}));
+  }
+  return fs;
+}
+
+void bench_lookup(size_t max_files) {
+  std::printf("\n== lookup: get_file of present names, random order ==\n");
+  std::printf("%10s %12s\n", "files", "ns/lookup");
+  for (size_t count = 1000; count <= max_files; count *= 10) {
+	auto fs = make_filesystem(count, 1);
+
+	// look the names up in a random order, so the table isn't walked in cache
+	std::vector<std::string> names;
+	names.reserve(std::min<size_t>(count, 1 << 16));
+	std::mt19937 gen{42};
+	std::uniform_int_distribution<size_t> pick{0, count - 1};
+	for (size_t i = 0; i < names.capacity(); ++i) {
+	  names.push_back(file_name(pick(gen)));
+	}
+
+	size_t lookups = 0;
+	size_t found = 0;
+	const auto start = bench_clock::now();
+	auto elapsed = bench_clock::duration{};
+	do {
+	  for (auto &&name : names) {
+		found += fs->get_file(name) != nullptr;
+	  }
+	  lookups += names.size();
+	  elapsed = bench_clock::now() - start;
+	} while (elapsed < std::chrono::duration<double>(min_seconds));
+	sink += found;
+
+	std::printf("%10zu %12.1f\n", count,
+	            std::chrono::duration<double, std::nano>(elapsed).count() /
+	                static_cast<double>(lookups));
+  }
+}
+
+/**
+ * Run the mixed workload on `fs` from `threads` threads, return the
+ * operations per second. `lock` is called around every operation, to model
+ * an external mutex.
+ *
+ * Every thread owns the names `i` with `i % threads == thread`. Per 100
+ * operations, 90 look up random names, 5 rename one of the own files back
+ * and forth, and 5 remove one of them and register it again.
+ */
+template <typename Lock>
+double run_mixed(Filesystem &fs, size_t count, size_t threads, Lock &&lock) {
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> total{0};
+
+  auto worker = [&](size_t thread) {
+	std::mt19937 gen{static_cast<unsigned>(thread)};
+	std::uniform_int_distribution<size_t> pick{0, count - 1};
+	std::uniform_int_distribution<size_t> own{0, count / threads - 1};
+	size_t ops = 0;
+	size_t found = 0;
+	while (!stop.load(std::memory_order_relaxed)) {
+	  for (size_t op = 0; op < 100; ++op) {
+		if (op < 90) {
+		  const auto name = file_name(pick(gen));
+		  [[maybe_unused]] auto guard = lock();
+		  found += fs.get_file(name) != nullptr;
+		} else {
+		  const auto name = file_name(own(gen) * threads + thread);
+		  if (op < 95) {
+			[[maybe_unused]] auto guard = lock();
+			fs.rename_file(name, name + ".bak");
+			fs.rename_file(name + ".bak", name);
+		  } else {
+			[[maybe_unused]] auto guard = lock();
+			auto file = fs.get_file(name);
+			fs.remove_file(name);
+			fs.register_file(name, file);
+		  }
+		}
+	  }
+	  ops += 100;
+	}
+	total += ops;
+	sink += found;
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+	workers.emplace_back(worker, t);
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(min_seconds));
+  stop = true;
+  for (auto &&w : workers) {
+	w.join();
+  }
+  return static_cast<double>(total) / min_seconds;
+}
+
+void bench_concurrent(size_t count, size_t threads) {
+  std::printf("\n== concurrent: %zu files, 90%% lookups, 5%% renames, "
+              "5%% remove+register ==\n", count);
+  std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+  std::printf("%8s %16s %16s %16s\n", "threads", "ext. mutex Mop/s",
+              "1 shard Mop/s", "64 shards Mop/s");
+
+  auto single = make_filesystem(count, 1);
+  auto sharded = make_filesystem(count, 64);
+  std::mutex big_lock;
+  auto external = [&] { return std::unique_lock{big_lock}; };
+  auto internal = [] { return 0; };
+
+  for (size_t t = 1; t <= threads; t *= 2) {
+	const double locked = run_mixed(*single, count, t, external);
+	const double one = run_mixed(*single, count, t, internal);
+	const double many = run_mixed(*sharded, count, t, internal);
+	std::printf("%8zu %16.2f %16.2f %16.2f\n", t, locked * 1e-6, one * 1e-6,
+	            many * 1e-6);
+  }
+}
+
+#ifdef __GLIBC__
+/**
+ * Heap bytes handed out by malloc, and bytes taken from the system
+ * (including free chunks, i.e. fragmentation)
+ */
+struct HeapUse {
+  size_t in_use;
+  size_t footprint;
+};
+
+HeapUse heap_use() {
+  const auto info = mallinfo2();
+  return {info.uordblks + info.hblkhd, info.arena + info.hblkhd};
+}
+
+/**
+ * Create `count` documents with `length` bytes of content, then delete every
+ * second one, and print the heap bytes per document at both points.
+ * Runs in a child process, so every variant starts with a fresh heap.
+ */
+void measure_documents(const char *variant, size_t count, size_t length, bool pooled) {
+  std::fflush(stdout);
+  const pid_t child = fork();
+  if (child != 0) {
+	waitpid(child, nullptr, 0);
+	return;
+  }
+
+  std::vector<std::shared_ptr<File>> files(count);
+  const HeapUse before = heap_use();
+  for (size_t i = 0; i < count; ++i) {
+	std::string text = std::to_string(i);
+	text.resize(length, '.');
+	if (pooled) {
+	  files[i] = make_file<Document>(FileContent{std::move(text)});
+	} else {
+	  // the allocations before the slab pools: one for the file, and one for
+	  // the content string (plus one for its characters beyond 15 bytes)
+	  FileContent content;
+	  content.string_ = std::make_shared<std::string>(std::move(text));
+	  files[i] = std::make_shared<Document>(std::move(content));
+	}
+  }
+  const HeapUse full = heap_use();
+
+  for (size_t i = 0; i < count; i += 2) {
+	files[i] = nullptr;
+  }
+  const HeapUse half = heap_use();
+
+  const auto per_file = [&](size_t bytes, size_t files) {
+	return static_cast<double>(bytes) / static_cast<double>(files);
+  };
+  const size_t left = count - (count + 1) / 2;
+  std::printf("%8zu %12s %14.1f %14.1f %16.1f\n", length, variant,
+              per_file(full.in_use - before.in_use, count),
+              per_file(full.in_use - before.in_use, count) - static_cast<double>(length),
+              per_file(half.footprint - before.footprint, left));
+  std::fflush(stdout);
+  std::_Exit(0);
+}
+
+void bench_memory(size_t count) {
+  std::printf("\n== memory: %zu documents, heap bytes per document ==\n", count);
+  std::printf("%8s %12s %14s %14s %16s\n", "content", "allocation", "bytes/file",
+              "overhead/file", "half deleted*");
+  for (size_t length : {12, 20, 40}) {
+	measure_documents("make_shared", count, length, false);
+	measure_documents("slab pools", count, length, true);
+  }
+  std::printf("* heap taken from the system per remaining document, after "
+              "deleting every second one\n");
+}
+#else
+void bench_memory(size_t) {
+  std::printf("\n== memory: needs glibc's mallinfo2, skipped ==\n");
+}
+#endif
+
+/** Some text that compresses like prose, `length` bytes */
+std::string make_text(size_t length, std::mt19937 &gen) {
+  static const std::vector<std::string> words{
+	  "the", "file", "system", "stores", "a", "document", "with", "some",
+	  "content", "and", "its", "name", "size", "of", "compressed", "data"};
+  std::uniform_int_distribution<size_t> pick{0, words.size() - 1};
+  std::string text;
+  while (text.size() < length) {
+	text += words[pick(gen)];
+	text += text.size() % 80 < 70 ? ' ' : '\n';
+  }
+  text.resize(length);
+  return text;
+}
+
+void bench_compression(size_t count) {
+  std::printf("\n== compression: %zu text documents ==\n", count);
+  std::printf("%8s %14s %14s %14s %14s\n", "raw", "stored/file", "ratio",
+              "get miss ns", "get hit ns");
+
+  for (size_t length : {256, 2048, 16384}) {
+	std::mt19937 gen{42};
+	auto fs = std::make_shared<Filesystem>();
+	std::vector<std::shared_ptr<File>> files;
+	const size_t n = std::max<size_t>(1, std::min(count, (size_t{64} << 20) / length));
+	for (size_t i = 0; i < n; ++i) {
+	  files.push_back(make_file<Document>(FileContent{make_text(length, gen)}));
+	  fs->register_file(file_name(i), files.back());
+	}
+	const double stored = static_cast<double>(fs->in_use()) / static_cast<double>(n);
+
+	// cycle through more content than the cache holds, so every get misses
+	auto &cache = DecompressionCache::instance();
+	cache.set_capacity(0);
+	size_t gets = 0;
+	auto start = bench_clock::now();
+	auto elapsed = bench_clock::duration{};
+	do {
+	  sink += files[gets % n]->get_content().get()->size();
+	  gets += 1;
+	  elapsed = bench_clock::now() - start;
+	} while (elapsed < std::chrono::duration<double>(min_seconds));
+	const double miss = std::chrono::duration<double, std::nano>(elapsed).count() /
+	                    static_cast<double>(gets);
+
+	// the same file again and again hits the cache
+	cache.set_capacity(size_t{4} << 20);
+	gets = 0;
+	start = bench_clock::now();
+	do {
+	  for (int i = 0; i < 1000; ++i) {
+		sink += files[0]->get_content().get()->size();
+	  }
+	  gets += 1000;
+	  elapsed = bench_clock::now() - start;
+	} while (elapsed < std::chrono::duration<double>(min_seconds));
+	const double hit = std::chrono::duration<double, std::nano>(elapsed).count() /
+	                   static_cast<double>(gets);
+
+	std::printf("%8zu %14.1f %14.2f %14.1f %14.1f\n", length, stored,
+	            static_cast<double>(length) / stored, miss, hit);
+  }
+  std::printf("codec for documents: %s\n",
+              codec_available(Codec::deflate) ? "deflate" : "lz4 (built without zlib)");
+}
+
+double seconds_since(bench_clock::time_point start) {
+  return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+void bench_snapshot(size_t count) {
+  std::printf("\n== snapshot: %zu text documents of 1 KiB ==\n", count);
+  const std::string path =
+	  (std::filesystem::temp_directory_path() / "fs_bench.snapshot").string();
+
+  // the texts are made up front, building only measures the filesystem
+  std::mt19937 gen{42};
+  std::vector<std::string> texts;
+  texts.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+	texts.push_back(make_text(1024, gen));
+  }
+
+  auto start = bench_clock::now();
+  auto fs = std::make_shared<Filesystem>();
+  for (size_t i = 0; i < count; ++i) {
+	fs->register_file(file_name(i), make_file<Document>(FileContent{std::move(texts[i])}));
+  }
+  const double build = seconds_since(start);
+  texts = {};
+
+  start = bench_clock::now();
+  save_snapshot(*fs, path);
+  const double save = seconds_since(start);
+  const size_t logical = fs->in_use();
+  fs = nullptr;
+
+  start = bench_clock::now();
+  fs = load_snapshot(path);
+  const double load = seconds_since(start);
+
+  // the contents are paged in from the snapshot on first use
+  start = bench_clock::now();
+  size_t read = 0;
+  for (size_t i = 0; i < count; ++i) {
+	read += fs->get_file(file_name(i))->get_content().stored().back();
+  }
+  sink += read;
+  const double touch = seconds_since(start);
+
+  std::printf("%-32s %10.3f s\n", "build from scratch", build);
+  std::printf("%-32s %10.3f s\n", "save snapshot", save);
+  std::printf("%-32s %10.3f s\n", "load snapshot", load);
+  std::printf("%-32s %10.3f s\n", "touch every loaded content", touch);
+  std::printf("snapshot size %.1f MiB, %.1f MiB of stored contents\n",
+              static_cast<double>(std::filesystem::file_size(path)) / (1 << 20),
+              static_cast<double>(logical) / (1 << 20));
+  fs = nullptr;
+  std::filesystem::remove(path);
+}
+
+/**
+ * Register, rename and remove small documents from `threads` threads for
+ * `min_seconds`, return the mutations per second.
+ */
+double run_mutations(Filesystem &fs, size_t threads) {
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> total{0};
+  auto worker = [&](size_t thread) {
+	size_t ops = 0;
+	for (size_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+	  const auto name = file_name(i * threads + thread);
+	  fs.register_file(name, make_file<Document>(FileContent{"content " + name}));
+	  fs.rename_file(name, name + ".bak");
+	  fs.remove_file(name + ".bak");
+	  ops += 3;
+	}
+	total += ops;
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+	workers.emplace_back(worker, t);
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(min_seconds));
+  stop = true;
+  for (auto &&w : workers) {
+	w.join();
+  }
+  return static_cast<double>(total) / min_seconds;
+}
+
+void bench_wal(size_t threads) {
+  std::printf("\n== wal: register, rename and remove of small documents ==\n");
+  std::printf("%-12s %8s %14s %12s\n", "durability", "threads", "mutations/s", "per fsync");
+  const auto directory = std::filesystem::temp_directory_path() / "fs_bench_wal";
+
+  for (size_t t : {size_t{1}, threads}) {
+	auto plain = std::make_shared<Filesystem>(64);
+	std::printf("%-12s %8zu %14.0f %12s\n", "no log", t, run_mutations(*plain, t), "-");
+
+	using Durability = WriteAheadLog::Durability;
+	for (auto [durability, label] : {std::pair{Durability::buffered, "buffered"},
+	                                 std::pair{Durability::group, "group"},
+	                                 std::pair{Durability::sync, "sync"}}) {
+	  std::filesystem::remove_all(directory);
+	  WriteAheadLog::Options options;
+	  options.durability = durability;
+	  options.shards = 64;
+	  auto fs = WriteAheadLog::open(directory.string(), options);
+	  const double rate = run_mutations(*fs, t);
+	  fs->get_log()->sync();
+	  const auto stats = fs->get_log()->get_stats();
+	  std::printf("%-12s %8zu %14.0f %12.1f\n", label, t, rate,
+	              static_cast<double>(stats.logged) / static_cast<double>(std::max<size_t>(stats.commits, 1)));
+	}
+  }
+  std::filesystem::remove_all(directory);
+}
+
+/** Run `fn` repeatedly for at least `min_seconds`, return the microseconds per run */
+template <typename Fn>
+double time_us(Fn &&fn) {
+  size_t runs = 0;
+  const auto start = bench_clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+	sink += fn();
+	runs += 1;
+	elapsed = bench_clock::now() - start;
+  } while (elapsed.count() < min_seconds);
+  return elapsed.count() * 1e6 / static_cast<double>(runs);
+}
+
+void bench_directories(size_t files) {
+  std::printf("\n== directories: %zu files in 1000 directories ==\n", files);
+  const size_t directories = 1000;
+  auto fs = std::make_shared<Filesystem>();
+  fs->reserve(files);
+  for (size_t i = 0; i < files; ++i) {
+	fs->register_file("dir_" + std::to_string(i % directories) + "/file_" + std::to_string(i) + ".txt",
+	                  make_file<Document>(FileContent{"content " + std::to_string(i)}));
+  }
+
+  // what listing cost before: visit every file, keep the ones with the prefix
+  const std::string prefix = "dir_42/";
+  const auto scan = [&] {
+	size_t count = 0;
+	size_t bytes = 0;
+	fs->visit_files_in_size_range(std::numeric_limits<size_t>::max(), 0,
+	                              [&](const std::shared_ptr<File> &file) {
+	  if (file->get_name().starts_with(prefix)) {
+		count += 1;
+		bytes += file->get_size();
+	  }
+	});
+	return count + bytes;
+  };
+
+  std::printf("%-28s %14s\n", "operation", "us");
+  std::printf("%-28s %14.2f\n", "list by scanning all names", time_us(scan));
+  std::printf("%-28s %14.2f\n", "list_dir", time_us([&] { return fs->list_dir("dir_42").size(); }));
+  std::printf("%-28s %14.2f\n", "get_dir_stats", time_us([&] { return fs->get_dir_stats("dir_42").bytes; }));
+
+  size_t renames = 0;
+  std::printf("%-28s %14.2f\n", "rename_dir", time_us([&] {
+	const auto source = "dir_42" + std::string(renames, 'x');
+	renames += 1;
+	return static_cast<size_t>(fs->rename_dir(source, source + "x"));
+  }));
+}
+
+/** heap bytes in use, 0 if that can't be measured */
+size_t heap_in_use() {
+#ifdef __GLIBC__
+  return heap_use().in_use;
+#else
+  return 0;
+#endif
+}
+
+void bench_streaming() {
+  const size_t size = size_t{256} << 20;
+  std::printf("\n== streaming: lines of a %zu MiB file mapped as content ==\n", size >> 20);
+  const auto path = (std::filesystem::temp_directory_path() / "fs_bench_streaming").string();
+  {
+	std::mt19937 gen{42};
+	const std::string text = make_text(1 << 20, gen);
+	std::ofstream out{path, std::ios::binary | std::ios::trunc};
+	for (size_t written = 0; written < size; written += text.size()) {
+	  out << text;
+	}
+  }
+  const auto content = map_file_content(path);
+
+  std::printf("%-20s %10s %12s\n", "read through", "GB/s", "heap MiB");
+  const auto run = [&](const char *label, auto &&count_lines) {
+	const size_t heap_before = heap_in_use();
+	size_t heap_peak = heap_before;
+	const auto start = bench_clock::now();
+	sink += count_lines(heap_peak);
+	const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	std::printf("%-20s %10.2f %12.1f\n", label,
+	            static_cast<double>(content.get_size()) / elapsed.count() / 1e9,
+	            static_cast<double>(heap_peak - heap_before) / (1 << 20));
+  };
+  // the chunks first, so the pages are read from the file once for both
+  run("chunks()", [&](size_t &heap_peak) {
+	size_t lines = 0;
+	for (std::string_view chunk : content.chunks()) {
+	  lines += static_cast<size_t>(std::count(chunk.begin(), chunk.end(), '\n'));
+	}
+	heap_peak = heap_in_use();
+	return lines;
+  });
+  run("get()", [&](size_t &heap_peak) {
+	const auto data = content.get();
+	heap_peak = heap_in_use();
+	return static_cast<size_t>(std::count(data->begin(), data->end(), '\n'));
+  });
+  std::filesystem::remove(path);
+}
+
+void bench_versions() {
+  const size_t edits = 100;
+  std::printf("\n== versions: %zu small edits to a 1 MiB document ==\n", edits);
+  std::mt19937 gen{42};
+  std::string text = make_text(1 << 20, gen);
+  auto doc = make_file<Document>(FileContent{text});
+  doc->keep_versions({edits, size_t{1} << 30});
+  auto fs = std::make_shared<Filesystem>();
+  fs->register_file("versioned.txt", doc);
+
+  std::uniform_int_distribution<size_t> position{0, text.size()};
+  size_t copies = 0;
+  const auto start = bench_clock::now();
+  for (size_t i = 0; i < edits; ++i) {
+	copies += text.size();
+	text.insert(position(gen), "edit " + std::to_string(i));
+	doc->update(FileContent{text});
+  }
+  const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+
+  std::printf("%-28s %12.1f\n", "whole copies, MiB", static_cast<double>(copies) / (1 << 20));
+  std::printf("%-28s %12.1f\n", "history blocks, MiB",
+              static_cast<double>(doc->get_history()->stored_bytes()) / (1 << 20));
+  std::printf("%-28s %12.2f\n", "ms per update", elapsed.count() * 1e3 / edits);
+}
+
+void bench_eviction() {
+  const size_t count = 10'000;
+  const size_t size = 4096;
+  const size_t lookups = 200'000;
+  std::printf("\n== eviction: %zu files of %zu bytes, Zipf(0.99) lookups ==\n", count, size);
+
+  // incompressible contents, so the budget holds what it says
+  std::mt19937_64 gen{42};
+  const auto random_content = [&] {
+	std::string data(size, '\0');
+	for (size_t i = 0; i < size; i += 8) {
+	  const uint64_t value = gen();
+	  std::memcpy(data.data() + i, &value, 8);
+	}
+	return data;
+  };
+
+  // the popularity of the files falls with their rank, 1 / rank^0.99
+  std::vector<double> cumulative(count);
+  double sum = 0;
+  for (size_t i = 0; i < count; ++i) {
+	sum += 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+	cumulative[i] = sum;
+  }
+  std::uniform_real_distribution<double> uniform{0, sum};
+  std::vector<std::string> names(lookups);
+  for (auto &name : names) {
+	const auto rank = std::lower_bound(cumulative.begin(), cumulative.end(), uniform(gen)) - cumulative.begin();
+	// the popular files are spread over the names
+	name = file_name(static_cast<size_t>(rank) * 7919 % count);
+  }
+
+  std::printf("%-24s %10s %10s %12s\n", "budget", "scans", "hit ratio", "lookups/s");
+  for (const bool budget : {false, true}) {
+	for (const bool scans : {false, true}) {
+	  auto fs = std::make_shared<Filesystem>();
+	  for (size_t i = 0; i < count; ++i) {
+		fs->register_file(file_name(i), make_file<Image>(FileContent{random_content()},
+		                                                 Image::resolution_t{32, 32}));
+	  }
+	  if (budget) {
+		fs->set_memory_budget(count * size / 10);
+	  }
+	  const auto start = bench_clock::now();
+	  for (size_t i = 0; i < lookups; ++i) {
+		sink += fs->get_file(names[i]) != nullptr;
+		if (budget && i % 100 == 99) {
+		  fs->apply_memory_budget();
+		}
+		if (scans && i % 20'000 == 0) {
+		  // a scan over a tenth of the files, each used once
+		  for (size_t j = 0; j < count / 10; ++j) {
+			sink += fs->get_file(file_name((i + j * 10) % count)) != nullptr;
+		  }
+		}
+	  }
+	  const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	  const auto stats = fs->get_eviction_stats();
+	  const double accesses = static_cast<double>(stats.hits + stats.misses);
+	  std::printf("%-24s %10s %10.3f %12.0f\n", budget ? "10% of the contents" : "none",
+	              scans ? "yes" : "no",
+	              budget ? static_cast<double>(stats.hits) / accesses : 1.0,
+	              static_cast<double>(lookups) / elapsed.count());
+	}
+  }
+}
+
+} // namespace
+
+enum class Ingest { one_by_one, reserved, batch };
+
+/**
+ * Register `count` small documents into an empty filesystem, then remove
+ * them again, and print the files per second of both. Runs in a child
+ * process, so every variant starts with a fresh heap.
+ */
+void measure_ingest(const char *variant, size_t count, Ingest how) {
+  std::fflush(stdout);
+  const pid_t child = fork();
+  if (child != 0) {
+	waitpid(child, nullptr, 0);
+	return;
+  }
+
+  // the files are made up front, only the filesystem is measured
+  std::vector<std::pair<std::string, std::shared_ptr<File>>> files;
+  std::vector<std::string> names;
+  files.reserve(count);
+  names.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+	files.emplace_back(file_name(i), make_file<Document>(FileContent{"content " + std::to_string(i)}));
+	names.push_back(file_name(i));
+  }
+
+  auto fs = std::make_shared<Filesystem>();
+  size_t done = 0;
+  auto start = bench_clock::now();
+  if (how == Ingest::batch) {
+	const auto registered = fs->register_files(files);
+	done += static_cast<size_t>(std::count(registered.begin(), registered.end(), true));
+  } else {
+	if (how == Ingest::reserved) {
+	  fs->reserve(count);
+	}
+	for (auto &&[name, file] : files) {
+	  done += fs->register_file(name, file);
+	}
+  }
+  const double registering = seconds_since(start);
+
+  start = bench_clock::now();
+  if (how == Ingest::batch) {
+	const auto removed = fs->remove_files(names);
+	done += static_cast<size_t>(std::count(removed.begin(), removed.end(), true));
+  } else {
+	for (auto &&name : names) {
+	  done += fs->remove_file(name);
+	}
+  }
+  const double removing = seconds_since(start);
+  sink += done;
+
+  const auto rate = [&](double seconds) { return static_cast<double>(count) / seconds; };
+  std::printf("%-30s %14.0f %14.0f\n", variant, rate(registering), rate(removing));
+  std::fflush(stdout);
+  std::_Exit(0);
+}
+
+void bench_ingest(size_t count) {
+  std::printf("\n== ingest: %zu small documents into an empty filesystem ==\n", count);
+  std::printf("%-30s %14s %14s\n", "", "register/s", "remove/s");
+  measure_ingest("one by one", count, Ingest::one_by_one);
+  measure_ingest("reserve, one by one", count, Ingest::reserved);
+  measure_ingest("register_files, remove_files", count, Ingest::batch);
+}
+
+int main(int argc, char *argv[]) {
+  size_t files = 1'000'000;
+  size_t threads = std::max(4u, std::thread::hardware_concurrency());
+  std::vector<std::string_view> sections;
+  for (int i = 1; i < argc; ++i) {
+	const std::string_view arg = argv[i];
+	if ((arg == "--files" || arg == "--threads" || arg == "--min-time") && i + 1 == argc) {
+	  std::fprintf(stderr, "%s needs a value\n", argv[i]);
+	  return 1;
+	}
+	if (arg == "--files") {
+	  files = static_cast<size_t>(std::strtod(argv[++i], nullptr));
+	} else if (arg == "--threads") {
+	  threads = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+	} else if (arg == "--min-time") {
+	  min_seconds = std::strtod(argv[++i], nullptr);
+	} else {
+	  sections.push_back(arg);
+	}
+  }
+  const auto wanted = [&](std::string_view section) {
+	return sections.empty() ||
+	       std::find(sections.begin(), sections.end(), section) != sections.end();
+  };
+
+  if (wanted("lookup")) {
+	bench_lookup(files);
+  }
+  if (wanted("concurrent")) {
+	bench_concurrent(std::min<size_t>(files, 100'000), threads);
+  }
+  if (wanted("memory")) {
+	bench_memory(files);
+  }
+  if (wanted("compression")) {
+	bench_compression(files);
+  }
+  if (wanted("snapshot")) {
+	bench_snapshot(files);
+  }
+  if (wanted("wal")) {
+	bench_wal(threads);
+  }
+  if (wanted("directories")) {
+	bench_directories(files);
+  }
+  if (wanted("streaming")) {
+	bench_streaming();
+  }
+  if (wanted("versions")) {
+	bench_versions();
+  }
+  if (wanted("eviction")) {
+	bench_eviction();
+  }
+  if (wanted("ingest")) {
+	bench_ingest(files);
+  }
+  return 0;
+}
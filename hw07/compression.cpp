@@ -0,0 +1,317 @@
+#include "compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifdef HW07_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+/*
+ * LZ4 block format, see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+ *
+ * A block is a series of sequences: a token byte (high nibble: literal
+ * count, low nibble: match length - 4, 15 means more length bytes follow),
+ * the literals, a 2 byte little endian match offset and the extra match
+ * length bytes. The last sequence only has literals.
+ */
+
+constexpr size_t min_match = 4;
+/** the last bytes are always literals */
+constexpr size_t last_literals = 5;
+/** no match may start within the last bytes */
+constexpr size_t match_limit = 12;
+constexpr size_t max_offset = 65535;
+constexpr int hash_bits = 12;
+
+uint32_t read32(const char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint32_t hash4(uint32_t v) {
+  return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+/** append a length continuation: bytes of 255 and the rest */
+void put_length(std::string &out, size_t length) {
+  for (; length >= 255; length -= 255) {
+	out.push_back(static_cast<char>(255));
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+void put_sequence(std::string &out, const char *literals, size_t literal_count,
+                  size_t offset, size_t match_length) {
+  const size_t lit_nibble = std::min<size_t>(literal_count, 15);
+  const size_t match_nibble = match_length == 0 ? 0 : std::min<size_t>(match_length - min_match, 15);
+  out.push_back(static_cast<char>((lit_nibble << 4) | match_nibble));
+  if (lit_nibble == 15) {
+	put_length(out, literal_count - 15);
+  }
+  out.append(literals, literal_count);
+  if (match_length == 0) {
+	// the last sequence
+	return;
+  }
+  out.push_back(static_cast<char>(offset & 0xff));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (match_nibble == 15) {
+	put_length(out, match_length - min_match - 15);
+  }
+}
+
+std::string lz4_compress(std::string_view raw) {
+  const char *const base = raw.data();
+  const size_t n = raw.size();
+  std::string out;
+  out.reserve(n / 2);
+
+  size_t anchor = 0;
+  if (n >= match_limit + 1) {
+	// positions + 1 of the last 4 byte sequence with each hash, 0 is none
+	std::vector<uint32_t> table(size_t{1} << hash_bits, 0);
+	const size_t limit = n - match_limit;
+	const size_t match_end = n - last_literals;
+
+	size_t ip = 0;
+	while (ip < limit) {
+	  const uint32_t sequence = read32(base + ip);
+	  const uint32_t h = hash4(sequence);
+	  const size_t candidate = table[h];
+	  table[h] = static_cast<uint32_t>(ip + 1);
+
+	  if (candidate == 0 || ip - (candidate - 1) > max_offset ||
+	      read32(base + candidate - 1) != sequence) {
+		ip += 1;
+		continue;
+	  }
+
+	  const size_t ref = candidate - 1;
+	  size_t length = min_match;
+	  while (ip + length < match_end && base[ip + length] == base[ref + length]) {
+		length += 1;
+	  }
+	  put_sequence(out, base + anchor, ip - anchor, ip - ref, length);
+	  ip += length;
+	  anchor = ip;
+	}
+  }
+  put_sequence(out, base + anchor, n - anchor, 0, 0);
+  return out;
+}
+
+std::string lz4_decompress(std::string_view data, size_t raw_size) {
+  const auto corrupt = [] {
+	throw std::runtime_error("corrupt lz4 data");
+  };
+
+  std::string out(raw_size, '\0');
+  const auto *ip = reinterpret_cast<const unsigned char *>(data.data());
+  const auto *const end = ip + data.size();
+  size_t op = 0;
+
+  // a length nibble of 15 is continued by the following bytes
+  const auto read_length = [&](size_t length) {
+	if (length == 15) {
+	  unsigned char byte;
+	  do {
+		if (ip == end) {
+		  corrupt();
+		}
+		byte = *ip++;
+		length += byte;
+	  } while (byte == 255);
+	}
+	return length;
+  };
+
+  while (ip < end) {
+	const unsigned char token = *ip++;
+
+	const size_t literals = read_length(token >> 4);
+	if (literals > static_cast<size_t>(end - ip) || literals > raw_size - op) {
+	  corrupt();
+	}
+	std::memcpy(out.data() + op, ip, literals);
+	ip += literals;
+	op += literals;
+	if (ip == end) {
+	  break;
+	}
+
+	if (end - ip < 2) {
+	  corrupt();
+	}
+	const size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+	ip += 2;
+	const size_t length = read_length(token & 15u) + min_match;
+	if (offset == 0 || offset > op || length > raw_size - op) {
+	  corrupt();
+	}
+	if (offset >= length) {
+	  std::memcpy(out.data() + op, out.data() + op - offset, length);
+	  op += length;
+	} else {
+	  // the match overlaps the bytes it produces
+	  for (size_t i = 0; i < length; ++i, ++op) {
+		out[op] = out[op - offset];
+	  }
+	}
+  }
+
+  if (op != raw_size) {
+	corrupt();
+  }
+  return out;
+}
+
+#ifdef HW07_HAVE_ZLIB
+std::string deflate_compress(std::string_view raw) {
+  uLongf size = compressBound(static_cast<uLong>(raw.size()));
+  std::string out(size, '\0');
+  if (compress2(reinterpret_cast<Bytef *>(out.data()), &size,
+                reinterpret_cast<const Bytef *>(raw.data()),
+                static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) != Z_OK) {
+	return {};
+  }
+  out.resize(size);
+  return out;
+}
+
+std::string deflate_decompress(std::string_view data, size_t raw_size) {
+  std::string out(raw_size, '\0');
+  uLongf size = static_cast<uLongf>(raw_size);
+  if (uncompress(reinterpret_cast<Bytef *>(out.data()), &size,
+                 reinterpret_cast<const Bytef *>(data.data()),
+                 static_cast<uLong>(data.size())) != Z_OK ||
+      size != raw_size) {
+	throw std::runtime_error("corrupt deflate data");
+  }
+  return out;
+}
+#endif
+
+} // namespace
+
+bool codec_available(Codec codec) {
+  switch (codec) {
+  case Codec::none:
+  case Codec::lz4:
+	return true;
+  case Codec::deflate:
+#ifdef HW07_HAVE_ZLIB
+	return true;
+#else
+	return false;
+#endif
+  }
+  return false;
+}
+
+std::string compress(std::string_view raw, Codec codec) {
+  if (codec == Codec::none || !codec_available(codec)) {
+	return {};
+  }
+
+  std::string compressed;
+#ifdef HW07_HAVE_ZLIB
+  if (codec == Codec::deflate) {
+	compressed = deflate_compress(raw);
+  }
+#endif
+  if (codec == Codec::lz4) {
+	compressed = lz4_compress(raw);
+  }
+
+  if (compressed.empty() || compressed.size() >= raw.size()) {
+	return {};
+  }
+  compressed.shrink_to_fit();
+  return compressed;
+}
+
+std::string decompress(std::string_view data, Codec codec, size_t raw_size) {
+  switch (codec) {
+  case Codec::none:
+	return std::string{data};
+  case Codec::lz4:
+	return lz4_decompress(data, raw_size);
+  case Codec::deflate:
+#ifdef HW07_HAVE_ZLIB
+	return deflate_decompress(data, raw_size);
+#else
+	break;
+#endif
+  }
+  throw std::runtime_error("codec not available");
+}
+
+
+DecompressionCache &DecompressionCache::instance() {
+  static DecompressionCache cache;
+  return cache;
+}
+
+DecompressionCache::DecompressionCache(size_t capacity) : capacity{capacity} {}
+
+std::shared_ptr<const std::string>
+DecompressionCache::get(const std::shared_ptr<const char> &data, size_t size,
+                        Codec codec, size_t raw_size) {
+  {
+	std::lock_guard lock{mutex};
+	auto it = index.find(data.get());
+	if (it != index.end()) {
+	  if (it->second->source.lock() == data) {
+		hits += 1;
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->content;
+	  }
+	  // the compressed data was freed and its address reused
+	  bytes -= it->second->content->size();
+	  lru.erase(it->second);
+	  index.erase(it);
+	}
+	misses += 1;
+  }
+
+  // decompress without holding the lock
+  auto content = std::make_shared<const std::string>(
+	  decompress(std::string_view{data.get(), size}, codec, raw_size));
+
+  std::lock_guard lock{mutex};
+  if (content->size() > capacity || index.count(data.get()) != 0) {
+	// too large, or another thread was faster
+	return content;
+  }
+  lru.push_front({data.get(), data, content});
+  index.emplace(data.get(), lru.begin());
+  bytes += content->size();
+  shrink();
+  return content;
+}
+
+void DecompressionCache::set_capacity(size_t new_capacity) {
+  std::lock_guard lock{mutex};
+  capacity = new_capacity;
+  shrink();
+}
+
+DecompressionCache::Stats DecompressionCache::get_stats() const {
+  std::lock_guard lock{mutex};
+  return {hits, misses, bytes};
+}
+
+void DecompressionCache::shrink() {
+  while (bytes > capacity) {
+	const Entry &oldest = lru.back();
+	bytes -= oldest.content->size();
+	index.erase(oldest.key);
+	lru.pop_back();
+  }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+/**
+ * Compression formats of stored file contents.
+ */
+enum class Codec : uint8_t {
+  /** stored as is */
+  none = 0,
+  /** LZ4 block format: fast, moderate ratio */
+  lz4 = 1,
+  /** zlib deflate: slower, better ratio. LZ4 is used if zlib is missing. */
+  deflate = 2,
+};
+
+/**
+ * Contents smaller than this are never compressed,
+ * the few bytes saved aren't worth decompressing them.
+ */
+constexpr size_t min_compress_size = 64;
+
+/**
+ * Can `codec` be used in this build?
+ */
+bool codec_available(Codec codec);
+
+/**
+ * Compress `raw` with `codec`.
+ *
+ * @return the compressed bytes, or an empty string if `codec` is none,
+ *         unavailable, or doesn't make the content smaller.
+ */
+std::string compress(std::string_view raw, Codec codec);
+
+/**
+ * Decompress `data`, which `compress` made from `raw_size` bytes.
+ * Throws std::runtime_error if the data is corrupt.
+ */
+std::string decompress(std::string_view data, Codec codec, size_t raw_size);
+
+
+/**
+ * Cache of decompressed contents, least recently used ones are dropped
+ * once the cache holds more than its capacity.
+ *
+ * Contents are identified by their compressed storage, so all files sharing
+ * it share the decompressed copy as well.
+ *
+ * All member functions are thread-safe.
+ */
+class DecompressionCache {
+public:
+  /** default capacity in decompressed bytes */
+  static constexpr size_t default_capacity = 4 << 20;
+
+  /**
+   * Get the global cache.
+   */
+  static DecompressionCache &instance();
+
+  explicit DecompressionCache(size_t capacity = default_capacity);
+
+  /**
+   * Get the decompressed content of the `size` bytes at `data`, from the
+   * cache if possible. `data` keeps the compressed bytes alive, it may point
+   * into a string or into a mapped snapshot.
+   */
+  std::shared_ptr<const std::string>
+  get(const std::shared_ptr<const char> &data, size_t size, Codec codec, size_t raw_size);
+
+  /**
+   * Change the capacity in decompressed bytes, 0 disables the cache.
+   */
+  void set_capacity(size_t new_capacity);
+
+  struct Stats {
+    size_t hits;
+    size_t misses;
+    /** decompressed bytes held */
+    size_t bytes;
+  };
+
+  Stats get_stats() const;
+
+private:
+  struct Entry {
+    /** address of the compressed data, the key in `index` */
+    const char *key;
+    /** identifies the compressed data, whose address may be reused later */
+    std::weak_ptr<const char> source;
+    std::shared_ptr<const std::string> content;
+  };
+
+  /** drop the least recently used entries until at most `capacity` bytes are left */
+  void shrink();
+
+  mutable std::mutex mutex;
+  size_t capacity;
+  size_t bytes = 0;
+  size_t hits = 0;
+  size_t misses = 0;
+
+  /** most recently used first */
+  std::list<Entry> lru;
+  std::unordered_map<const char *, std::list<Entry>::iterator> index;
+};
@@ -0,0 +1,96 @@
+#include "contentstore.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "hash.h"
+
+ContentStore &ContentStore::instance() {
+  static ContentStore store;
+  return store;
+}
+
+std::shared_ptr<const std::string>
+ContentStore::intern(std::shared_ptr<const std::string> content) {
+  if (content == nullptr) {
+	return content;
+  }
+
+  const uint64_t hash = xxh64(*content);
+  Stripe &stripe = stripes[hash >> (64 - stripe_bits)];
+  std::lock_guard lock{stripe.mutex};
+  return stripe.intern(hash, std::move(content));
+}
+
+void ContentStore::intern(std::span<std::shared_ptr<const std::string>> contents) {
+  // sort the contents by stripe once, identical ones stay in order
+  std::vector<uint64_t> hashes(contents.size());
+  std::vector<size_t> order;
+  order.reserve(contents.size());
+  for (size_t i = 0; i < contents.size(); ++i) {
+	if (contents[i] != nullptr) {
+	  hashes[i] = xxh64(*contents[i]);
+	  order.push_back(i);
+	}
+  }
+  const auto stripe_of = [&](size_t i) { return hashes[i] >> (64 - stripe_bits); };
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return stripe_of(a) < stripe_of(b); });
+
+  for (auto group = order.begin(); group != order.end();) {
+	const uint64_t index = stripe_of(*group);
+	const auto group_end = std::find_if(group, order.end(),
+	                                    [&](size_t i) { return stripe_of(i) != index; });
+	Stripe &stripe = stripes[index];
+	std::lock_guard lock{stripe.mutex};
+	// grow at most once for the group, but at least double like inserting
+	const size_t needed = stripe.entries.size() + static_cast<size_t>(group_end - group);
+	if (static_cast<float>(needed) > stripe.entries.max_load_factor() *
+	                                 static_cast<float>(stripe.entries.bucket_count())) {
+	  stripe.entries.reserve(std::max(needed, 2 * stripe.entries.size()));
+	}
+	for (; group != group_end; ++group) {
+	  contents[*group] = stripe.intern(hashes[*group], std::move(contents[*group]));
+	}
+  }
+}
+
+size_t ContentStore::size() {
+  size_t count = 0;
+  for (auto &&stripe : stripes) {
+	std::lock_guard lock{stripe.mutex};
+	stripe.prune();
+	count += stripe.entries.size();
+  }
+  return count;
+}
+
+std::shared_ptr<const std::string>
+ContentStore::Stripe::intern(uint64_t hash, std::shared_ptr<const std::string> content) {
+  auto [it, end] = entries.equal_range(hash);
+  while (it != end) {
+	auto stored = it->second.lock();
+	if (stored == nullptr) {
+	  // freed meanwhile
+	  it = entries.erase(it);
+	  continue;
+	}
+	if (stored == content || *stored == *content) {
+	  return stored;
+	}
+	++it;
+  }
+
+  entries.emplace(hash, content);
+
+  // amortized cleanup of the contents no one refers to anymore
+  if (entries.size() >= next_prune) {
+	prune();
+	next_prune = std::max<size_t>(1024, 2 * entries.size());
+  }
+  return content;
+}
+
+void ContentStore::Stripe::prune() {
+  std::erase_if(entries, [](const auto &entry) { return entry.second.expired(); });
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+
+/**
+ * Process-wide store of file contents, addressed by their hash.
+ *
+ * Registering a file interns its content here: if a content with the same
+ * bytes is already alive, the file is switched over to that copy and its own
+ * one is released. Identical contents are therefore stored only once,
+ * across all filesystems. The contents are const: a write through one of
+ * the files would change all others, and leave the content's hash stale.
+ *
+ * The store only keeps weak references, the files holding a content are its
+ * reference count. A content is freed as soon as the last file (or other
+ * handle) drops it; its stale entry is pruned lazily, and keeps the small
+ * allocation with the reference counts alive until then.
+ *
+ * All member functions are thread-safe. The entries are split into stripes
+ * by hash, each with its own lock, so concurrent interning of different
+ * contents rarely waits.
+ */
+class ContentStore {
+public:
+  /**
+   * Get the global store.
+   */
+  static ContentStore &instance();
+
+  ContentStore() = default;
+  ContentStore(const ContentStore &) = delete;
+  ContentStore &operator=(const ContentStore &) = delete;
+
+  /**
+   * Return the stored content with the same bytes as `content`.
+   * If there is none, `content` itself becomes the stored one.
+   *
+   * Hash collisions are resolved by comparing the bytes.
+   */
+  std::shared_ptr<const std::string> intern(std::shared_ptr<const std::string> content);
+
+  /**
+   * Intern many contents, like `intern` for each one in turn: every one is
+   * replaced by the stored content with the same bytes. Each stripe is
+   * locked once, and its table grows once for all of its contents.
+   */
+  void intern(std::span<std::shared_ptr<const std::string>> contents);
+
+  /**
+   * How many distinct contents are alive?
+   */
+  size_t size();
+
+private:
+  struct alignas(64) Stripe {
+    std::mutex mutex;
+    std::unordered_multimap<uint64_t, std::weak_ptr<const std::string>> entries;
+
+    /** entry count which triggers the next full prune */
+    size_t next_prune = 1024;
+
+    /** drop the entries of freed contents, the mutex must be held */
+    void prune();
+
+    /** `intern` with the mutex held */
+    std::shared_ptr<const std::string> intern(uint64_t hash,
+                                              std::shared_ptr<const std::string> content);
+  };
+
+  /** number of stripes, chosen by the upper bits of the hash */
+  static constexpr size_t stripe_bits = 4;
+
+  std::array<Stripe, size_t{1} << stripe_bits> stripes;
+};
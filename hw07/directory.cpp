@@ -0,0 +1,127 @@
+#include "directory.h"
+
+namespace {
+
+/** split a file name at its last '/' into the directory and the name in it */
+std::pair<std::string_view, std::string_view> split(std::string_view name) {
+  const size_t slash = name.rfind('/');
+  if (slash == std::string_view::npos) {
+	return {{}, name};
+  }
+  return {name.substr(0, slash), name.substr(slash + 1)};
+}
+
+/** take the first part off a directory path */
+std::string_view next_part(std::string_view &path) {
+  const size_t slash = path.find('/');
+  const std::string_view part = path.substr(0, slash);
+  path.remove_prefix(slash == std::string_view::npos ? path.size() : slash + 1);
+  return part;
+}
+
+} // namespace
+
+bool DirectoryTree::valid_name(std::string_view name) {
+  return !name.empty() && name.front() != '/' && name.back() != '/' &&
+         name.find("//") == std::string_view::npos;
+}
+
+void DirectoryTree::add(std::string_view name, const std::shared_ptr<File> &file,
+                        size_t size) {
+  auto [path, leaf] = split(name);
+  grow(path, 1, size)->files.emplace(leaf, file);
+}
+
+void DirectoryTree::remove(std::string_view name, size_t size) {
+  auto [path, leaf] = split(name);
+  if (Directory *directory = shrink(path, 1, size)) {
+	auto it = directory->files.find(leaf);
+	if (it != directory->files.end()) {
+	  directory->files.erase(it);
+	}
+  }
+}
+
+const DirectoryTree::Directory *DirectoryTree::find(std::string_view path) const {
+  return const_cast<DirectoryTree *>(this)->find(path);
+}
+
+DirectoryTree::Directory *DirectoryTree::find(std::string_view path) {
+  Directory *directory = &root;
+  while (!path.empty()) {
+	auto it = directory->directories.find(next_part(path));
+	if (it == directory->directories.end()) {
+	  return nullptr;
+	}
+	directory = it->second.get();
+  }
+  return directory;
+}
+
+const DirectoryTree::Directory *DirectoryTree::move(std::string_view source,
+                                                    std::string_view dest) {
+  if (source.empty() || dest.empty() || dest == source ||
+	  (dest.starts_with(source) && dest[source.size()] == '/') || find(dest) != nullptr) {
+	return nullptr;
+  }
+
+  auto [source_path, source_name] = split(source);
+  Directory *parent = find(source_path);
+  if (parent == nullptr) {
+	return nullptr;
+  }
+  auto it = parent->directories.find(source_name);
+  if (it == parent->directories.end()) {
+	return nullptr;
+  }
+  // taken out first, removing the emptied parents would destroy it
+  auto node = parent->directories.extract(it);
+  Directory *moved = node.mapped().get();
+  shrink(source_path, moved->count, moved->bytes);
+
+  auto [dest_path, dest_name] = split(dest);
+  node.key() = dest_name;
+  grow(dest_path, moved->count, moved->bytes)->directories.insert(std::move(node));
+  return moved;
+}
+
+DirectoryTree::Directory *DirectoryTree::grow(std::string_view path, size_t count,
+                                              size_t bytes) {
+  Directory *directory = &root;
+  root.count += count;
+  root.bytes += bytes;
+  while (!path.empty()) {
+	const std::string_view part = next_part(path);
+	auto it = directory->directories.find(part);
+	if (it == directory->directories.end()) {
+	  it = directory->directories.emplace(part, std::make_unique<Directory>()).first;
+	}
+	directory = it->second.get();
+	directory->count += count;
+	directory->bytes += bytes;
+  }
+  return directory;
+}
+
+DirectoryTree::Directory *DirectoryTree::shrink(std::string_view path, size_t count,
+                                                size_t bytes) {
+  Directory *directory = &root;
+  root.count -= count;
+  root.bytes -= bytes;
+  while (!path.empty()) {
+	auto it = directory->directories.find(next_part(path));
+	if (it == directory->directories.end()) {
+	  return nullptr;
+	}
+	Directory *child = it->second.get();
+	child->count -= count;
+	child->bytes -= bytes;
+	if (child->count == 0) {
+	  // nothing is left below it, including the rest of the path
+	  directory->directories.erase(it);
+	  return nullptr;
+	}
+	directory = child;
+  }
+  return directory;
+}
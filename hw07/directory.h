@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "file.h"
+
+
+/**
+ * The directories of a filesystem, derived from the file names.
+ *
+ * A file name is a path: the parts before the last '/' name its directories,
+ * e.g. "photos/2024/cat.jpg" is the file "cat.jpg" in the directory
+ * "photos/2024". The root directory is "". A directory exists as long as a
+ * file is below it, there are no empty directories. A file and a directory
+ * may have the same name.
+ *
+ * Every directory keeps its entries sorted by name, and the number and total
+ * size of the files in its whole tree. Resolving a path looks up one entry
+ * per part, and the totals are updated along the path of every change, so
+ * no query visits more than the directory asked for.
+ */
+class DirectoryTree {
+public:
+  struct Directory {
+    std::map<std::string, std::unique_ptr<Directory>, std::less<>> directories;
+    std::map<std::string, std::shared_ptr<File>, std::less<>> files;
+    /** number and total size of the files in this directory and below */
+    size_t count = 0;
+    size_t bytes = 0;
+  };
+
+  /**
+   * Can `name` name a file or a directory? It must not be empty, start or
+   * end with '/', or contain "//", so every part of the path has a name.
+   */
+  static bool valid_name(std::string_view name);
+
+  /**
+   * Add the file `name` of `size` bytes, and the directories it's in.
+   * The name must be valid and not taken.
+   */
+  void add(std::string_view name, const std::shared_ptr<File> &file, size_t size);
+
+  /**
+   * Remove the file `name` of `size` bytes, as it was added, and the
+   * directories left empty.
+   */
+  void remove(std::string_view name, size_t size);
+
+  /**
+   * Get the directory `path`, or nullptr if there is none.
+   */
+  const Directory *find(std::string_view path) const;
+
+  /**
+   * Move the directory `source` with everything below it to `dest`.
+   * The names of the files are the caller's business.
+   *
+   * @return the moved directory,
+   *         nullptr if `source` doesn't exist or is the root,
+   *         or if `dest` exists already or lies below `source`.
+   */
+  const Directory *move(std::string_view source, std::string_view dest);
+
+  /**
+   * Call `fn(file)` for all files in `directory` and below.
+   */
+  template <typename Fn>
+  static void for_each_file(const Directory &directory, Fn &&fn) {
+    for (auto &&entry : directory.directories) {
+      for_each_file(*entry.second, fn);
+    }
+    for (auto &&entry : directory.files) {
+      fn(entry.second);
+    }
+  }
+
+private:
+  Directory *find(std::string_view path);
+
+  /**
+   * Add to the totals of the root and the directories along `path`,
+   * creating the missing ones.
+   *
+   * @return the directory `path`
+   */
+  Directory *grow(std::string_view path, size_t count, size_t bytes);
+
+  /**
+   * Subtract from the totals of the root and the directories along `path`,
+   * and remove the directories left empty.
+   *
+   * @return the directory `path`, or nullptr if it was removed
+   */
+  Directory *shrink(std::string_view path, size_t count, size_t bytes);
+
+  Directory root;
+};
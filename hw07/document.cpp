@@ -14,18 +14,22 @@ std::string_view Document::get_type() const{
  * Calculate the raw (after uncompressing) size of the file from metadata only.
  */
 size_t Document::get_raw_size() const {
-  auto fileContentPointer = content.get();
-  return fileContentPointer->size();
+  return content.get_raw_size();
+}
+
+Codec Document::preferred_codec() const {
+  return Codec::deflate;
 }
 
 unsigned Document::get_character_count() const {
+  // whitespace are spaces, newlines and tabs
+  const TextStats stats = content.text_stats();
+  return static_cast<unsigned>(stats.bytes - stats.whitespace);
+}
 
-  auto fileContentPointer = content.get();
-  auto numberOfWhiteSpaces = std::count(fileContentPointer->begin(),fileContentPointer->end(), ' ');
-  auto numberOfNewLines = std::count(fileContentPointer->begin(),fileContentPointer->end(), '\n');
-  auto numberOfTabs = std::count(fileContentPointer->begin(),fileContentPointer->end(), '\t');
-  return fileContentPointer->size() - numberOfNewLines - numberOfTabs - numberOfWhiteSpaces;
+TextStats Document::get_text_stats() const {
+  return content.text_stats();
 }
 void Document::update(FileContent &&new_content) {
-  content.update(std::move(new_content));
+  replace_content(std::move(new_content));
 }
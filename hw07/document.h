@@ -19,6 +19,11 @@ public:
    */
   size_t get_raw_size() const;
 
+  /**
+   * Text compresses well, so documents trade speed for ratio.
+   */
+  Codec preferred_codec() const;
+
 
   void update(FileContent &&new_content);
 
@@ -28,5 +33,11 @@ public:
    */
   unsigned get_character_count() const;
 
+  /**
+   * Get the byte, whitespace, line and word counts of the content.
+   * Like the character count, computed once per content.
+   */
+  TextStats get_text_stats() const;
+
 
 };
@@ -0,0 +1,240 @@
+#include "eviction.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+ArcPolicy::ArcPolicy(size_t capacity) : capacity{capacity} {}
+
+void ArcPolicy::insert(const char *key, size_t size) {
+  auto [it, added] = entries.try_emplace(key, Entry{List::none, {}, size});
+  if (!added) {
+	move(it->second, key, List::none);
+	it->second.size = size;
+  }
+  move(it->second, key, List::t1);
+}
+
+void ArcPolicy::erase(const char *key) {
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+	move(it->second, key, List::none);
+	entries.erase(it);
+  }
+}
+
+ArcPolicy::Access ArcPolicy::access(const char *key) {
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+	return Access::untracked;
+  }
+  Entry &entry = it->second;
+  switch (entry.list) {
+  case List::t1:
+  case List::t2:
+	move(entry, key, List::t2);
+	return Access::hit;
+  case List::b1: {
+	// evicted from T1 too early: T1 should be larger
+	const size_t delta = entry.size * std::max<size_t>(1, b2_bytes / b1_bytes);
+	p = std::min(capacity, p + delta);
+	move(entry, key, List::t2);
+	break;
+  }
+  case List::b2: {
+	// evicted from T2 too early: T1 should be smaller
+	const size_t delta = entry.size * std::max<size_t>(1, b1_bytes / b2_bytes);
+	p -= std::min(p, delta);
+	move(entry, key, List::t2);
+	break;
+  }
+  case List::none:
+	// evicted and forgotten, like a new key
+	move(entry, key, List::t1);
+	break;
+  }
+  trim_ghosts();
+  return Access::miss;
+}
+
+void ArcPolicy::rekey(const char *key, const char *new_key) {
+  auto node = entries.extract(key);
+  if (node.empty()) {
+	return;
+  }
+  if (entries.contains(new_key)) {
+	move(node.mapped(), key, List::none);
+	return;
+  }
+  if (node.mapped().list != List::none) {
+	*node.mapped().position = new_key;
+  }
+  node.key() = new_key;
+  entries.insert(std::move(node));
+}
+
+bool ArcPolicy::is_resident(const char *key) const {
+  auto it = entries.find(key);
+  return it != entries.end() && (it->second.list == List::t1 || it->second.list == List::t2);
+}
+
+const char *ArcPolicy::victim() const {
+  if (t1_bytes + t2_bytes <= capacity) {
+	return nullptr;
+  }
+  if (!t1.empty() && (t1_bytes > p || t2.empty())) {
+	return t1.back();
+  }
+  return t2.back();
+}
+
+void ArcPolicy::evicted(const char *key) {
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+	return;
+  }
+  if (it->second.list == List::t1) {
+	move(it->second, key, List::b1);
+  } else if (it->second.list == List::t2) {
+	move(it->second, key, List::b2);
+  }
+  trim_ghosts();
+}
+
+void ArcPolicy::set_capacity(size_t new_capacity) {
+  capacity = new_capacity;
+  p = std::min(p, capacity);
+  trim_ghosts();
+}
+
+size_t ArcPolicy::get_capacity() const {
+  return capacity;
+}
+
+size_t ArcPolicy::resident() const {
+  return t1_bytes + t2_bytes;
+}
+
+void ArcPolicy::move(Entry &entry, const char *key, List to) {
+  if (entry.list != List::none && to != List::none) {
+	// relink the node, no allocation
+	list_of(to).splice(list_of(to).begin(), list_of(entry.list), entry.position);
+	bytes_of(entry.list) -= entry.size;
+	bytes_of(to) += entry.size;
+	entry.list = to;
+	return;
+  }
+  if (entry.list != List::none) {
+	list_of(entry.list).erase(entry.position);
+	bytes_of(entry.list) -= entry.size;
+  }
+  if (to != List::none) {
+	list_of(to).push_front(key);
+	entry.position = list_of(to).begin();
+	bytes_of(to) += entry.size;
+  }
+  entry.list = to;
+}
+
+void ArcPolicy::trim_ghosts() {
+  // the ghosts of T1 cover at most the capacity with T1, all lists twice it
+  while (!b1.empty() && t1_bytes + b1_bytes > capacity) {
+	const char *key = b1.back();
+	move(entries.find(key)->second, key, List::none);
+  }
+  while (!b2.empty() && t1_bytes + t2_bytes + b1_bytes + b2_bytes > 2 * capacity) {
+	const char *key = b2.back();
+	move(entries.find(key)->second, key, List::none);
+  }
+}
+
+std::list<const char *> &ArcPolicy::list_of(List list) {
+  switch (list) {
+  case List::t1:
+	return t1;
+  case List::t2:
+	return t2;
+  case List::b1:
+	return b1;
+  default:
+	return b2;
+  }
+}
+
+size_t &ArcPolicy::bytes_of(List list) {
+  switch (list) {
+  case List::t1:
+	return t1_bytes;
+  case List::t2:
+	return t2_bytes;
+  case List::b1:
+	return b1_bytes;
+  default:
+	return b2_bytes;
+  }
+}
+
+SpillStore::SpillStore(std::string directory) : directory{std::move(directory)} {}
+
+SpillStore::~SpillStore() {
+  // the mappings keep the segments until their contents are gone
+  if (fd >= 0) {
+	::close(fd);
+  }
+}
+
+std::optional<FileContent> SpillStore::write(const FileContent &content) {
+  const std::string_view bytes = content.stored();
+  if (fd < 0 || mapping->size() - used < bytes.size()) {
+	std::string path = (std::filesystem::path{directory} / "hw07-spill-XXXXXX").string();
+	const int segment = ::mkostemp(path.data(), O_CLOEXEC);
+	if (segment < 0) {
+	  return std::nullopt;
+	}
+	::unlink(path.c_str());
+	// sparse, the disk space is taken as it's written
+	const size_t capacity = std::max(segment_size, bytes.size());
+	std::shared_ptr<const FileMapping> segment_mapping;
+	try {
+	  if (::ftruncate(segment, static_cast<off_t>(capacity)) != 0) {
+		throw std::runtime_error("can't size spill segment");
+	  }
+	  segment_mapping = std::make_shared<const FileMapping>(segment, 0, capacity);
+	} catch (const std::runtime_error &) {
+	  ::close(segment);
+	  return std::nullopt;
+	}
+	if (fd >= 0) {
+	  ::close(fd);
+	}
+	fd = segment;
+	mapping = std::move(segment_mapping);
+	used = 0;
+  }
+
+  // the mapping shows what's written, it's the same page cache
+  size_t written = 0;
+  while (written < bytes.size()) {
+	const ssize_t result = ::pwrite(fd, bytes.data() + written, bytes.size() - written,
+	                                static_cast<off_t>(used + written));
+	if (result < 0) {
+	  if (errno == EINTR) {
+		continue;
+	  }
+	  return std::nullopt;
+	}
+	written += static_cast<size_t>(result);
+  }
+
+  // the content shares the ownership of the segment's mapping
+  std::shared_ptr<const char> data{mapping, mapping->data() + used};
+  used += bytes.size();
+  return FileContent{std::move(data), bytes.size(), content.get_codec(), content.get_raw_size()};
+}
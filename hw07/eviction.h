@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "filecontent.h"
+#include "filemapping.h"
+
+/**
+ * Adaptive replacement cache (ARC) of file contents, measured in bytes.
+ * The keys are the addresses of the stored bytes, so a content shared by
+ * several files is one key.
+ *
+ * Only decides which content to evict, the filesystem moves the contents.
+ * Resident contents are in T1 if they were used once since they came in,
+ * and in T2 if more often. Evicted ones are remembered for a while in the
+ * ghost lists B1 and B2. A miss on a ghost shows which of the two lists
+ * should have been larger, and moves the target size `p` of T1 towards it:
+ * the cache adapts between recency (scans only pass through T1) and
+ * frequency.
+ */
+class ArcPolicy {
+public:
+  explicit ArcPolicy(size_t capacity);
+
+  /** what `access` found */
+  enum class Access {
+    /** the key isn't known, e.g. it's stored elsewhere */
+    untracked,
+    /** resident */
+    hit,
+    /** evicted, it's resident again and must be brought back */
+    miss,
+  };
+
+  /** add a resident key of `size` bytes, it counts as used once */
+  void insert(const char *key, size_t size);
+
+  /** forget a key, resident or not */
+  void erase(const char *key);
+
+  /** record an access to `key` */
+  Access access(const char *key);
+
+  /**
+   * The content of `key` moved to `new_key`, e.g. to disk. If `new_key` is
+   * known already, the same bytes are there: `key` is forgotten.
+   */
+  void rekey(const char *key, const char *new_key);
+
+  /** is `key` resident, or has it to be brought back? */
+  bool is_resident(const char *key) const;
+
+  /**
+   * The key to evict next, nullptr while the resident keys fit into the
+   * capacity. Call `evicted` once it's gone.
+   */
+  const char *victim() const;
+  void evicted(const char *key);
+
+  void set_capacity(size_t capacity);
+  size_t get_capacity() const;
+
+  /** bytes of the resident keys */
+  size_t resident() const;
+
+private:
+  enum class List { t1, t2, b1, b2, none };
+
+  struct Entry {
+    List list;
+    std::list<const char *>::iterator position;
+    size_t size;
+  };
+
+  /** move an entry to the front of `to`, or out of all lists with none */
+  void move(Entry &entry, const char *key, List to);
+  /** drop the oldest ghosts beyond the capacity */
+  void trim_ghosts();
+
+  std::list<const char *> &list_of(List list);
+  size_t &bytes_of(List list);
+
+  size_t capacity;
+  /** target size of T1 */
+  size_t p = 0;
+
+  std::list<const char *> t1, t2, b1, b2;
+  size_t t1_bytes = 0, t2_bytes = 0, b1_bytes = 0, b2_bytes = 0;
+
+  /** all known keys, ghosts forgotten by the lists stay with `List::none` */
+  std::unordered_map<const char *, Entry> entries;
+};
+
+
+/**
+ * Evicted file contents on disk.
+ *
+ * The contents are appended to segment files of at least `segment_size`
+ * bytes, which are deleted as soon as they're created: they only live as
+ * long as they're open or mapped, nothing is left behind after a crash.
+ * Every segment is mapped once, and a spilled content points into the
+ * mapping. A segment's disk space is freed when the last content in it
+ * is gone.
+ */
+class SpillStore {
+public:
+  static constexpr size_t segment_size = 64 << 20;
+
+  /** spill to new files in `directory` */
+  explicit SpillStore(std::string directory);
+  ~SpillStore();
+
+  SpillStore(const SpillStore &) = delete;
+  SpillStore &operator=(const SpillStore &) = delete;
+
+  /**
+   * Write the stored bytes of `content` to disk.
+   * @return the same content, backed by the spill file,
+   *         nullopt if writing failed
+   */
+  std::optional<FileContent> write(const FileContent &content);
+
+private:
+  const std::string directory;
+
+  /** the segment written to, -1 before the first */
+  int fd = -1;
+  std::shared_ptr<const FileMapping> mapping;
+  size_t used = 0;
+};
@@ -28,3 +28,48 @@ File::File(FileContent &&content, std::string_view name) {
 
   this->name = name;
 }
+
+void File::keep_versions(const VersionHistory::Retention &retention) {
+  if (history) {
+	history->set_retention(retention);
+  } else {
+	history = std::make_unique<VersionHistory>(retention);
+  }
+}
+
+const VersionHistory *File::get_history() const {
+  return history.get();
+}
+
+std::optional<FileContent> File::get_version(uint64_t version) const {
+  if (!history) {
+	return std::nullopt;
+  }
+  if (version == history->current()) {
+	return content;
+  }
+  return history->get(version);
+}
+
+void File::replace_content(FileContent &&new_content,
+                           const std::function<void()> &set_metadata) {
+  if (history) {
+	// the blocks are cut and hashed before the filesystem is locked
+	history->push(content);
+  }
+
+  std::shared_ptr<Filesystem> fs;
+  if (!name.empty()) {
+	fs = partOfFileSystem.lock();
+  }
+
+  if (fs) {
+	// deduplicates it and keeps the statistics of the filesystem current
+	fs->replace_content(*this, std::move(new_content), set_metadata);
+  } else {
+	if (set_metadata) {
+	  set_metadata();
+	}
+	content.update(std::move(new_content));
+  }
+}
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include "filecontent.h"
+#include "slab.h"
+#include "versionhistory.h"
 
 
 // forward declarations
@@ -42,6 +48,15 @@ public:
      */
     virtual size_t get_raw_size() const = 0;
 
+    /**
+     * How should the content of this file type be compressed when it is
+     * stored in a filesystem?
+     * Media files are mostly compressed already: fast LZ4 by default.
+     */
+    virtual Codec preferred_codec() const {
+        return Codec::lz4;
+    }
+
     /**
      * Rename this file.
      * This only works when the file is registered in a filesystem.
@@ -61,6 +76,25 @@ public:
      */
     const FileContent& get_content() const;
 
+    /**
+     * Keep the older contents when this file is updated, as many as
+     * `retention` allows. Calling it again changes the retention.
+     * No versions are kept by default, see versionhistory.h.
+     */
+    void keep_versions(const VersionHistory::Retention& retention = {});
+
+    /**
+     * Get the older versions of this file, nullptr if they aren't kept.
+     */
+    const VersionHistory* get_history() const;
+
+    /**
+     * Get the content of version `version`: the current one, or an older
+     * one that's kept. nullopt if there is no such version, or if the
+     * versions aren't kept.
+     */
+    std::optional<FileContent> get_version(uint64_t version) const;
+
 protected:
     /**
      * File construction, only allowed to be called from sub-classes.
@@ -68,6 +102,17 @@ protected:
     File(FileContent&& content,
          std::string_view name="");
 
+    /**
+     * Replace the file content, for the `update` functions of the sub-classes.
+     * The content of a registered file is deduplicated in the content store.
+     *
+     * `set_metadata` changes the metadata that goes with the new content. It
+     * runs under the filesystem's lock together with the content change, so
+     * snapshots and the log see both or neither.
+     */
+    void replace_content(FileContent&& new_content,
+                         const std::function<void()>& set_metadata = {});
+
     /**
      * Stored real file content.
      * Since we can create a file hardlink, this content may be shared.
@@ -82,4 +127,18 @@ private:
      * Is empty as long as the file is not registered in a filesystem.
      */
     std::string name;
+
+    /** the older contents, if they're kept */
+    std::unique_ptr<VersionHistory> history;
 };
+
+
+/**
+ * Create a file of type `T`, e.g. `make_file<Document>("text")`.
+ * Like `std::make_shared`, but the files of each type are packed into
+ * their own slab pool instead of being scattered over the heap.
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> make_file(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>{}, std::forward<Args>(args)...);
+}
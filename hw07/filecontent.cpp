@@ -1,31 +1,141 @@
 #include <iostream>
 #include "filecontent.h"
 
+#include "slab.h"
+
+static_assert(std::forward_iterator<ContentChunks::iterator>);
+
+namespace {
+
+/** allocate the string together with its reference counts from a pool */
+template <typename Arg>
+std::shared_ptr<std::string> make_content(Arg &&arg) {
+  return std::allocate_shared<std::string>(PoolAllocator<std::string>{},
+                                           std::forward<Arg>(arg));
+}
+
+} // namespace
+
 
 FileContent::FileContent(const std::string &content){
-  string_ = std::make_shared<std::string>(content);
+  string_ = make_content(content);
 }
 
 FileContent::FileContent(std::string &&content) {
-  string_ = std::make_shared<std::string>(std::move(content));
+  string_ = make_content(std::move(content));
 }
 
 FileContent::FileContent(const char *content){
 
-  string_ = std::make_shared<std::string>(content);
+  string_ = make_content(content);
 }
 
+FileContent::FileContent(std::string &&data, Codec codec, size_t raw_size)
+    : string_{make_content(std::move(data))}, codec_{codec}, raw_size_{raw_size} {}
+
+FileContent::FileContent(std::shared_ptr<const char> data, size_t size,
+                         Codec codec, size_t raw_size)
+    : codec_{codec}, raw_size_{raw_size}, external_{std::move(data)},
+      external_size_{size} {}
+
 size_t FileContent::get_size() const {
   if(!string_){
-	return 0;
+	return external_size_;
   }
   return string_->size();
 }
+
+size_t FileContent::get_raw_size() const {
+  if (codec_ == Codec::none) {
+	return get_size();
+  }
+  return raw_size_;
+}
+
+Codec FileContent::get_codec() const {
+  return codec_;
+}
+
+std::string_view FileContent::stored() const {
+  if (string_) {
+	return *string_;
+  }
+  return {external_.get(), external_size_};
+}
+
 std::shared_ptr<const std::string> FileContent::get() const {
-  return std::shared_ptr<const std::string>(string_);
+  if (string_ && codec_ == Codec::none) {
+	return string_;
+  }
+  if (!string_ && !external_) {
+	return nullptr;
+  }
+  // external data is copied into a string as well, through the cache
+  std::shared_ptr<const char> data = external_;
+  if (string_) {
+	data = std::shared_ptr<const char>(string_, string_->data());
+  }
+  return DecompressionCache::instance().get(data, get_size(), codec_, get_raw_size());
+}
+
+ContentChunks FileContent::chunks(size_t chunk_size) const {
+  chunk_size = std::max<size_t>(chunk_size, 1);
+  if (codec_ == Codec::none) {
+	std::shared_ptr<const void> owner = string_;
+	if (!owner) {
+	  owner = external_;
+	}
+	return {std::move(owner), stored(), chunk_size};
+  }
+  auto content = get();
+  const std::string_view data = *content;
+  return {std::move(content), data, chunk_size};
+}
+
+TextStats FileContent::text_stats() const {
+  if (auto stats = text_stats_.stats.load()) {
+	return *stats;
+  }
+  // uncompressed data is classified where it's stored, even if it's mapped
+  std::shared_ptr<const std::string> content;
+  std::string_view text = stored();
+  if (codec_ != Codec::none) {
+	content = get();
+	text = *content;
+  }
+  // threads racing here compute the same, any of them may win
+  auto stats = std::make_shared<const TextStats>(classify_text(text));
+  text_stats_.stats.store(stats);
+  return *stats;
 }
+
+FileContent FileContent::compressed(Codec codec) const {
+  if (!string_ || codec_ != Codec::none || string_->size() < min_compress_size) {
+	return *this;
+  }
+
+  if (!codec_available(codec)) {
+	codec = Codec::lz4;
+  }
+  std::string data = compress(*string_, codec);
+  if (data.empty()) {
+	return *this;
+  }
+
+  FileContent result{std::move(data)};
+  result.codec_ = codec;
+  result.raw_size_ = string_->size();
+  result.text_stats_ = text_stats_;
+  return result;
+}
+
 void FileContent::update(FileContent &&new_content) {
   string_ = new_content.string_;
+  codec_ = new_content.codec_;
+  raw_size_ = new_content.raw_size_;
+  external_ = new_content.external_;
+  external_size_ = new_content.external_size_;
+  text_stats_ = new_content.text_stats_;
 }
 
 
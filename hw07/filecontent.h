@@ -1,16 +1,91 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <string_view>
+
+#include "compression.h"
+#include "textstats.h"
 
 
+/**
+ * A content in chunks of the same size, only the last one may be shorter.
+ * A forward range of string_views, see `FileContent::chunks`.
+ */
+class ContentChunks {
+public:
+    class iterator {
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        std::string_view operator*() const {
+            return data.substr(position, chunk_size);
+        }
+
+        iterator& operator++() {
+            position += std::min(chunk_size, data.size() - position);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const iterator& other) const {
+            return position == other.position;
+        }
+
+    private:
+        friend class ContentChunks;
+        iterator(std::string_view data, size_t chunk_size, size_t position)
+            : data{data}, chunk_size{chunk_size}, position{position} {}
+
+        std::string_view data;
+        size_t chunk_size = 0;
+        size_t position = 0;
+    };
+
+    iterator begin() const { return {data, chunk_size, 0}; }
+    iterator end() const { return {data, chunk_size, data.size()}; }
+
+    /** how many chunks are there? */
+    size_t size() const { return (data.size() + chunk_size - 1) / chunk_size; }
+
+private:
+    friend class FileContent;
+    ContentChunks(std::shared_ptr<const void> owner, std::string_view data, size_t chunk_size)
+        : owner{std::move(owner)}, data{data}, chunk_size{chunk_size} {}
+
+    /** keeps the data alive as long as the chunks */
+    std::shared_ptr<const void> owner;
+    std::string_view data;
+    size_t chunk_size;
+};
+
 /**
  * Stored file content.
  * Read-only storage of memory representing contents of a file.
  *
  * Once you constructed a FileContent, you can no longer change the file contents.
  * The data in the string is wrapped so multiple files can point to the same content.
+ *
+ * The stored data may be compressed, see `compressed`. Then `get` returns
+ * the decompressed content, which is cached for a while.
+ *
+ * The data is usually owned by `string_`, but may live elsewhere, e.g. in a
+ * mapped snapshot (see snapshot.h) or file (see filemapping.h). Then
+ * `string_` is null.
  */
 class FileContent {
 public:
@@ -20,18 +95,94 @@ public:
     FileContent(std::string&& content);
     FileContent(const char* content);
 
+    /**
+     * Content from stored data: `data` compressed with `codec` from
+     * `raw_size` bytes, e.g. as `stored` returned it.
+     */
+    FileContent(std::string&& data, Codec codec, size_t raw_size);
+
+    /**
+     * Content stored outside of a string: the `size` bytes at `data`,
+     * compressed with `codec` from `raw_size` bytes.
+     * `data` keeps the storage alive, e.g. a mapped file.
+     */
+    FileContent(std::shared_ptr<const char> data, size_t size,
+                Codec codec = Codec::none, size_t raw_size = 0);
+
     /** what's the actual storage size of the file content? */
     [[nodiscard]] size_t get_size() const;
 
+    /** what's the size of the content after decompressing? */
+    [[nodiscard]] size_t get_raw_size() const;
+
+    /** how is the stored data compressed? */
+    [[nodiscard]] Codec get_codec() const;
+
+    /** the stored, maybe compressed bytes. data() is nullptr without content */
+    [[nodiscard]] std::string_view stored() const;
+
     /** get a read-only handle to the data */
     [[nodiscard]] std::shared_ptr<const std::string> get() const;
 
+    static constexpr size_t default_chunk_size = 64 << 10;
+
+    /**
+     * The (decompressed) content in chunks of `chunk_size` bytes, to stream
+     * it without copying all of it into one string like `get` does:
+     *
+     *     for (std::string_view chunk : content.chunks()) { ... }
+     *
+     * Uncompressed data is viewed where it's stored, a mapped file is read as
+     * the chunks are used. Compressed data is decompressed as a whole first.
+     * The chunks stay valid as long as the returned range.
+     */
+    [[nodiscard]] ContentChunks chunks(size_t chunk_size = default_chunk_size) const;
+
+    /**
+     * Statistics of the (decompressed) content as text.
+     * Computed on first use and cached, the content never changes.
+     */
+    [[nodiscard]] TextStats text_stats() const;
+
+    /**
+     * Get this content compressed with `codec`.
+     * It is returned as is if it's compressed or stored externally already,
+     * if it's smaller than `min_compress_size` or if compressing doesn't make
+     * it smaller.
+     */
+    [[nodiscard]] FileContent compressed(Codec codec) const;
+
     // add automatic comparisons
     bool operator ==(const FileContent &) const = default;
 
 	void update(FileContent &&new_content);
 
-// Store shareable file content
-	std::shared_ptr<std::string> string_;
+// Store shareable file content, compressed with `codec_`.
+// Read-only: registered files share it with every file of the same bytes.
+	std::shared_ptr<const std::string> string_;
+
+private:
+	Codec codec_ = Codec::none;
+	/** size of the decompressed content, if compressed */
+	size_t raw_size_ = 0;
+	/** data stored outside of `string_`, if that's null */
+	std::shared_ptr<const char> external_;
+	size_t external_size_ = 0;
+
+	/** the result of `text_stats`, once computed. Copied with the content. */
+	class StatsCache {
+	public:
+		StatsCache() = default;
+		StatsCache(const StatsCache &other) : stats{other.stats.load()} {}
+		StatsCache &operator=(const StatsCache &other) {
+			stats.store(other.stats.load());
+			return *this;
+		}
+
+		/** a cache isn't part of the value */
+		bool operator==(const StatsCache &) const { return true; }
 
+		std::atomic<std::shared_ptr<const TextStats>> stats;
+	};
+	mutable StatsCache text_stats_;
 };
@@ -0,0 +1,90 @@
+#include "filemapping.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/** closes a descriptor when leaving the scope */
+struct Descriptor {
+  ~Descriptor() {
+	if (fd >= 0) {
+	  ::close(fd);
+	}
+  }
+  int fd;
+};
+
+int open_file(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+	throw std::runtime_error("can't open " + path + ": " + std::strerror(errno));
+  }
+  return fd;
+}
+
+} // namespace
+
+FileMapping::FileMapping(const std::string &path, uint64_t offset, size_t length)
+    : FileMapping{Descriptor{open_file(path)}.fd, offset, length} {}
+
+FileMapping::FileMapping(int fd, uint64_t offset, size_t length) {
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+	throw std::runtime_error(std::string{"can't stat file: "} + std::strerror(errno));
+  }
+  const auto file_size = static_cast<uint64_t>(info.st_size);
+  if (offset > file_size) {
+	throw std::runtime_error("offset " + std::to_string(offset) + " past the end of the file");
+  }
+  size_ = static_cast<size_t>(std::min<uint64_t>(length, file_size - offset));
+  if (size_ == 0) {
+	return;
+  }
+
+  // mappings start at a page boundary
+  const auto page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+  const uint64_t start = offset / page * page;
+  mapped_size = static_cast<size_t>(offset - start) + size_;
+  base = ::mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(start));
+  if (base == MAP_FAILED) {
+	base = nullptr;
+	throw std::runtime_error(std::string{"can't map file: "} + std::strerror(errno));
+  }
+  data_ = static_cast<const char *>(base) + (offset - start);
+}
+
+FileMapping::~FileMapping() {
+  if (base != nullptr) {
+	::munmap(base, mapped_size);
+  }
+}
+
+const char *FileMapping::data() const {
+  return data_;
+}
+
+size_t FileMapping::size() const {
+  return size_;
+}
+
+FileContent map_file_content(const std::string &path, uint64_t offset, size_t length) {
+  auto mapping = std::make_shared<const FileMapping>(path, offset, length);
+  // the content shares the ownership of the mapping
+  std::shared_ptr<const char> data{mapping, mapping->data()};
+  return FileContent{std::move(data), mapping->size()};
+}
+
+FileContent map_file_content(int fd, uint64_t offset, size_t length) {
+  auto mapping = std::make_shared<const FileMapping>(fd, offset, length);
+  std::shared_ptr<const char> data{mapping, mapping->data()};
+  return FileContent{std::move(data), mapping->size()};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "filecontent.h"
+
+
+/**
+ * A read-only mapping of a region of a file on disk, unmapped when destroyed.
+ *
+ * Nothing is read when mapping: the pages are read from the file when they
+ * are first touched, and the kernel may drop them again under memory
+ * pressure, since they're still in the file.
+ * The file must not be truncated while it's mapped, touching a page past its
+ * end then kills the process with SIGBUS.
+ */
+class FileMapping {
+public:
+  /** as a length, the region extends to the end of the file */
+  static constexpr size_t to_end = std::numeric_limits<size_t>::max();
+
+  /**
+   * Map `length` bytes at `offset` of the file `path`, at most up to the end
+   * of the file.
+   * Throws std::runtime_error if the file can't be opened or mapped, or if
+   * `offset` lies past its end.
+   */
+  explicit FileMapping(const std::string &path, uint64_t offset = 0,
+                       size_t length = to_end);
+
+  /**
+   * Map a region of the open file `fd`, like above. The descriptor isn't
+   * needed anymore once the mapping exists, it stays the caller's.
+   */
+  FileMapping(int fd, uint64_t offset, size_t length);
+
+  ~FileMapping();
+
+  FileMapping(const FileMapping &) = delete;
+  FileMapping &operator=(const FileMapping &) = delete;
+
+  /** the mapped region, not nullptr even if it's empty */
+  const char *data() const;
+  size_t size() const;
+
+private:
+  /** the mapping itself starts at a page boundary before the region */
+  void *base = nullptr;
+  size_t mapped_size = 0;
+
+  const char *data_ = "";
+  size_t size_ = 0;
+};
+
+/**
+ * Content backed by a region of a file on disk, instead of a string in
+ * memory: `length` bytes at `offset` of the file `path`, or to its end.
+ *
+ * The region is mapped, not read. `stored()` views the mapping and
+ * `FileContent::chunks` streams it, paging the file in as it's used;
+ * only `get()` copies all of it into memory. The mapping stays until the
+ * last copy of the content is gone. Throws like `FileMapping`.
+ */
+FileContent map_file_content(const std::string &path, uint64_t offset = 0,
+                             size_t length = FileMapping::to_end);
+
+/** content backed by a region of the open file `fd`, see above */
+FileContent map_file_content(int fd, uint64_t offset, size_t length);
@@ -0,0 +1,51 @@
+#include "filemetadata.h"
+
+#include <bit>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "audio.h"
+#include "document.h"
+#include "image.h"
+#include "video.h"
+
+
+FileMetadata describe_file(File &file) {
+  FileMetadata metadata{};
+  if (dynamic_cast<Document *>(&file) != nullptr) {
+	metadata.tag = FileTag::document;
+  } else if (auto image = dynamic_cast<Image *>(&file)) {
+	metadata.tag = FileTag::image;
+	metadata.values[0] = image->get_resolution()[0];
+	metadata.values[1] = image->get_resolution()[1];
+  } else if (auto audio = dynamic_cast<Audio *>(&file)) {
+	metadata.tag = FileTag::audio;
+	metadata.values[0] = audio->get_duration();
+  } else if (auto video = dynamic_cast<Video *>(&file)) {
+	metadata.tag = FileTag::video;
+	metadata.values[0] = video->get_resolution()[0];
+	metadata.values[1] = video->get_resolution()[1];
+	metadata.values[2] = std::bit_cast<uint64_t>(video->get_duration());
+  } else {
+	throw std::runtime_error("can't persist files of type " +
+	                         std::string{file.get_type()});
+  }
+  return metadata;
+}
+
+std::shared_ptr<File> restore_file(const FileMetadata &metadata, FileContent &&content) {
+  const auto &values = metadata.values;
+  switch (metadata.tag) {
+  case FileTag::document:
+	return make_file<Document>(std::move(content));
+  case FileTag::image:
+	return make_file<Image>(std::move(content), Image::resolution_t{values[0], values[1]});
+  case FileTag::audio:
+	return make_file<Audio>(std::move(content), static_cast<unsigned>(values[0]));
+  case FileTag::video:
+	return make_file<Video>(std::move(content), Video::resolution_t{values[0], values[1]},
+	                        std::bit_cast<double>(values[2]));
+  }
+  return nullptr;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "file.h"
+
+
+/**
+ * Tags of the file types that can be persisted, see snapshot.h and wal.h.
+ */
+enum class FileTag : uint8_t {
+  document = 1,
+  image = 2,
+  audio = 3,
+  video = 4,
+};
+
+/**
+ * Everything about a file but its name and content: the type and the type
+ * specific metadata.
+ */
+struct FileMetadata {
+  FileTag tag;
+  /**
+   * image and video: width, height; audio: duration;
+   * video: duration as the bits of a double
+   */
+  uint64_t values[3];
+};
+
+/**
+ * Get the metadata of `file`.
+ * Throws std::runtime_error if the type of `file` can't be persisted.
+ */
+FileMetadata describe_file(File &file);
+
+/**
+ * Create a file from its metadata and content.
+ *
+ * @return the file, or nullptr if the tag is unknown.
+ */
+std::shared_ptr<File> restore_file(const FileMetadata &metadata, FileContent &&content);
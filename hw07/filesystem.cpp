@@ -1,11 +1,51 @@
 #include "filesystem.h"
 
 #include <algorithm>
+#include <filesystem>
 #include <iomanip>
 #include <numeric>
 #include <sstream>
 
-Filesystem::Filesystem() {}
+#include "contentstore.h"
+#include "wal.h"
+
+namespace {
+
+/**
+ * Guards the name and the filesystem of all files, while a file is claimed
+ * by or released from a filesystem. One lock for all filesystems, since a
+ * file may be registered in any of them.
+ */
+std::mutex ownership_mutex;
+
+/**
+ * Batches are worked through in parts of this many files: a part stays in
+ * the cache between preparing its files and adding them, and its files are
+ * added with one lock per shard.
+ */
+constexpr size_t batch_part = 4096;
+
+/** how many files ahead the name table slots are prefetched */
+constexpr ptrdiff_t prefetch_distance = 8;
+
+} // namespace
+
+Filesystem::Filesystem() : Filesystem{1} {}
+
+Filesystem::Filesystem(size_t shards)
+    : shards{std::make_unique<Shard[]>(std::max<size_t>(shards, 1))},
+      shard_count{std::max<size_t>(shards, 1)} {}
+
+Filesystem::~Filesystem() {
+  if (log != nullptr) {
+	log->close();
+  }
+}
+
+Filesystem::Shard &Filesystem::shard_of(uint64_t hash) const {
+  // scale the upper 32 bits to the shard count
+  return shards[((hash >> 32) * shard_count) >> 32];
+}
 
 bool Filesystem::register_file(const std::string &name,
                                const std::shared_ptr<File> &file) {
@@ -15,34 +55,258 @@ bool Filesystem::register_file(const std::string &name,
 	return false;
   }
 
-  if( file->get_content().string_ == nullptr){
+  if( file->get_content().stored().data() == nullptr){
 	return false;
   }
 
-  if ((files.find(name) == files.end()) && (file->get_name().empty())) {
-	// not found
-	file->name = name;
-	file->partOfFileSystem = std::move(this->shared_from_this());
-	files[name] = file;
-	return true;
+  if (!DirectoryTree::valid_name(name)) {
+	return false;
   }
 
-	return false;
+  // the content is compressed, and identical contents are stored once.
+  // that's the expensive part, so it happens before taking any lock.
+  FileContent content = file->content.compressed(file->preferred_codec());
+  content.string_ = ContentStore::instance().intern(std::move(content.string_));
+  auto self = this->shared_from_this();
+  std::string record;
+  if (log != nullptr) {
+	log->check_writable();
+	record = WriteAheadLog::record_put(name, *file, content);
+  }
+
+  const uint64_t hash = NameTable::hash_of(name);
+  Shard &shard = shard_of(hash);
+  uint64_t logged = 0;
+  {
+	std::unique_lock shard_lock{shard.mutex};
+
+	if (shard.files.find(name, hash) != nullptr) {
+	  // name already taken
+	  return false;
+	}
+
+	std::lock_guard lock{mutex};
+	{
+	  std::lock_guard owner{ownership_mutex};
+	  if (!file->get_name().empty()) {
+		// registered in a filesystem already
+		return false;
+	  }
+	  file->name = name;
+	  file->partOfFileSystem = std::move(self);
+	}
+	file->content.update(std::move(content));
+	shard.files.insert(file, hash);
+	sorted_valid = false;
+	attach(file);
+	if (log != nullptr) {
+	  logged = log->append(std::move(record));
+	}
+  }
+  commit(logged);
+  return true;
 }
 
-bool Filesystem::remove_file(std::string_view name) {
-  auto it = (files.find(static_cast<std::string>(name)));
+std::vector<bool> Filesystem::register_files(
+    std::span<const std::pair<std::string, std::shared_ptr<File>>> files) {
+  std::vector<bool> registered(files.size(), false);
+  if (log != nullptr) {
+	log->check_writable();
+  }
 
-  if (it == files.end()) {
-	// not found
-	return false;
+  // the name tables grow once for the whole batch
+  const size_t per_shard = files.size() / shard_count + files.size() / shard_count / 8 + 1;
+  for (size_t i = 0; i < shard_count; ++i) {
+	std::unique_lock shard_lock{shards[i].mutex};
+	shards[i].files.reserve(shards[i].files.size() + per_shard);
+  }
+  {
+	// only grows, reserving less than the buckets there are would shrink them
+	std::lock_guard lock{mutex};
+	const size_t needed = content_refs.size() + files.size();
+	if (static_cast<float>(needed) > content_refs.max_load_factor() *
+	                                 static_cast<float>(content_refs.bucket_count())) {
+	  content_refs.reserve(needed);
+	}
+  }
+
+  struct Entry {
+	size_t index;
+	Shard *shard;
+	uint64_t hash;
+	FileContent content;
+	std::string record;
+  };
+  std::vector<Entry> batch;
+  std::vector<const File *> by_file;
+  std::vector<std::shared_ptr<const std::string>> strings;
+  auto self = this->shared_from_this();
+  uint64_t logged = 0;
+  for (size_t begin = 0; begin < files.size(); begin += batch_part) {
+	const size_t end = std::min(files.size(), begin + batch_part);
+
+	// files listed twice must be tried in order, as one by one: the first
+	// try may fail on its name. then the part is added in the batch order.
+	by_file.clear();
+	for (size_t i = begin; i < end; ++i) {
+	  if (files[i].second != nullptr) {
+		by_file.push_back(files[i].second.get());
+	  }
+	}
+	std::sort(by_file.begin(), by_file.end());
+	const bool repeated = std::adjacent_find(by_file.begin(), by_file.end()) != by_file.end();
+
+	// compressing and interning the contents, hashing the names and encoding
+	// the log records happens before taking any lock, like for one file
+	batch.clear();
+	strings.clear();
+	for (size_t i = begin; i < end; ++i) {
+	  auto &&[name, file] = files[i];
+	  if (file == nullptr || file->get_content().stored().data() == nullptr ||
+		  !DirectoryTree::valid_name(name)) {
+		continue;
+	  }
+	  FileContent content = file->content.compressed(file->preferred_codec());
+	  strings.push_back(std::move(content.string_));
+	  const uint64_t hash = NameTable::hash_of(name);
+	  batch.push_back({i, &shard_of(hash), hash, std::move(content), {}});
+	}
+	ContentStore::instance().intern(strings);
+	for (size_t k = 0; k < batch.size(); ++k) {
+	  Entry &entry = batch[k];
+	  entry.content.string_ = std::move(strings[k]);
+	  if (log != nullptr) {
+		entry.record = WriteAheadLog::record_put(files[entry.index].first,
+		                                         *files[entry.index].second, entry.content);
+	  }
+	}
+	// names repeated in the batch stay in order, they're in the same shard
+	if (!repeated) {
+	  std::stable_sort(batch.begin(), batch.end(),
+	                   [](const Entry &a, const Entry &b) { return a.shard < b.shard; });
+	}
+
+	for (auto group = batch.begin(); group != batch.end();) {
+	  Shard &shard = *group->shard;
+	  const auto group_end = std::find_if(group, batch.end(),
+	                                      [&](const Entry &entry) { return entry.shard != &shard; });
+	  std::unique_lock shard_lock{shard.mutex};
+	  std::lock_guard lock{mutex};
+	  for (; group != group_end; ++group) {
+		if (group_end - group > prefetch_distance) {
+		  shard.files.prefetch(group[prefetch_distance].hash);
+		}
+		auto &&[name, file] = files[group->index];
+		if (shard.files.find(name, group->hash) != nullptr) {
+		  continue;
+		}
+		{
+		  std::lock_guard owner{ownership_mutex};
+		  if (!file->get_name().empty()) {
+			continue;
+		  }
+		  file->name = name;
+		  file->partOfFileSystem = self;
+		}
+		file->content.update(std::move(group->content));
+		shard.files.insert(file, group->hash);
+		attach(file);
+		if (log != nullptr) {
+		  logged = log->append(std::move(group->record));
+		}
+		registered[group->index] = true;
+	  }
+	  sorted_valid = false;
+	}
+  }
+  commit(logged);
+  return registered;
+}
+
+std::vector<bool> Filesystem::remove_files(std::span<const std::string> names) {
+  std::vector<bool> removed(names.size(), false);
+  if (log != nullptr) {
+	log->check_writable();
+  }
+
+  struct Entry {
+	size_t index;
+	Shard *shard;
+	uint64_t hash;
+  };
+  std::vector<Entry> batch;
+  uint64_t logged = 0;
+  for (size_t begin = 0; begin < names.size(); begin += batch_part) {
+	const size_t end = std::min(names.size(), begin + batch_part);
+	batch.clear();
+	for (size_t i = begin; i < end; ++i) {
+	  const uint64_t hash = NameTable::hash_of(names[i]);
+	  batch.push_back({i, &shard_of(hash), hash});
+	}
+	std::stable_sort(batch.begin(), batch.end(),
+	                 [](const Entry &a, const Entry &b) { return a.shard < b.shard; });
+
+	for (auto group = batch.begin(); group != batch.end();) {
+	  Shard &shard = *group->shard;
+	  const auto group_end = std::find_if(group, batch.end(),
+	                                      [&](const Entry &entry) { return entry.shard != &shard; });
+	  std::unique_lock shard_lock{shard.mutex};
+	  std::lock_guard lock{mutex};
+	  for (; group != group_end; ++group) {
+		if (group_end - group > prefetch_distance) {
+		  shard.files.prefetch(group[prefetch_distance].hash);
+		}
+		const std::string &name = names[group->index];
+		auto file = shard.files.erase(name, group->hash);
+		if (file == nullptr) {
+		  continue;
+		}
+		detach(*file);
+		{
+		  std::lock_guard owner{ownership_mutex};
+		  file->name = "";
+		}
+		if (log != nullptr) {
+		  logged = log->append(WriteAheadLog::record_remove(name));
+		}
+		removed[group->index] = true;
+	  }
+	  sorted_valid = false;
+	}
+  }
+  commit(logged);
+  return removed;
+}
+
+bool Filesystem::remove_file(std::string_view name) {
+  if (log != nullptr) {
+	log->check_writable();
   }
+  const uint64_t hash = NameTable::hash_of(name);
+  Shard &shard = shard_of(hash);
+  uint64_t logged = 0;
+  {
+	std::unique_lock shard_lock{shard.mutex};
 
-  auto fileToErase = it->second;
-  fileToErase->name = "";
+	auto fileToErase = shard.files.erase(name, hash);
 
-  files.erase(it);
+	if (fileToErase == nullptr) {
+	  // not found
+	  return false;
+	}
 
+	std::lock_guard lock{mutex};
+	detach(*fileToErase);
+	sorted_valid = false;
+	{
+	  std::lock_guard owner{ownership_mutex};
+	  fileToErase->name = "";
+	}
+	if (log != nullptr) {
+	  logged = log->append(WriteAheadLog::record_remove(name));
+	}
+  }
+  commit(logged);
   return true;
 }
 
@@ -53,26 +317,97 @@ bool Filesystem::rename_file(std::string_view source, std::string_view dest) {
 	return false;
   }
 
-  auto source_it = (files.find(static_cast<std::string>(source)));
-  auto destination_it = (files.find(static_cast<std::string>(dest)));
+  if (!DirectoryTree::valid_name(dest)) {
+	return false;
+  }
+  if (log != nullptr) {
+	log->check_writable();
+  }
 
-  if ((source_it != files.end()) && (destination_it == files.end())) {
-	// If source is found in files and destination not found
-	auto file = source_it->second;
-	file->name = dest;
+  const uint64_t source_hash = NameTable::hash_of(source);
+  const uint64_t dest_hash = NameTable::hash_of(dest);
+  Shard &source_shard = shard_of(source_hash);
+  Shard &dest_shard = shard_of(dest_hash);
+
+  uint64_t logged = 0;
+  {
+	// both shards stay locked, so no one sees the file under both or no name
+	std::unique_lock source_lock{source_shard.mutex, std::defer_lock};
+	std::unique_lock dest_lock{dest_shard.mutex, std::defer_lock};
+	if (&source_shard == &dest_shard) {
+	  source_lock.lock();
+	} else {
+	  std::lock(source_lock, dest_lock);
+	}
 
-	auto nodeHandle = files.extract(static_cast<std::string>(source));
-	nodeHandle.key() = static_cast<std::string>(dest);
-	files.insert(std::move(nodeHandle));
+	if ((source_shard.files.find(source, source_hash) == nullptr) ||
+	    (dest_shard.files.find(dest, dest_hash) != nullptr)) {
+	  return false;
+	}
 
+	// If source is found in files and destination not found,
+	// re-insert the file under its new name
+	auto file = source_shard.files.erase(source, source_hash);
 
-	return true;
+	std::lock_guard lock{mutex};
+	{
+	  std::lock_guard owner{ownership_mutex};
+	  file->name = dest;
+	}
+	dest_shard.files.insert(file, dest_hash);
+	const size_t size = file->get_size();
+	directories.remove(source, size);
+	directories.add(dest, file, size);
+	sorted_valid = false;
+	if (log != nullptr) {
+	  logged = log->append(WriteAheadLog::record_rename(source, dest));
+	}
   }
+  commit(logged);
+  return true;
+}
 
+bool Filesystem::rename_dir(std::string_view source, std::string_view dest) {
+  if (!DirectoryTree::valid_name(source) || !DirectoryTree::valid_name(dest)) {
+	return false;
+  }
+  if (log != nullptr) {
+	log->check_writable();
+  }
 
-  return false;
+  uint64_t logged = 0;
+  {
+	// the files move between any shards, and the lookups must not see them
+	// half way. renaming files locks two shards with std::lock, which backs
+	// off instead of waiting while holding a lock, so this can't deadlock.
+	std::vector<std::unique_lock<std::shared_mutex>> shard_locks;
+	shard_locks.reserve(shard_count);
+	for (size_t i = 0; i < shard_count; ++i) {
+	  shard_locks.emplace_back(shards[i].mutex);
+	}
 
+	std::lock_guard lock{mutex};
+	const auto *moved = directories.move(source, dest);
+	if (moved == nullptr) {
+	  return false;
+	}
 
+	// dest didn't exist, so no file name starts with it yet
+	std::lock_guard owner{ownership_mutex};
+	DirectoryTree::for_each_file(*moved, [&](const std::shared_ptr<File> &file) {
+	  const uint64_t old_hash = NameTable::hash_of(file->name);
+	  shard_of(old_hash).files.erase(file->name, old_hash);
+	  file->name = std::string{dest} + file->name.substr(source.size());
+	  const uint64_t hash = NameTable::hash_of(file->name);
+	  shard_of(hash).files.insert(file, hash);
+	});
+	sorted_valid = false;
+	if (log != nullptr) {
+	  logged = log->append(WriteAheadLog::record_rename_dir(source, dest));
+	}
+  }
+  commit(logged);
+  return true;
 }
 
 std::shared_ptr<File> Filesystem::get_file(std::string_view name) const {
@@ -81,27 +416,307 @@ std::shared_ptr<File> Filesystem::get_file(std::string_view name) const {
 	return nullptr;
   }
 
-  if ((files.find(static_cast<std::string>(name)) == files.end())) {
-	// not found
-	return nullptr;
+  const uint64_t hash = NameTable::hash_of(name);
+  Shard &shard = shard_of(hash);
+  std::shared_ptr<File> file;
+  {
+	std::shared_lock shard_lock{shard.mutex};
+	file = shard.files.find(name, hash);
   }
+  if (file != nullptr && budgeted.load(std::memory_order_acquire)) {
+	touch(*file);
+  }
+  return file;
+}
 
-  return files.at(static_cast<std::string>(name));
-
+void Filesystem::reserve(size_t files) {
+  // names spread evenly over the shards, leave some room for the variance
+  const size_t per_shard = files / shard_count + files / shard_count / 8 + 1;
+  for (size_t i = 0; i < shard_count; ++i) {
+	std::unique_lock shard_lock{shards[i].mutex};
+	shards[i].files.reserve(per_shard);
+  }
 }
 
 size_t Filesystem::get_file_count() const {
-  return files.size();
+  std::lock_guard lock{mutex};
+  return file_count;
+}
+
+Filesystem::TypeStats Filesystem::get_type_stats(std::string_view type) const {
+  std::lock_guard lock{mutex};
+  auto it = type_stats.find(type);
+  if (it == type_stats.end()) {
+	return {0, 0};
+  }
+  return it->second;
+}
+
+std::vector<Filesystem::DirectoryEntry> Filesystem::list_dir(std::string_view path) const {
+  std::vector<DirectoryEntry> entries;
+  std::lock_guard lock{mutex};
+  const auto *directory = directories.find(path);
+  if (directory == nullptr) {
+	return entries;
+  }
+  entries.reserve(directory->directories.size() + directory->files.size());
+  for (auto &&[name, subdirectory] : directory->directories) {
+	entries.push_back({name, nullptr, subdirectory->count, subdirectory->bytes});
+  }
+  for (auto &&[name, file] : directory->files) {
+	entries.push_back({name, file, 1, file->get_size()});
+  }
+  return entries;
+}
+
+Filesystem::DirectoryStats Filesystem::get_dir_stats(std::string_view path) const {
+  std::lock_guard lock{mutex};
+  const auto *directory = directories.find(path);
+  if (directory == nullptr) {
+	return {0, 0};
+  }
+  return {directory->count, directory->bytes};
 }
 
 size_t Filesystem::in_use() const {
-  size_t sumOfFileSizes = 0;
-  for(auto const& [name,file] : files){
+  std::lock_guard lock{mutex};
+  return total_size;
+}
+
+Filesystem::Usage Filesystem::usage() const {
+  std::lock_guard lock{mutex};
+  return {total_size, physical_size};
+}
+
+void Filesystem::replace_content(File &file, FileContent &&new_content,
+                                 const std::function<void()> &set_metadata) {
+  if (log != nullptr) {
+	log->check_writable();
+  }
+  FileContent content = new_content.compressed(file.preferred_codec());
+  content.string_ = ContentStore::instance().intern(std::move(content.string_));
+  std::string name;
+  std::string record;
+  if (log != nullptr && !set_metadata) {
+	name = file.get_name();
+	record = WriteAheadLog::record_put(name, file, content);
+  }
+
+  uint64_t logged = 0;
+  {
+	std::lock_guard lock{mutex};
+	auto self = detach(file);
+	if (set_metadata) {
+	  set_metadata();
+	}
+	if (self != nullptr && log != nullptr) {
+	  if (record.empty() || file.name != name) {
+		// renamed meanwhile, or the record has to describe the new metadata
+		record = WriteAheadLog::record_put(file.name, file, content);
+	  }
+	  logged = log->append(std::move(record));
+	}
+	file.content.update(std::move(content));
+	if (self != nullptr) {
+	  attach(self);
+	}
+  }
+  commit(logged);
+}
+
+void Filesystem::commit(uint64_t logged) {
+  if (logged != 0) {
+	log->commit(logged);
+  }
+}
+
+std::shared_ptr<WriteAheadLog> Filesystem::get_log() const {
+  return log;
+}
+
+void Filesystem::set_memory_budget(size_t budget, const std::string &spill_directory) {
+  std::lock_guard lock{mutex};
+  if (eviction == nullptr) {
+	eviction = std::make_unique<Eviction>(
+		budget, spill_directory.empty() ? std::filesystem::temp_directory_path().string()
+		                                : spill_directory);
+	for (auto &&entry : size_index) {
+	  track(*entry.second);
+	}
+	budgeted.store(true, std::memory_order_release);
+  } else {
+	eviction->policy.set_capacity(budget);
+  }
+  evict();
+}
+
+void Filesystem::apply_memory_budget() {
+  std::lock_guard lock{mutex};
+  evict();
+}
+
+Filesystem::EvictionStats Filesystem::get_eviction_stats() const {
+  std::lock_guard lock{mutex};
+  if (eviction == nullptr) {
+	return {};
+  }
+  EvictionStats stats = eviction->stats;
+  stats.budget = eviction->policy.get_capacity();
+  stats.resident = eviction->policy.resident();
+  return stats;
+}
+
+void Filesystem::touch(const File &file) const {
+  std::lock_guard lock{mutex};
+  const char *key = file.content.stored().data();
+  switch (eviction->policy.access(key)) {
+  case ArcPolicy::Access::hit:
+	eviction->stats.hits += 1;
+	break;
+  case ArcPolicy::Access::miss:
+	// on disk, `evict` brings it back
+	eviction->stats.misses += 1;
+	eviction->missed.push_back(key);
+	break;
+  case ArcPolicy::Access::untracked:
+	// removed meanwhile, or not in memory to begin with
+	break;
+  }
+}
+
+void Filesystem::evict() {
+  if (eviction == nullptr) {
+	return;
+  }
+  // the spilled contents looked up again come back first, unless they're
+  // removed or spilled again meanwhile
+  for (const char *key : eviction->missed) {
+	if (!eviction->policy.is_resident(key) || eviction->spilled.erase(key) == 0) {
+	  continue;
+	}
+	// back into memory, shared with an identical content there
+	const FileContent &stored = eviction->holders.at(key).front()->content;
+	FileContent content{std::string{stored.stored()}, stored.get_codec(), stored.get_raw_size()};
+	content.string_ = ContentStore::instance().intern(std::move(content.string_));
+	move_content(key, content);
+  }
+  eviction->missed.clear();
+
+  while (const char *victim = eviction->policy.victim()) {
+	// one copy on disk for all files holding the content
+	auto spilled = eviction->store.write(eviction->holders.at(victim).front()->content);
+	if (!spilled) {
+	  // stays in memory, the next time tries again
+	  eviction->stats.failures += 1;
+	  return;
+	}
+	eviction->policy.evicted(victim);
+	move_content(victim, *spilled);
+	eviction->spilled.insert(spilled->stored().data());
+	eviction->stats.evictions += 1;
+  }
+}
 
-	sumOfFileSizes += file->get_size();
+void Filesystem::track(const File &file) {
+  const char *key = file.content.stored().data();
+  auto it = eviction->holders.find(key);
+  if (it != eviction->holders.end()) {
+	// shared with a tracked file, the content counts once
+	it->second.push_back(&file);
+	return;
   }
+  // contents stored elsewhere already take no memory
+  if (file.content.string_ != nullptr && file.content.get_size() > 0) {
+	eviction->policy.insert(key, file.content.get_size());
+	eviction->holders[key].push_back(&file);
+  }
+}
+
+void Filesystem::untrack(const File &file) {
+  auto it = eviction->holders.find(file.content.stored().data());
+  if (it == eviction->holders.end()) {
+	return;
+  }
+  std::erase(it->second, &file);
+  if (it->second.empty()) {
+	eviction->policy.erase(it->first);
+	eviction->spilled.erase(it->first);
+	eviction->holders.erase(it);
+  }
+}
+
+void Filesystem::move_content(const char *key, const FileContent &content) {
+  auto node = eviction->holders.extract(key);
+  // the size stays, only the address of the bytes changes
+  for (const File *holder : node.mapped()) {
+	// the holders are the attached files, which this filesystem may change
+	File &file = const_cast<File &>(*holder);
+	auto it = content_refs.find(key);
+	if (it != content_refs.end() && --it->second == 0) {
+	  physical_size -= content.get_size();
+	  content_refs.erase(it);
+	}
+	file.content.update(FileContent{content});
+	if (content_refs[content.stored().data()]++ == 0) {
+	  physical_size += content.get_size();
+	}
+  }
+  const char *new_key = content.stored().data();
+  eviction->policy.rekey(key, new_key);
+  auto &moved = eviction->holders[new_key];
+  moved.insert(moved.end(), node.mapped().begin(), node.mapped().end());
+}
+
+void Filesystem::attach(const std::shared_ptr<File> &file) {
+  const size_t size = file->get_size();
+  file_count += 1;
+  total_size += size;
+  size_index.emplace(std::pair{size, file.get()}, file);
+  directories.add(file->name, file, size);
+
+  auto it = type_stats.find(file->get_type());
+  if (it == type_stats.end()) {
+	it = type_stats.emplace(file->get_type(), TypeStats{0, 0}).first;
+  }
+  it->second.count += 1;
+  it->second.bytes += size;
+
+  // hardlinked content is only stored once
+  const char *data = file->content.stored().data();
+  if (data != nullptr && content_refs[data]++ == 0) {
+	physical_size += file->content.get_size();
+  }
+
+  if (eviction != nullptr) {
+	track(*file);
+  }
+}
+
+std::shared_ptr<File> Filesystem::detach(const File &file) {
+  const size_t size = file.get_size();
+  auto node = size_index.extract({size, &file});
+  if (node.empty()) {
+	return nullptr;
+  }
+
+  file_count -= 1;
+  total_size -= size;
+  directories.remove(file.name, size);
+  if (eviction != nullptr) {
+	untrack(file);
+  }
+
+  auto &stats = type_stats.find(file.get_type())->second;
+  stats.count -= 1;
+  stats.bytes -= size;
 
-  return sumOfFileSizes;
+  auto it = content_refs.find(file.content.stored().data());
+  if (it != content_refs.end() && --it->second == 0) {
+	physical_size -= file.content.get_size();
+	content_refs.erase(it);
+  }
+
+  return std::move(node.mapped());
 }
 
 // convenience function so you can see what files are stored
@@ -111,11 +726,34 @@ std::string Filesystem::file_overview(bool sort_by_size) {
 
   output << "files in filesystem: " << std::endl;
 
-   for (auto&& entry : this->files) {
-       output << "Name:" << entry.first << " Size:" << entry.second->get_size() << std::endl;
-       output << "Type" << entry.second->get_type() << std::endl;
-       output << "Content:" << entry.second->content.string_ << std::endl<< std::endl;
-   }
+  std::lock_guard lock{mutex};
+
+  auto print = [&](const File &file) {
+	output << "Name:" << file.get_name() << " Size:" << file.get_size() << std::endl;
+	output << "Type" << file.get_type() << std::endl;
+	output << "Content:" << file.content.string_ << std::endl << std::endl;
+  };
+
+  if (sort_by_size) {
+	for (auto &&entry : size_index) {
+	  print(*entry.second);
+	}
+  } else {
+	// the name order is only built when asked for, and kept until files change
+	if (!sorted_valid) {
+	  sorted_by_name.clear();
+	  sorted_by_name.reserve(size_index.size());
+	  for (auto &&entry : size_index) {
+		sorted_by_name.push_back(entry.second.get());
+	  }
+	  std::sort(sorted_by_name.begin(), sorted_by_name.end(),
+	            [](const File *a, const File *b) { return a->name < b->name; });
+	  sorted_valid = true;
+	}
+	for (auto file : sorted_by_name) {
+	  print(*file);
+	}
+  }
   return std::move(output).str();
 }
 
@@ -123,14 +761,9 @@ std::vector<std::shared_ptr<File>>
 Filesystem::files_in_size_range(size_t max, size_t min) const {
   std::vector<std::shared_ptr<File>> sized_files;
 
-  for(auto const& [name,file] : files){
-
-	if ((file->get_size() >= min) && (file->get_size() <= max)){
-		sized_files.emplace_back(file);
-	}
-
-
-  }
+  visit_files_in_size_range(max, min, [&](const std::shared_ptr<File> &file) {
+	sized_files.emplace_back(file);
+  });
 
   return sized_files;
-  }
+}
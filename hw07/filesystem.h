@@ -1,21 +1,71 @@
 #pragma once
 
+#include "directory.h"
+#include "eviction.h"
 #include "file.h"
+#include "nametable.h"
 
+#include <atomic>
+#include <functional>
+#include <string>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <map>
 
+// forward declarations
+class WriteAheadLog;
+
 /**
  * Stores files and allows us to query the filesystem status.
+ *
+ * All member functions are thread-safe. The names are split into shards by
+ * their hash, each with its own reader-writer lock: lookups only lock their
+ * shard for reading and don't block each other, changes only block the
+ * lookups of the same shard. Renaming locks both shards and is atomic.
+ * The statistics, the size index and the ownership of the files have one
+ * more lock, which lookups don't need.
+ *
+ * A `File` object itself is not synchronized: reading the name of a file
+ * while it is renamed, or updating one file from several threads, is a
+ * data race.
+ *
+ * The file names are paths, and the filesystem keeps the directories they
+ * form, see directory.h. Names that aren't valid paths are rejected.
+ *
+ * The contents in memory can be limited, see `set_memory_budget`.
+ *
+ * A filesystem opened with `WriteAheadLog::open` logs its changes, see wal.h.
  */
 class Filesystem : public std::enable_shared_from_this<Filesystem> {
+  friend class File;
+  friend class WriteAheadLog;
+
 public:
+  /**
+   * Create a filesystem with one shard, for single-threaded use.
+   */
   Filesystem();
 
-  virtual ~Filesystem() = default;
+  /**
+   * Create a filesystem for concurrent use, with the names split into
+   * `shards` independently locked shards. A few times the number of threads
+   * accessing it is a good choice.
+   */
+  explicit Filesystem(size_t shards);
+
+  /**
+   * Closes the log of a persistent filesystem, even if it's still
+   * referenced, see `WriteAheadLog::open`.
+   */
+  virtual ~Filesystem();
 
   /**
    * Registers a file to the filesystem.
@@ -24,7 +74,7 @@ public:
    * @param file - pointer to file object to register
    *
    * @return if the file was registered successfully,
-   *         false if this name already existed,
+   *         false if this name already existed or isn't a valid path,
    *         or if file was is already registered in another filesystem.
    */
   bool register_file(const std::string &name,
@@ -37,15 +87,46 @@ public:
    */
   bool remove_file(std::string_view name);
 
+  /**
+   * Register many files, like `register_file` for each one in turn, but
+   * the batch is sorted by shard once, every shard's name table is sized
+   * for its part once, and each part is added under one lock.
+   * Not atomic: other threads may see a part of the batch registered.
+   *
+   * @return for each file, if it was registered
+   */
+  std::vector<bool> register_files(
+      std::span<const std::pair<std::string, std::shared_ptr<File>>> files);
+
+  /**
+   * Remove many files, like `remove_file` for each name in turn, with
+   * one lock per shard like `register_files`.
+   *
+   * @return for each name, if the file existed and was removed
+   */
+  std::vector<bool> remove_files(std::span<const std::string> names);
+
   /**
    * Rename a file to a new name.
    * Also called from a file if it wishes to be renamed.
    *
    * @return false if the source name didn't exist, or the dest name already
-   * exists.
+   * exists or isn't a valid path.
    */
   bool rename_file(std::string_view source, std::string_view dest);
 
+  /**
+   * Rename the directory `source`: all files below it are moved below
+   * `dest`, e.g. "a/b/c" becomes "x/b/c" when renaming "a" to "x".
+   *
+   * Atomic, no one sees some of the files moved and others not. This locks
+   * all shards, and takes time proportional to the files moved.
+   *
+   * @return false if the source directory didn't exist or is the root,
+   *         or if the dest directory already exists or lies below `source`.
+   */
+  bool rename_dir(std::string_view source, std::string_view dest);
+
   /**
    * Get a handle to given file name.
    *
@@ -53,22 +134,105 @@ public:
    */
   std::shared_ptr<File> get_file(std::string_view name) const;
 
+  /**
+   * Make room for `files` files in total, so adding that many doesn't have
+   * to grow the name tables.
+   */
+  void reserve(size_t files);
+
   /**
    * Return how many files are in the filesystem.
    */
   size_t get_file_count() const;
 
+  /**
+   * Number and size of the files of one type.
+   */
+  struct TypeStats {
+    size_t count;
+    size_t bytes;
+  };
+
+  /**
+   * Get the number and size of the files with the given type identifier,
+   * e.g. "DOC".
+   */
+  TypeStats get_type_stats(std::string_view type) const;
+
+  /**
+   * An entry of a directory.
+   */
+  struct DirectoryEntry {
+    /** the name in the directory, without the path */
+    std::string name;
+    /** the file, or nullptr for a subdirectory */
+    std::shared_ptr<File> file;
+    /** number and total size of the files, of all below a subdirectory */
+    size_t count;
+    size_t bytes;
+  };
+
+  /**
+   * List the directory `path`, e.g. "photos/2024" or "" for the root:
+   * the subdirectories, then the files, each sorted by name. Takes time
+   * proportional to the size of the directory, not of the filesystem.
+   *
+   * @return the entries, none if the directory doesn't exist
+   */
+  std::vector<DirectoryEntry> list_dir(std::string_view path) const;
+
+  /**
+   * Number and total size of the files in a directory and all below it.
+   */
+  struct DirectoryStats {
+    size_t count;
+    size_t bytes;
+  };
+
+  /**
+   * Get the number and total size of the files below the directory `path`,
+   * {0, 0} if it doesn't exist. The totals are kept for every directory.
+   */
+  DirectoryStats get_dir_stats(std::string_view path) const;
+
   /**
    * What's the size of all files?
+   * This is the logical size, files sharing their content count separately.
    */
   size_t in_use() const;
 
+  /**
+   * Logical and physical storage use of the files.
+   */
+  struct Usage {
+    /** sum of the file sizes, as reported by `in_use` */
+    size_t logical;
+    /** bytes of the distinct contents, shared contents count once */
+    size_t physical;
+  };
+
+  /**
+   * What's the logical and the physical size of all files?
+   */
+  Usage usage() const;
+
   /**
    * Get all files that have a size within the given bounds (inclusive values)
    */
   std::vector<std::shared_ptr<File>> files_in_size_range(size_t max,
                                                          size_t min = 0) const;
 
+  /**
+   * Call `visit(file)` for all files that have a size within the given bounds
+   * (inclusive values), from small to large, without collecting them first.
+   * If `visit` returns a bool, returning false stops the visit.
+   *
+   * The statistics lock is held during the visit: `visit` must not call
+   * back into the filesystem or update files.
+   */
+  template <typename Visitor>
+  void visit_files_in_size_range(size_t max, size_t min, Visitor &&visit) const;
+
   /**
    * Get a string in format "type size filename",
    * sorted by name, or if `sort_by_size` is true sort by size.
@@ -77,6 +241,194 @@ public:
    */
   std::string file_overview(bool sort_by_size = false);
 
+  /**
+   * Get the log of this filesystem's changes,
+   * or nullptr if it isn't persistent. It's closed with the filesystem.
+   */
+  std::shared_ptr<WriteAheadLog> get_log() const;
+
+  /**
+   * Keep the contents of the files in memory under `budget` bytes.
+   *
+   * The filesystem tracks how recently and how often the contents are looked
+   * up with `get_file` (see ArcPolicy in eviction.h), a content shared by
+   * several files counts once. `apply_memory_budget` spills the coldest
+   * contents to disk, into `spill_directory` or the temporary directory,
+   * until the ones in memory fit into the budget. A spilled content stays
+   * readable, mapped from the disk. Once it's looked up again, the next
+   * `apply_memory_budget` brings it back into memory.
+   *
+   * Contents mapped from elsewhere, e.g. a snapshot, don't count.
+   * Calling it again changes the budget, the directory stays. Either way
+   * the budget is applied, see `apply_memory_budget`.
+   */
+  void set_memory_budget(size_t budget, const std::string &spill_directory = "");
+
+  /**
+   * Move the contents between memory and disk as the memory budget says.
+   * Nothing else moves them: lookups and changes only record what they use.
+   *
+   * This replaces the content of the files whose content moves. Views of
+   * their bytes, like `stored()` or `chunks()`, and references to their
+   * `get_content()` taken before become invalid, and reading them while
+   * this runs is a data race. Copies of a content and the handles `get()`
+   * returns stay valid. Does nothing without a budget.
+   */
+  void apply_memory_budget();
+
+  struct EvictionStats {
+    /** the budget, and the bytes of the contents in memory once applied */
+    size_t budget;
+    size_t resident;
+    /** lookups of contents in memory, and of spilled ones to bring back */
+    size_t hits;
+    size_t misses;
+    /** contents spilled */
+    size_t evictions;
+    /** contents that couldn't be spilled, they stay in memory */
+    size_t failures;
+  };
+
+  /**
+   * Get the counters of the memory budget, all 0 without one.
+   */
+  EvictionStats get_eviction_stats() const;
+
 private:
-  std::map<std::string, std::shared_ptr<File>> files;
+  /**
+   * The files whose names fall into one shard.
+   */
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex;
+    NameTable files;
+  };
+
+  /** the shard of a name, given its `NameTable::hash_of` */
+  Shard &shard_of(uint64_t hash) const;
+
+  /**
+   * Replace the content of a registered file, and its metadata with
+   * `set_metadata`, called by the file.
+   */
+  void replace_content(File &file, FileContent &&new_content,
+                       const std::function<void()> &set_metadata);
+
+  /**
+   * Wait for the logged change `logged` to be durable, see
+   * `WriteAheadLog::Durability`. Called after releasing the locks,
+   * 0 is no change.
+   */
+  void commit(uint64_t logged);
+
+  /**
+   * Record a lookup of a file for the memory budget. Takes the statistics
+   * lock.
+   */
+  void touch(const File &file) const;
+
+  /**
+   * Spill contents until the ones in memory fit into the budget, after
+   * bringing back the ones looked up again. The statistics lock must be held.
+   */
+  void evict();
+
+  /**
+   * Let the memory budget track the content of a file if it's in memory, or
+   * stop tracking it. The statistics lock must be held.
+   */
+  void track(const File &file);
+  void untrack(const File &file);
+
+  /**
+   * Replace the content of all files holding the content `key` by the same
+   * bytes stored elsewhere. The statistics lock must be held.
+   */
+  void move_content(const char *key, const FileContent &content);
+
+  /**
+   * Add a file to the aggregate statistics and its directory, or remove it
+   * again. The statistics are kept up to date on every change, so the
+   * queries don't have to visit the files. The statistics lock must be held.
+   *
+   * detach returns nullptr and changes nothing if the file isn't attached.
+   */
+  void attach(const std::shared_ptr<File> &file);
+  std::shared_ptr<File> detach(const File &file);
+
+  /**
+   * The name shards. The lower bits of the name hash choose the slot in the
+   * shard's table, so the shard is chosen by the upper bits.
+   */
+  std::unique_ptr<Shard[]> shards;
+  size_t shard_count;
+
+  /** guards everything below, taken after the shard locks */
+  mutable std::mutex mutex;
+
+  /** the files sorted by name for `file_overview`, valid if `sorted_valid` */
+  std::vector<const File *> sorted_by_name;
+  bool sorted_valid = false;
+
+  size_t file_count = 0;
+  /** sum of the file sizes */
+  size_t total_size = 0;
+  /** sum of the sizes of the distinct contents */
+  size_t physical_size = 0;
+  /** statistics per file type */
+  std::map<std::string, TypeStats, std::less<>> type_stats;
+  /** how many files share each content, by the address of the stored bytes */
+  std::unordered_map<const char *, size_t> content_refs;
+
+  /** all files ordered by size, for the size range queries */
+  std::map<std::pair<size_t, const File *>, std::shared_ptr<File>> size_index;
+
+  /** the directories of the file names */
+  DirectoryTree directories;
+
+  /** the memory budget, see `set_memory_budget` */
+  struct Eviction {
+    Eviction(size_t budget, std::string directory)
+        : policy{budget}, store{std::move(directory)} {}
+
+    ArcPolicy policy;
+    SpillStore store;
+    EvictionStats stats{};
+    /** the files of each tracked content, by the address of its bytes */
+    std::unordered_map<const char *, std::vector<const File *>> holders;
+    /** the tracked contents on disk */
+    std::unordered_set<const char *> spilled;
+    /** contents looked up on disk since the budget was last applied */
+    std::vector<const char *> missed;
+  };
+
+  /** null without a memory budget */
+  std::unique_ptr<Eviction> eviction;
+  /** set once there is a budget, so lookups without one don't lock */
+  std::atomic<bool> budgeted{false};
+
+  /**
+   * Changes are logged here, if set. Appended to under the statistics lock.
+   * The log's background threads use the members above, the destructor
+   * stops them.
+   */
+  std::shared_ptr<WriteAheadLog> log;
 };
+
+template <typename Visitor>
+void Filesystem::visit_files_in_size_range(size_t max, size_t min,
+                                           Visitor &&visit) const {
+  if (min > max) {
+    return;
+  }
+  std::lock_guard lock{mutex};
+  for (auto it = size_index.lower_bound({min, nullptr});
+       it != size_index.end() && it->first.first <= max; ++it) {
+    if constexpr (std::is_same_v<std::invoke_result_t<Visitor &, const std::shared_ptr<File> &>, bool>) {
+      if (!std::invoke(visit, it->second)) {
+        return;
+      }
+    } else {
+      std::invoke(visit, it->second);
+    }
+  }
+}
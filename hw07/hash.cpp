@@ -0,0 +1,97 @@
+#include "hash.h"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+uint64_t read64(const char *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  if constexpr (std::endian::native == std::endian::big) {
+	v = __builtin_bswap64(v);
+  }
+  return v;
+}
+
+uint32_t read32(const char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  if constexpr (std::endian::native == std::endian::big) {
+	v = __builtin_bswap32(v);
+  }
+  return v;
+}
+
+uint64_t round(uint64_t acc, uint64_t input) {
+  acc += input * prime2;
+  acc = std::rotl(acc, 31);
+  return acc * prime1;
+}
+
+uint64_t merge_round(uint64_t acc, uint64_t val) {
+  acc ^= round(0, val);
+  return acc * prime1 + prime4;
+}
+
+} // namespace
+
+uint64_t xxh64(std::string_view data, uint64_t seed) {
+  const char *p = data.data();
+  const char *const end = p + data.size();
+  uint64_t h;
+
+  if (data.size() >= 32) {
+	// four independent lanes over 32 byte stripes
+	uint64_t v1 = seed + prime1 + prime2;
+	uint64_t v2 = seed + prime2;
+	uint64_t v3 = seed;
+	uint64_t v4 = seed - prime1;
+	const char *const limit = end - 32;
+	do {
+	  v1 = round(v1, read64(p));
+	  v2 = round(v2, read64(p + 8));
+	  v3 = round(v3, read64(p + 16));
+	  v4 = round(v4, read64(p + 24));
+	  p += 32;
+	} while (p <= limit);
+
+	h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+	h = merge_round(h, v1);
+	h = merge_round(h, v2);
+	h = merge_round(h, v3);
+	h = merge_round(h, v4);
+  } else {
+	h = seed + prime5;
+  }
+
+  h += static_cast<uint64_t>(data.size());
+
+  for (; p + 8 <= end; p += 8) {
+	h ^= round(0, read64(p));
+	h = std::rotl(h, 27) * prime1 + prime4;
+  }
+  if (p + 4 <= end) {
+	h ^= static_cast<uint64_t>(read32(p)) * prime1;
+	h = std::rotl(h, 23) * prime2 + prime3;
+	p += 4;
+  }
+  for (; p < end; ++p) {
+	h ^= static_cast<uint64_t>(static_cast<unsigned char>(*p)) * prime5;
+	h = std::rotl(h, 11) * prime1;
+  }
+
+  // avalanche
+  h ^= h >> 33;
+  h *= prime2;
+  h ^= h >> 29;
+  h *= prime3;
+  h ^= h >> 32;
+  return h;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * 64 bit xxHash (XXH64) of the given bytes.
+ *
+ * A fast non-cryptographic hash, used to find identical file contents.
+ * Equal hashes don't guarantee equal bytes, callers still compare them.
+ */
+uint64_t xxh64(std::string_view data, uint64_t seed = 0);
@@ -1,8 +1,19 @@
 #pragma once
 
 #include "audio.h"
+#include "compression.h"
+#include "contentstore.h"
+#include "directory.h"
 #include "document.h"
+#include "eviction.h"
 #include "file.h"
+#include "filemapping.h"
+#include "filemetadata.h"
 #include "filesystem.h"
 #include "image.h"
+#include "slab.h"
+#include "snapshot.h"
+#include "textstats.h"
+#include "versionhistory.h"
 #include "video.h"
+#include "wal.h"
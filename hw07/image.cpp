@@ -22,6 +22,5 @@ auto Image::get_resolution() const -> resolution_t { return this->resolution; }
 
 
 void Image::update(FileContent &&new_content, Image::resolution_t size) {
-  content.update(std::move(new_content));
-  resolution = size;
+  replace_content(std::move(new_content), [&] { resolution = size; });
 }
\ No newline at end of file
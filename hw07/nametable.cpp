@@ -0,0 +1,131 @@
+#include "nametable.h"
+
+#include <utility>
+
+#include "hash.h"
+
+namespace {
+
+/** minimum number of slots, once any is allocated */
+constexpr size_t min_capacity = 16;
+
+} // namespace
+
+const std::shared_ptr<File> &NameTable::find(std::string_view name) const {
+  return find(name, hash_of(name));
+}
+
+const std::shared_ptr<File> &NameTable::find(std::string_view name,
+                                             uint64_t hash) const {
+  static const std::shared_ptr<File> not_found;
+  if (count == 0) {
+	return not_found;
+  }
+  const Slot &slot = slots[probe(name, hash)];
+  return slot.hash == empty ? not_found : slot.file;
+}
+
+bool NameTable::insert(const std::shared_ptr<File> &file) {
+  return insert(file, hash_of(file->get_name()));
+}
+
+bool NameTable::insert(const std::shared_ptr<File> &file, uint64_t hash) {
+  if (4 * (count + 1) > 3 * slots.size()) {
+	rehash(slots.empty() ? min_capacity : 2 * slots.size());
+  }
+
+  Slot &slot = slots[probe(file->get_name(), hash)];
+  if (slot.hash != empty) {
+	return false;
+  }
+  slot.hash = hash;
+  slot.file = file;
+  count += 1;
+  return true;
+}
+
+std::shared_ptr<File> NameTable::erase(std::string_view name) {
+  return erase(name, hash_of(name));
+}
+
+std::shared_ptr<File> NameTable::erase(std::string_view name, uint64_t hash) {
+  if (count == 0) {
+	return nullptr;
+  }
+  const size_t mask = slots.size() - 1;
+  size_t hole = probe(name, hash);
+  if (slots[hole].hash == empty) {
+	return nullptr;
+  }
+
+  auto removed = std::move(slots[hole].file);
+  slots[hole].hash = empty;
+  count -= 1;
+
+  // backward shift: move later entries of the probe sequence into the hole,
+  // so lookups never stop early at it and no tombstones are needed
+  for (size_t i = (hole + 1) & mask; slots[i].hash != empty; i = (i + 1) & mask) {
+	const size_t home = slots[i].hash & mask;
+	// the entry may move if its home isn't cyclically within (hole, i]
+	const bool stays = hole < i ? (home > hole && home <= i)
+	                            : (home > hole || home <= i);
+	if (!stays) {
+	  slots[hole] = std::move(slots[i]);
+	  slots[i].hash = empty;
+	  hole = i;
+	}
+  }
+  return removed;
+}
+
+void NameTable::prefetch(uint64_t hash) const {
+  if (!slots.empty()) {
+	__builtin_prefetch(&slots[hash & (slots.size() - 1)]);
+  }
+}
+
+size_t NameTable::size() const {
+  return count;
+}
+
+void NameTable::reserve(size_t files) {
+  size_t capacity = min_capacity;
+  while (4 * files > 3 * capacity) {
+	capacity *= 2;
+  }
+  if (capacity > slots.size()) {
+	rehash(capacity);
+  }
+}
+
+uint64_t NameTable::hash_of(std::string_view name) {
+  const uint64_t hash = xxh64(name);
+  return hash == empty ? 1 : hash;
+}
+
+size_t NameTable::probe(std::string_view name, uint64_t hash) const {
+  const size_t mask = slots.size() - 1;
+  size_t i = hash & mask;
+  while (slots[i].hash != empty &&
+         (slots[i].hash != hash || slots[i].file->get_name() != name)) {
+	i = (i + 1) & mask;
+  }
+  return i;
+}
+
+void NameTable::rehash(size_t capacity) {
+  std::vector<Slot> old(capacity);
+  old.swap(slots);
+
+  const size_t mask = capacity - 1;
+  for (auto &&slot : old) {
+	if (slot.hash == empty) {
+	  continue;
+	}
+	size_t i = slot.hash & mask;
+	while (slots[i].hash != empty) {
+	  i = (i + 1) & mask;
+	}
+	slots[i] = std::move(slot);
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "file.h"
+
+
+/**
+ * Hash table of files, keyed by their names.
+ *
+ * Open addressing with linear probing: the slots are one flat array holding
+ * the name hash and the file pointer, so a lookup mostly touches one or two
+ * neighbouring slots and compares hashes before it compares a name.
+ * Lookups take a `std::string_view`, no temporary string is built.
+ *
+ * The key of an entry is the name of its file, which therefore must not
+ * change while the file is in the table: erase it, rename it, insert it again.
+ */
+class NameTable {
+public:
+  NameTable() = default;
+
+  /**
+   * The hash of a name, as used by the table.
+   * The member functions taking a hash expect this value, so callers that
+   * need the hash themselves compute it only once.
+   */
+  static uint64_t hash_of(std::string_view name);
+
+  /**
+   * Get the file with the given name.
+   *
+   * @return file handle or nullptr if file not found.
+   */
+  const std::shared_ptr<File> &find(std::string_view name) const;
+  const std::shared_ptr<File> &find(std::string_view name, uint64_t hash) const;
+
+  /**
+   * Insert a file under its name.
+   *
+   * @return false if a file of that name is already present.
+   */
+  bool insert(const std::shared_ptr<File> &file);
+  bool insert(const std::shared_ptr<File> &file, uint64_t hash);
+
+  /**
+   * Remove the file with the given name.
+   *
+   * @return the removed file or nullptr if file not found.
+   */
+  std::shared_ptr<File> erase(std::string_view name);
+  std::shared_ptr<File> erase(std::string_view name, uint64_t hash);
+
+  /**
+   * Start loading the slot a name with this hash is probed at into the
+   * cache. Callers working through many names prefetch a few ahead.
+   */
+  void prefetch(uint64_t hash) const;
+
+  /**
+   * How many files are in the table?
+   */
+  size_t size() const;
+
+  /**
+   * Make room for `files` files without rehashing.
+   */
+  void reserve(size_t files);
+
+  /**
+   * Call `fn(file)` for all files, in no particular order.
+   */
+  template <typename Fn>
+  void for_each(Fn &&fn) const {
+    for (auto &&slot : slots) {
+      if (slot.hash != empty) {
+        fn(slot.file);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    uint64_t hash = empty;
+    std::shared_ptr<File> file;
+  };
+
+  /** the hash value marking unused slots, never produced by `hash_of` */
+  static constexpr uint64_t empty = 0;
+
+  /** index of the slot holding `name`, or of the free slot ending its probe sequence */
+  size_t probe(std::string_view name, uint64_t hash) const;
+
+  void rehash(size_t capacity);
+
+  /** power of two number of slots, at most 3/4 are used */
+  std::vector<Slot> slots;
+  size_t count = 0;
+};
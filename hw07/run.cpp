@@ -77,16 +77,16 @@ void interactive_test(Filesystem &fs) {
       std::shared_ptr<File> new_file;
       switch (type) {
       case 1:
-        new_file = std::make_shared<Document>();
+        new_file = make_file<Document>();
         break;
       case 2:
-        new_file = std::make_shared<Image>();
+        new_file = make_file<Image>();
         break;
       case 3:
-        new_file = std::make_shared<Audio>();
+        new_file = make_file<Audio>();
         break;
       case 4:
-        new_file = std::make_shared<Video>();
+        new_file = make_file<Video>();
         break;
       default:
         throw std::runtime_error{"unhandled type"};
@@ -149,12 +149,12 @@ int main() {
 
   Filesystem fs;
 
-  auto vid = std::make_shared<Video>();
+  auto vid = make_file<Video>();
   vid->update("lol"s, {1, 2}, 4.0);
   std::cout << "video type: " << vid->get_type() << std::endl;
   std::cout << "video content: " << vid->get_content().string_->data() << std::endl << std::endl;
 
-  auto img = std::make_shared<Image>(FileContent{"image data"});
+  auto img = make_file<Image>(FileContent{"image data"});
   std::cout << "image type: " << img->get_type() << std::endl;
   std::cout << "image content: " << img->get_content().string_->data() << std::endl;
 
@@ -0,0 +1,82 @@
+#include "slab.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace {
+
+size_t round_up(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+/** all pools, for the total stats */
+std::mutex registry_mutex;
+std::vector<const SlabPool *> &registry() {
+  static auto *pools = new std::vector<const SlabPool *>;
+  return *pools;
+}
+
+} // namespace
+
+// every slot must be able to hold the free list link, and stay aligned
+SlabPool::SlabPool(size_t slot_size, size_t alignment)
+    : slot_size{round_up(std::max(slot_size, sizeof(FreeSlot)),
+                         std::max(alignment, alignof(FreeSlot)))},
+      alignment{std::max(alignment, alignof(FreeSlot))} {
+  std::lock_guard lock{registry_mutex};
+  registry().push_back(this);
+}
+
+SlabPool::~SlabPool() {
+  {
+	std::lock_guard lock{registry_mutex};
+	std::erase(registry(), this);
+  }
+  for (auto block : blocks) {
+	::operator delete(block, std::align_val_t{alignment});
+  }
+}
+
+void *SlabPool::allocate() {
+  std::lock_guard lock{mutex};
+  in_use += 1;
+
+  if (free_list != nullptr) {
+	return std::exchange(free_list, free_list->next);
+  }
+
+  if (unused == unused_end) {
+	const size_t slots = std::max<size_t>(1, block_size / slot_size);
+	auto block = static_cast<char *>(
+		::operator new(slots * slot_size, std::align_val_t{alignment}));
+	blocks.push_back(block);
+	unused = block;
+	unused_end = block + slots * slot_size;
+  }
+  return std::exchange(unused, unused + slot_size);
+}
+
+void SlabPool::deallocate(void *slot) {
+  std::lock_guard lock{mutex};
+  in_use -= 1;
+  free_list = ::new (slot) FreeSlot{free_list};
+}
+
+SlabPool::Stats SlabPool::get_stats() const {
+  std::lock_guard lock{mutex};
+  const size_t slots = std::max<size_t>(1, block_size / slot_size);
+  return {in_use, in_use * slot_size, blocks.size() * slots * slot_size};
+}
+
+SlabPool::Stats SlabPool::get_total_stats() {
+  Stats total{0, 0, 0};
+  std::lock_guard lock{registry_mutex};
+  for (auto pool : registry()) {
+	const Stats stats = pool->get_stats();
+	total.slots_in_use += stats.slots_in_use;
+	total.bytes_in_use += stats.bytes_in_use;
+	total.bytes_reserved += stats.bytes_reserved;
+  }
+  return total;
+}
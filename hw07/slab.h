@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/**
+ * Pool of equally sized memory slots, carved out of large blocks.
+ *
+ * Small objects which are allocated in large numbers (file objects, the
+ * shared content strings) are packed next to each other without a malloc
+ * header each, and a freed slot is reused for the next object of the same
+ * pool instead of fragmenting the general heap.
+ *
+ * The blocks are only returned to the system when the pool is destroyed.
+ * All member functions are thread-safe.
+ */
+class SlabPool {
+public:
+  /** size of the blocks the slots are carved from */
+  static constexpr size_t block_size = 64 * 1024;
+
+  SlabPool(size_t slot_size, size_t alignment);
+  ~SlabPool();
+
+  SlabPool(const SlabPool &) = delete;
+  SlabPool &operator=(const SlabPool &) = delete;
+
+  /** get one uninitialized slot */
+  void *allocate();
+
+  /** return a slot of this pool */
+  void deallocate(void *slot);
+
+  /**
+   * Memory use of one pool, or of all pools together.
+   */
+  struct Stats {
+    /** slots currently handed out */
+    size_t slots_in_use;
+    /** bytes of the slots in use */
+    size_t bytes_in_use;
+    /** bytes of all blocks, used or not */
+    size_t bytes_reserved;
+  };
+
+  Stats get_stats() const;
+
+  /**
+   * Sum of the stats of all pools of the process.
+   */
+  static Stats get_total_stats();
+
+  /**
+   * Get the process-wide pool for objects of type `T`.
+   *
+   * It is never destroyed, so objects may be released during static
+   * destruction in any order.
+   */
+  template <typename T>
+  static SlabPool &of() {
+    static SlabPool *pool = new SlabPool{sizeof(T), alignof(T)};
+    return *pool;
+  }
+
+private:
+  struct FreeSlot {
+    FreeSlot *next;
+  };
+
+  mutable std::mutex mutex;
+  size_t slot_size;
+  size_t alignment;
+
+  /** slots which were freed, reused first */
+  FreeSlot *free_list = nullptr;
+  /** the never used rest of the newest block */
+  char *unused = nullptr;
+  char *unused_end = nullptr;
+
+  std::vector<void *> blocks;
+  size_t in_use = 0;
+};
+
+
+/**
+ * Allocator handing out single objects from the `SlabPool` of their type,
+ * e.g. for `std::allocate_shared`, which allocates the object together with
+ * its reference counts. Arrays come from the general heap.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+  T *allocate(size_t n) {
+    if (n == 1) {
+      return static_cast<T *>(SlabPool::of<T>().allocate());
+    }
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T *p, size_t n) {
+    if (n == 1) {
+      SlabPool::of<T>().deallocate(p);
+    } else {
+      std::allocator<T>{}.deallocate(p, n);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U> &) const noexcept {
+    return true;
+  }
+};
@@ -0,0 +1,252 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "filemapping.h"
+#include "filemetadata.h"
+
+namespace {
+
+/*
+ * Snapshot layout, all integers in native byte order:
+ *
+ *   Header
+ *   FileEntry[file_count]   one per file
+ *   BlobEntry[blob_count]   one per distinct content
+ *   names                   the file names, not terminated
+ *   data                    the stored contents, at a 64 byte boundary
+ *
+ * The entries are fixed size, so the loader reads them in place. The data
+ * section is never read while loading, only mapped.
+ */
+
+constexpr char magic[8] = {'H', 'W', '0', '7', 'S', 'N', 'A', 'P'};
+constexpr uint32_t version = 1;
+/** reads differently with another byte order */
+constexpr uint32_t byte_order = 0x01020304;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t file_count;
+  uint64_t blob_count;
+  uint64_t files_offset;
+  uint64_t blobs_offset;
+  uint64_t names_offset;
+  uint64_t data_offset;
+  /** size of the whole snapshot, to detect truncated ones */
+  uint64_t total_size;
+};
+
+struct FileEntry {
+  /** position in the names section */
+  uint64_t name_offset;
+  /** index of the content in the blob entries */
+  uint64_t blob;
+  /** see FileMetadata */
+  uint64_t metadata[3];
+  uint32_t name_length;
+  FileTag tag;
+  uint8_t padding[3];
+};
+
+struct BlobEntry {
+  /** position in the data section */
+  uint64_t offset;
+  uint64_t size;
+  uint64_t raw_size;
+  Codec codec;
+  uint8_t padding[7];
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) == 72);
+static_assert(std::is_trivially_copyable_v<FileEntry> && sizeof(FileEntry) == 48);
+static_assert(std::is_trivially_copyable_v<BlobEntry> && sizeof(BlobEntry) == 32);
+
+constexpr uint64_t data_alignment = 64;
+
+/** do `count` elements of `element_size` bytes at `offset` fit into `size` bytes? */
+bool fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t size) {
+  return offset <= size && count <= (size - offset) / element_size;
+}
+
+} // namespace
+
+void save_snapshot(const Filesystem &fs, const std::string &path) {
+  // the names, contents and metadata may only be read under the
+  // filesystem's lock, the copies are written after it
+  SnapshotFiles files;
+  fs.visit_files_in_size_range(std::numeric_limits<size_t>::max(), 0,
+							   [&](const std::shared_ptr<File> &file) {
+								 files.push_back({file->get_name(), describe_file(*file),
+												  file->get_content()});
+							   });
+  write_snapshot(files, path);
+}
+
+void write_snapshot(const SnapshotFiles &files, const std::string &path) {
+  std::vector<FileEntry> entries;
+  entries.reserve(files.size());
+  std::vector<BlobEntry> blobs;
+  std::vector<std::string_view> blob_data;
+  // shared contents have the same stored bytes
+  std::unordered_map<const char *, uint64_t> blob_of;
+  std::string names;
+  uint64_t data_size = 0;
+
+  for (auto &&[name, metadata, content] : files) {
+	FileEntry entry{};
+	entry.name_offset = names.size();
+	entry.name_length = static_cast<uint32_t>(name.size());
+	names += name;
+	entry.tag = metadata.tag;
+	std::copy(std::begin(metadata.values), std::end(metadata.values), entry.metadata);
+
+	const std::string_view bytes = content.stored();
+	auto [it, added] = blob_of.emplace(bytes.data(), blobs.size());
+	if (added) {
+	  BlobEntry blob{};
+	  blob.offset = data_size;
+	  blob.size = bytes.size();
+	  blob.raw_size = content.get_raw_size();
+	  blob.codec = content.get_codec();
+	  blobs.push_back(blob);
+	  blob_data.push_back(bytes);
+	  data_size += bytes.size();
+	}
+	entry.blob = it->second;
+	entries.push_back(entry);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.byte_order = byte_order;
+  header.file_count = entries.size();
+  header.blob_count = blobs.size();
+  header.files_offset = sizeof(Header);
+  header.blobs_offset = header.files_offset + entries.size() * sizeof(FileEntry);
+  header.names_offset = header.blobs_offset + blobs.size() * sizeof(BlobEntry);
+  const uint64_t names_end = header.names_offset + names.size();
+  header.data_offset = (names_end + data_alignment - 1) / data_alignment * data_alignment;
+  header.total_size = header.data_offset + data_size;
+
+  const std::string temporary = path + ".tmp";
+  {
+	std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+	const auto write = [&](const void *data, size_t size) {
+	  out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+	};
+	write(&header, sizeof(header));
+	write(entries.data(), entries.size() * sizeof(FileEntry));
+	write(blobs.data(), blobs.size() * sizeof(BlobEntry));
+	write(names.data(), names.size());
+	const char padding[data_alignment] = {};
+	write(padding, header.data_offset - names_end);
+	for (auto &&bytes : blob_data) {
+	  write(bytes.data(), bytes.size());
+	}
+	out.close();
+	// the snapshot must be on disk before it replaces the old one
+	const int fd = ::open(temporary.c_str(), O_RDONLY | O_CLOEXEC);
+	const bool synced = fd >= 0 && ::fsync(fd) == 0;
+	if (fd >= 0) {
+	  ::close(fd);
+	}
+	if (!out || !synced) {
+	  std::filesystem::remove(temporary);
+	  throw std::runtime_error("can't write snapshot " + temporary);
+	}
+  }
+  std::filesystem::rename(temporary, path);
+}
+
+std::shared_ptr<Filesystem> load_snapshot(const std::string &path, size_t shards) {
+  const auto corrupt = [&](const std::string &what) {
+	return std::runtime_error("corrupt snapshot " + path + ": " + what);
+  };
+
+  auto mapping = std::make_shared<const FileMapping>(path);
+  const char *const base = mapping->data();
+  const uint64_t size = mapping->size();
+
+  Header header;
+  if (size < sizeof(header)) {
+	throw corrupt("too short");
+  }
+  std::memcpy(&header, base, sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) {
+	throw corrupt("not a snapshot");
+  }
+  if (header.version != version || header.byte_order != byte_order) {
+	throw corrupt("unsupported version or byte order");
+  }
+  if (header.total_size != size ||
+	  !fits(header.files_offset, header.file_count, sizeof(FileEntry), size) ||
+	  !fits(header.blobs_offset, header.blob_count, sizeof(BlobEntry), size) ||
+	  header.names_offset > size || header.data_offset > size) {
+	throw corrupt("truncated");
+  }
+
+  // the metadata is read once, front to back. the data is paged in on use.
+  ::madvise(const_cast<char *>(base), header.data_offset, MADV_WILLNEED);
+
+  const uint64_t data_size = size - header.data_offset;
+  std::vector<FileContent> contents;
+  contents.reserve(header.blob_count);
+  for (uint64_t i = 0; i < header.blob_count; ++i) {
+	BlobEntry blob;
+	std::memcpy(&blob, base + header.blobs_offset + i * sizeof(BlobEntry), sizeof(blob));
+	if (!fits(blob.offset, blob.size, 1, data_size)) {
+	  throw corrupt("content out of bounds");
+	}
+	if (!codec_available(blob.codec)) {
+	  throw corrupt("content compressed with an unavailable codec");
+	}
+	// the content shares the ownership of the whole mapping
+	std::shared_ptr<const char> data{mapping, base + header.data_offset + blob.offset};
+	contents.emplace_back(std::move(data), blob.size, blob.codec, blob.raw_size);
+  }
+
+  const uint64_t names_size = header.data_offset - std::min(header.names_offset, header.data_offset);
+  auto fs = std::make_shared<Filesystem>(shards);
+  fs->reserve(header.file_count);
+  for (uint64_t i = 0; i < header.file_count; ++i) {
+	FileEntry entry;
+	std::memcpy(&entry, base + header.files_offset + i * sizeof(FileEntry), sizeof(entry));
+	if (!fits(entry.name_offset, entry.name_length, 1, names_size) ||
+		entry.blob >= contents.size()) {
+	  throw corrupt("file entry out of bounds");
+	}
+
+	FileContent content = contents[entry.blob];
+	FileMetadata metadata{entry.tag, {}};
+	std::copy(std::begin(entry.metadata), std::end(entry.metadata), metadata.values);
+	auto file = restore_file(metadata, std::move(content));
+	if (file == nullptr) {
+	  throw corrupt("unknown file type");
+	}
+	const std::string name{base + header.names_offset + entry.name_offset, entry.name_length};
+	if (!fs->register_file(name, file)) {
+	  throw corrupt("duplicate file name " + name);
+	}
+  }
+  return fs;
+}
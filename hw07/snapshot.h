@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "filemetadata.h"
+#include "filesystem.h"
+
+
+/**
+ * Write all files of `fs` to `path`: their names, types and metadata
+ * (resolution, duration) and the stored, maybe compressed contents.
+ * Contents shared by several files are written once.
+ *
+ * The snapshot is written to a temporary file next to `path` first, and
+ * renamed once complete, so `path` always holds a complete snapshot.
+ * Throws std::runtime_error if writing fails, or for a file type the
+ * snapshot doesn't know (see filemetadata.h).
+ */
+void save_snapshot(const Filesystem &fs, const std::string &path);
+
+/**
+ * A file as it is stored in a snapshot. The content is a copy, it keeps
+ * the bytes alive while they're written, whatever happens to the file.
+ */
+struct SnapshotFile {
+  std::string name;
+  FileMetadata metadata;
+  FileContent content;
+};
+
+using SnapshotFiles = std::vector<SnapshotFile>;
+
+/**
+ * Write `files` as a snapshot to `path`, like `save_snapshot`.
+ * For callers that collect the files themselves, e.g. together with
+ * other state that must match them.
+ */
+void write_snapshot(const SnapshotFiles &files, const std::string &path);
+
+/**
+ * Load a snapshot written by `save_snapshot` into a new filesystem with
+ * `shards` shards.
+ *
+ * The snapshot is mapped into memory, and the contents of the files point
+ * into the mapping instead of being read: loading only reads the names and
+ * metadata, the contents are paged in when they're used. The mapping stays
+ * until the last content pointing into it is gone.
+ * The snapshot must not be changed while it's mapped.
+ *
+ * Throws std::runtime_error if the snapshot can't be opened or is corrupt.
+ */
+std::shared_ptr<Filesystem> load_snapshot(const std::string &path, size_t shards = 1);
@@ -0,0 +1,163 @@
+#include "textstats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HW07_TEXTSTATS_X86 1
+#endif
+
+namespace {
+
+/**
+ * Counts of a text, classified block by block. `after_space` carries over
+ * whether the last byte of the previous block was whitespace, so words
+ * spanning blocks are counted once.
+ */
+struct Counter {
+  size_t whitespace = 0;
+  size_t newlines = 0;
+  size_t words = 0;
+  /** the start of the text counts as whitespace */
+  bool after_space = true;
+
+  void scalar(std::string_view text) {
+	for (char c : text) {
+	  const bool space = c == ' ' || c == '\n' || c == '\t';
+	  whitespace += space;
+	  newlines += c == '\n';
+	  words += !space && after_space;
+	  after_space = space;
+	}
+  }
+
+  /**
+   * Add a block of `width` bytes, given as bit masks with bit i for byte i:
+   * the whitespace bytes and the newlines.
+   */
+  template <int width>
+  void block(uint32_t spaces, uint32_t lines) {
+	whitespace += static_cast<size_t>(std::popcount(spaces));
+	newlines += static_cast<size_t>(std::popcount(lines));
+	// a word starts at a byte that isn't whitespace after one that is
+	const uint64_t before = (uint64_t{spaces} << 1) | after_space;
+	const uint64_t starts = ~uint64_t{spaces} & before & ((uint64_t{1} << width) - 1);
+	words += static_cast<size_t>(std::popcount(starts));
+	after_space = (spaces >> (width - 1)) & 1;
+  }
+
+  TextStats finish(std::string_view text) const {
+	TextStats stats;
+	stats.bytes = text.size();
+	stats.whitespace = whitespace;
+	stats.lines = newlines + (!text.empty() && text.back() != '\n');
+	stats.words = words;
+	return stats;
+  }
+};
+
+#ifdef HW07_TEXTSTATS_X86
+
+/** SSE2 is part of x86-64, and the fallback for 32 bit x86 builds with it */
+#ifdef __SSE2__
+/** sum of the 16 byte counters */
+size_t sum_bytes(__m128i counters) {
+  const __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(sums)) +
+         static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+}
+
+/**
+ * Without popcnt the masks would be slow to count, so the matches are
+ * counted in byte lanes instead, and summed up before the lanes overflow.
+ */
+TextStats classify_sse2(std::string_view text) {
+  Counter counter;
+  const char *p = text.data();
+  const char *const end = p + text.size();
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i tab = _mm_set1_epi8('\t');
+  // the whitespace of the previous block, the start counts as whitespace
+  __m128i previous = _mm_set1_epi8(-1);
+  while (end - p >= 16) {
+	const char *const chunk_end = p + std::min<ptrdiff_t>((end - p) / 16, 255) * 16;
+	__m128i whitespace = _mm_setzero_si128();
+	__m128i newlines = _mm_setzero_si128();
+	__m128i words = _mm_setzero_si128();
+	for (; p != chunk_end; p += 16) {
+	  const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	  const __m128i lines = _mm_cmpeq_epi8(bytes, newline);
+	  const __m128i spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), lines),
+	                                      _mm_cmpeq_epi8(bytes, tab));
+	  // a word starts at a byte that isn't whitespace after one that is
+	  const __m128i before = _mm_or_si128(_mm_slli_si128(spaces, 1), _mm_srli_si128(previous, 15));
+	  const __m128i starts = _mm_andnot_si128(spaces, before);
+	  // matches are -1
+	  whitespace = _mm_sub_epi8(whitespace, spaces);
+	  newlines = _mm_sub_epi8(newlines, lines);
+	  words = _mm_sub_epi8(words, starts);
+	  previous = spaces;
+	}
+	counter.whitespace += sum_bytes(whitespace);
+	counter.newlines += sum_bytes(newlines);
+	counter.words += sum_bytes(words);
+  }
+  counter.after_space = (_mm_movemask_epi8(previous) >> 15) & 1;
+  counter.scalar({p, static_cast<size_t>(end - p)});
+  return counter.finish(text);
+}
+#endif
+
+__attribute__((target("avx2,popcnt")))
+TextStats classify_avx2(std::string_view text) {
+  Counter counter;
+  const char *p = text.data();
+  const char *const end = p + text.size();
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  for (; end - p >= 32; p += 32) {
+	const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+	const __m256i lines = _mm256_cmpeq_epi8(bytes, newline);
+	const __m256i spaces = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), lines),
+	                                       _mm256_cmpeq_epi8(bytes, tab));
+	counter.block<32>(static_cast<uint32_t>(_mm256_movemask_epi8(spaces)),
+	                  static_cast<uint32_t>(_mm256_movemask_epi8(lines)));
+  }
+  counter.scalar({p, static_cast<size_t>(end - p)});
+  return counter.finish(text);
+}
+
+#endif
+
+/** the best implementation for this CPU, chosen once */
+using Classifier = TextStats (*)(std::string_view);
+
+Classifier choose_classifier() {
+#ifdef HW07_TEXTSTATS_X86
+  if (__builtin_cpu_supports("avx2")) {
+	return classify_avx2;
+  }
+#ifdef __SSE2__
+  return classify_sse2;
+#endif
+#endif
+  return classify_text_scalar;
+}
+
+} // namespace
+
+TextStats classify_text_scalar(std::string_view text) {
+  Counter counter;
+  counter.scalar(text);
+  return counter.finish(text);
+}
+
+TextStats classify_text(std::string_view text) {
+  static const Classifier classifier = choose_classifier();
+  return classifier(text);
+}
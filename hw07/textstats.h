@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+
+/**
+ * Statistics of a text. Whitespace are spaces, tabs and newlines.
+ */
+struct TextStats {
+  size_t bytes = 0;
+  /** spaces, tabs and newlines */
+  size_t whitespace = 0;
+  /** newlines, plus a last line without one */
+  size_t lines = 0;
+  /** runs of bytes that aren't whitespace */
+  size_t words = 0;
+
+  bool operator==(const TextStats &) const = default;
+};
+
+/**
+ * Compute the statistics of `text` in one pass.
+ *
+ * Uses AVX2 or SSE2 where available, 32 or 16 bytes at a time, and plain
+ * C++ elsewhere. All give the same result.
+ */
+TextStats classify_text(std::string_view text);
+
+/**
+ * `classify_text` without vector instructions, the reference for the others.
+ */
+TextStats classify_text_scalar(std::string_view text);
@@ -0,0 +1,154 @@
+#include "versionhistory.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include "hash.h"
+
+namespace {
+
+/** blocks are cut between these sizes, at about 8 KiB on average */
+constexpr size_t min_block = 2 << 10;
+constexpr size_t max_block = 64 << 10;
+/** the top 13 bits of the rolling hash, all 0 once in 8 KiB */
+constexpr uint64_t cut_mask = ~uint64_t{0} << (64 - 13);
+
+/** a random value per byte for the rolling hash, from splitmix64 */
+constexpr std::array<uint64_t, 256> make_gear() {
+  std::array<uint64_t, 256> gear{};
+  uint64_t state = 0;
+  for (auto &value : gear) {
+	state += 0x9E3779B97F4A7C15;
+	uint64_t z = state;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	value = z ^ (z >> 31);
+  }
+  return gear;
+}
+
+constexpr std::array<uint64_t, 256> gear = make_gear();
+
+/**
+ * Length of the next block of `data` (FastCDC's gear hash). Every byte
+ * shifts the hash by one, so its top bits depend on the last 64 bytes only:
+ * after an edit, the cuts fall where they fell before within 64 bytes.
+ */
+size_t next_cut(std::string_view data) {
+  if (data.size() <= min_block) {
+	return data.size();
+  }
+  const size_t end = std::min(data.size(), max_block);
+  uint64_t hash = 0;
+  for (size_t i = min_block; i < end; ++i) {
+	hash = (hash << 1) + gear[static_cast<unsigned char>(data[i])];
+	if ((hash & cut_mask) == 0) {
+	  return i + 1;
+	}
+  }
+  return end;
+}
+
+} // namespace
+
+VersionHistory::VersionHistory(const Retention &retention) : retention{retention} {}
+
+uint64_t VersionHistory::current() const {
+  return current_version;
+}
+
+std::vector<uint64_t> VersionHistory::versions() const {
+  std::vector<uint64_t> numbers;
+  numbers.reserve(history.size());
+  for (auto &&version : history) {
+	numbers.push_back(version.number);
+  }
+  return numbers;
+}
+
+std::optional<FileContent> VersionHistory::get(uint64_t version) const {
+  // the kept versions are consecutive
+  if (history.empty() || version < history.front().number ||
+	  version - history.front().number >= history.size()) {
+	return std::nullopt;
+  }
+  const Version &found = history[version - history.front().number];
+  std::string content;
+  content.reserve(found.size);
+  for (auto &&block : found.blocks) {
+	content += *block.data;
+  }
+  return FileContent{std::move(content)};
+}
+
+size_t VersionHistory::stored_bytes() const {
+  return block_bytes;
+}
+
+auto VersionHistory::get_retention() const -> const Retention & {
+  return retention;
+}
+
+void VersionHistory::set_retention(const Retention &new_retention) {
+  retention = new_retention;
+  trim();
+}
+
+void VersionHistory::push(const FileContent &replaced) {
+  current_version += 1;
+  if (retention.versions == 0) {
+	return;
+  }
+
+  // the blocks hold the decompressed bytes, uncompressed ones are read in place
+  std::shared_ptr<const std::string> decompressed;
+  std::string_view data = replaced.stored();
+  if (replaced.get_codec() != Codec::none) {
+	decompressed = replaced.get();
+	data = *decompressed;
+  }
+
+  Version version{current_version - 1, data.size(), {}};
+  while (!data.empty()) {
+	const std::string_view bytes = data.substr(0, next_cut(data));
+	data.remove_prefix(bytes.size());
+	const uint64_t hash = xxh64(bytes);
+
+	auto it = blocks.find(hash);
+	if (it == blocks.end()) {
+	  it = blocks.emplace(hash, StoredBlock{std::make_shared<const std::string>(bytes), 0}).first;
+	  block_bytes += bytes.size();
+	} else if (*it->second.data != bytes) {
+	  // the same hash for other bytes, this block is stored on its own
+	  version.blocks.push_back({hash, std::make_shared<const std::string>(bytes)});
+	  block_bytes += bytes.size();
+	  continue;
+	}
+	it->second.refs += 1;
+	version.blocks.push_back({hash, it->second.data});
+  }
+  history.push_back(std::move(version));
+  trim();
+}
+
+void VersionHistory::trim() {
+  while (!history.empty() &&
+		 (history.size() > retention.versions || block_bytes > retention.bytes)) {
+	release(history.front());
+	history.pop_front();
+  }
+}
+
+void VersionHistory::release(const Version &version) {
+  for (auto &&block : version.blocks) {
+	auto it = blocks.find(block.hash);
+	if (it == blocks.end() || it->second.data != block.data) {
+	  // stored on its own
+	  block_bytes -= block.data->size();
+	} else if (--it->second.refs == 0) {
+	  block_bytes -= block.data->size();
+	  blocks.erase(it);
+	}
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "filecontent.h"
+
+
+/**
+ * The older contents of a file, see `File::keep_versions`.
+ *
+ * Every update adds the replaced content as a version. A version is a rope:
+ * the content cut into blocks of about 8 KiB, where the cuts are chosen by
+ * the bytes around them (content-defined chunking), not by their position.
+ * An edit thus only changes the blocks it touches, even if it moves the
+ * rest of the content, and all other blocks are shared with the versions
+ * before. Small edits to a large content only store the blocks around them.
+ *
+ * The blocks hold the decompressed bytes. Versions are numbered from 1, the
+ * content when keeping them started, and every update adds one.
+ */
+class VersionHistory {
+public:
+  /**
+   * How many older versions to keep: the oldest ones are dropped once
+   * there are more than `versions` of them, or once the blocks of all
+   * kept versions take more than `bytes`.
+   */
+  struct Retention {
+    size_t versions = 16;
+    size_t bytes = 64 << 20;
+  };
+
+  explicit VersionHistory(const Retention &retention);
+
+  /** number of the current version, which isn't part of the history */
+  uint64_t current() const;
+
+  /** numbers of the kept older versions, oldest first */
+  std::vector<uint64_t> versions() const;
+
+  /**
+   * Get the content of an older version, put together from its blocks.
+   * nullopt if it's the current version, or wasn't kept.
+   */
+  std::optional<FileContent> get(uint64_t version) const;
+
+  /** bytes of the distinct blocks of all kept versions */
+  size_t stored_bytes() const;
+
+  const Retention &get_retention() const;
+
+  /** change the retention, dropping the versions it doesn't allow anymore */
+  void set_retention(const Retention &retention);
+
+  /**
+   * Add the content an update replaces, and start the next version.
+   * Only blocks no kept version has yet are stored.
+   */
+  void push(const FileContent &replaced);
+
+private:
+  struct Block {
+    uint64_t hash;
+    std::shared_ptr<const std::string> data;
+  };
+
+  struct Version {
+    uint64_t number;
+    size_t size;
+    std::vector<Block> blocks;
+  };
+
+  /** a stored block, and how many blocks of the kept versions share it */
+  struct StoredBlock {
+    std::shared_ptr<const std::string> data;
+    size_t refs;
+  };
+
+  /** drop the oldest versions the retention doesn't allow */
+  void trim();
+  /** forget the blocks of a dropped version */
+  void release(const Version &version);
+
+  Retention retention;
+  uint64_t current_version = 1;
+  std::deque<Version> history;
+
+  /**
+   * The blocks of the kept versions, by their hash. A block with the hash
+   * of another one but different bytes isn't listed, nor shared.
+   */
+  std::unordered_map<uint64_t, StoredBlock> blocks;
+  size_t block_bytes = 0;
+};
@@ -23,8 +23,9 @@ auto Video::get_resolution() const -> resolution_t { return this->resolution; }
 double Video::get_duration() const { return this->duration; }
 
 void Video::update(FileContent &&new_content, Video::resolution_t size, double duration) {
-  content.update(std::move(new_content));
-  resolution = size;
-  this->duration = duration;
+  replace_content(std::move(new_content), [&] {
+	resolution = size;
+	this->duration = duration;
+  });
 }
 
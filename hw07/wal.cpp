@@ -0,0 +1,596 @@
+#include "wal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "filemetadata.h"
+#include "hash.h"
+#include "snapshot.h"
+
+namespace {
+
+/*
+ * A log segment is a series of records, each a header and a payload.
+ * The payload starts with the operation:
+ *
+ *   put     name, file tag, 3 metadata values, codec, raw size, stored content
+ *   remove  name
+ *   rename  source name, destination name
+ *   rename_dir  source directory, destination directory
+ *
+ * Strings are a 64 bit length and the bytes, all integers in native byte
+ * order. The header checks itself and the payload, so a record cut short by
+ * a crash is detected.
+ */
+
+struct RecordHeader {
+  /** of the payload */
+  uint64_t size;
+  uint64_t sequence;
+  uint64_t payload_check;
+  /** of the header with this field 0 */
+  uint64_t header_check;
+};
+
+enum class Op : uint8_t {
+  put = 1,
+  remove = 2,
+  rename = 3,
+  rename_dir = 4,
+};
+
+/** the writer wakes up early once this much is buffered */
+constexpr size_t flush_bytes = 1 << 20;
+
+/** encodes a payload behind the space for the header */
+class RecordWriter {
+public:
+  explicit RecordWriter(Op op) : record(sizeof(RecordHeader), '\0') {
+	put(op);
+  }
+
+  template <typename T>
+  void put(const T &value) {
+	record.append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  void put(std::string_view bytes) {
+	put(static_cast<uint64_t>(bytes.size()));
+	record.append(bytes);
+  }
+
+  /** fill in the header but the sequence number, see `seal` */
+  std::string finish() && {
+	RecordHeader header{};
+	header.size = record.size() - sizeof(RecordHeader);
+	header.payload_check = xxh64(std::string_view{record}.substr(sizeof(RecordHeader)));
+	std::memcpy(record.data(), &header, sizeof(header));
+	return std::move(record);
+  }
+
+private:
+  std::string record;
+};
+
+/** set the sequence number of a finished record */
+void seal(std::string &record, uint64_t sequence) {
+  RecordHeader header;
+  std::memcpy(&header, record.data(), sizeof(header));
+  header.sequence = sequence;
+  header.header_check = 0;
+  header.header_check = xxh64({reinterpret_cast<const char *>(&header), sizeof(header)});
+  std::memcpy(record.data(), &header, sizeof(header));
+}
+
+/** decodes a payload, throws if it's too short */
+class RecordReader {
+public:
+  explicit RecordReader(std::string_view payload) : rest{payload} {}
+
+  template <typename T>
+  T get() {
+	T value;
+	std::memcpy(&value, take(sizeof(value)).data(), sizeof(value));
+	return value;
+  }
+
+  std::string_view get_bytes() {
+	return take(get<uint64_t>());
+  }
+
+private:
+  std::string_view take(uint64_t size) {
+	if (size > rest.size()) {
+	  throw std::runtime_error("corrupt log record");
+	}
+	auto bytes = rest.substr(0, size);
+	rest.remove_prefix(size);
+	return bytes;
+  }
+
+  std::string_view rest;
+};
+
+/** apply the change of a record to `fs` */
+void replay(Filesystem &fs, std::string_view payload) {
+  RecordReader reader{payload};
+  const auto fail = [] {
+	throw std::runtime_error("log doesn't match the filesystem");
+  };
+
+  switch (reader.get<Op>()) {
+  case Op::put: {
+	const std::string name{reader.get_bytes()};
+	FileMetadata metadata{reader.get<FileTag>(), {}};
+	for (auto &value : metadata.values) {
+	  value = reader.get<uint64_t>();
+	}
+	const auto codec = reader.get<Codec>();
+	const auto raw_size = reader.get<uint64_t>();
+	FileContent content{std::string{reader.get_bytes()}, codec, raw_size};
+	auto file = restore_file(metadata, std::move(content));
+	if (file == nullptr) {
+	  fail();
+	}
+	// an update of an existing file replaces it
+	fs.remove_file(name);
+	if (!fs.register_file(name, file)) {
+	  fail();
+	}
+	break;
+  }
+  case Op::remove:
+	if (!fs.remove_file(reader.get_bytes())) {
+	  fail();
+	}
+	break;
+  case Op::rename: {
+	const auto source = reader.get_bytes();
+	if (!fs.rename_file(source, reader.get_bytes())) {
+	  fail();
+	}
+	break;
+  }
+  case Op::rename_dir: {
+	const auto source = reader.get_bytes();
+	if (!fs.rename_dir(source, reader.get_bytes())) {
+	  fail();
+	}
+	break;
+  }
+  default:
+	throw std::runtime_error("corrupt log record");
+  }
+}
+
+/**
+ * Replay the records of a segment with sequence numbers after `last`, and
+ * advance `last`.
+ *
+ * @return the bytes of complete records, the rest was cut short.
+ */
+size_t replay_segment(Filesystem &fs, std::string_view segment, uint64_t &last) {
+  size_t position = 0;
+  while (segment.size() - position >= sizeof(RecordHeader)) {
+	RecordHeader header;
+	std::memcpy(&header, segment.data() + position, sizeof(header));
+	RecordHeader unchecked = header;
+	unchecked.header_check = 0;
+	if (header.header_check != xxh64({reinterpret_cast<const char *>(&unchecked), sizeof(unchecked)}) ||
+		header.size > segment.size() - position - sizeof(RecordHeader)) {
+	  break;
+	}
+	const auto payload = segment.substr(position + sizeof(RecordHeader), header.size);
+	if (header.payload_check != xxh64(payload)) {
+	  break;
+	}
+
+	if (header.sequence > last) {
+	  if (header.sequence != last + 1) {
+		throw std::runtime_error("log records are missing");
+	  }
+	  replay(fs, payload);
+	  last = header.sequence;
+	}
+	position += sizeof(RecordHeader) + header.size;
+  }
+  return position;
+}
+
+/** the number after `prefix` in a file name like "wal.123" */
+std::optional<uint64_t> sequence_of(std::string_view name, std::string_view prefix) {
+  if (name.substr(0, prefix.size()) != prefix || name.size() == prefix.size()) {
+	return std::nullopt;
+  }
+  uint64_t sequence = 0;
+  for (char c : name.substr(prefix.size())) {
+	if (c < '0' || c > '9') {
+	  return std::nullopt;
+	}
+	sequence = sequence * 10 + static_cast<uint64_t>(c - '0');
+  }
+  return sequence;
+}
+
+std::string read_file(const std::filesystem::path &path) {
+  std::ifstream in{path, std::ios::binary};
+  std::ostringstream data;
+  data << in.rdbuf();
+  if (!in) {
+	throw std::runtime_error("can't read " + path.string());
+  }
+  return std::move(data).str();
+}
+
+/** make the creation, renaming and deletion of files in `directory` durable */
+void sync_directory(const std::string &directory) {
+  const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0) {
+	::fsync(fd);
+	::close(fd);
+  }
+}
+
+bool write_all(int fd, std::string_view data) {
+  while (!data.empty()) {
+	const ssize_t count = ::write(fd, data.data(), data.size());
+	if (count < 0) {
+	  if (errno == EINTR) {
+		continue;
+	  }
+	  return false;
+	}
+	data.remove_prefix(static_cast<size_t>(count));
+  }
+  return true;
+}
+
+} // namespace
+
+std::shared_ptr<Filesystem> WriteAheadLog::open(const std::string &directory) {
+  return open(directory, Options{});
+}
+
+std::shared_ptr<Filesystem> WriteAheadLog::open(const std::string &directory,
+												const Options &options) {
+  std::filesystem::create_directories(directory);
+
+  std::optional<uint64_t> snapshot;
+  std::map<uint64_t, std::filesystem::path> segments;
+  for (auto &&entry : std::filesystem::directory_iterator{directory}) {
+	const std::string name = entry.path().filename().string();
+	if (auto sequence = sequence_of(name, "snapshot.")) {
+	  snapshot = std::max(snapshot.value_or(0), *sequence);
+	} else if (auto sequence = sequence_of(name, "wal.")) {
+	  segments.emplace(*sequence, entry.path());
+	} else if (name.starts_with("snapshot.") && name.ends_with(".tmp")) {
+	  // left by a crash while writing a snapshot
+	  std::filesystem::remove(entry.path());
+	}
+  }
+
+  // the sequence numbers of the changes start at 1
+  uint64_t last = snapshot.value_or(0);
+  auto filesystem = snapshot ? load_snapshot((std::filesystem::path{directory} / ("snapshot." + std::to_string(*snapshot))).string(),
+											 options.shards)
+							 : std::make_shared<Filesystem>(options.shards);
+
+  for (auto it = segments.begin(); it != segments.end(); ++it) {
+	const std::string segment = read_file(it->second);
+	const size_t complete = replay_segment(*filesystem, segment, last);
+	if (complete < segment.size()) {
+	  if (std::next(it) != segments.end()) {
+		throw std::runtime_error("corrupt log segment " + it->second.string());
+	  }
+	  // the last record was cut short by a crash, it never committed
+	  std::filesystem::resize_file(it->second, complete);
+	}
+  }
+
+  std::shared_ptr<WriteAheadLog> log{new WriteAheadLog{directory, options, last}};
+  log->fs = filesystem.get();
+  filesystem->log = log;
+  return filesystem;
+}
+
+WriteAheadLog::WriteAheadLog(std::string directory, const Options &options,
+							 uint64_t sequence)
+	: directory{std::move(directory)}, options{options}, logged{sequence},
+	  written{sequence}, synced{sequence} {
+  const std::string path = segment_path(sequence + 1);
+  segment_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (segment_fd < 0) {
+	throw std::runtime_error("can't open log segment " + path + ": " + std::strerror(errno));
+  }
+  sync_directory(this->directory);
+
+  writer = std::thread{&WriteAheadLog::write_loop, this};
+  compactor = std::thread{&WriteAheadLog::compact_loop, this};
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  close();
+}
+
+void WriteAheadLog::close() {
+  {
+	// a compaction reads the filesystem, it finishes before it's gone
+	std::lock_guard compacting{compaction_mutex};
+	fs = nullptr;
+  }
+
+  // the compactor may still need the writer, so it stops first
+  if (compactor.joinable()) {
+	{
+	  std::lock_guard lock{mutex};
+	  stop_compactor = true;
+	}
+	wake_compactor.notify_one();
+	compactor.join();
+  }
+
+  if (writer.joinable()) {
+	{
+	  std::lock_guard lock{mutex};
+	  stop_writer = true;
+	}
+	wake_writer.notify_one();
+	writer.join();
+	::close(segment_fd);
+  }
+}
+
+std::string WriteAheadLog::segment_path(uint64_t sequence) const {
+  return (std::filesystem::path{directory} / ("wal." + std::to_string(sequence))).string();
+}
+
+std::string WriteAheadLog::snapshot_path(uint64_t sequence) const {
+  return (std::filesystem::path{directory} / ("snapshot." + std::to_string(sequence))).string();
+}
+
+std::string WriteAheadLog::record_put(std::string_view name, File &file,
+									  const FileContent &content) {
+  RecordWriter record{Op::put};
+  record.put(name);
+  const FileMetadata metadata = describe_file(file);
+  record.put(metadata.tag);
+  for (uint64_t value : metadata.values) {
+	record.put(value);
+  }
+  record.put(content.get_codec());
+  record.put(static_cast<uint64_t>(content.get_raw_size()));
+  record.put(content.stored());
+  return std::move(record).finish();
+}
+
+std::string WriteAheadLog::record_remove(std::string_view name) {
+  RecordWriter record{Op::remove};
+  record.put(name);
+  return std::move(record).finish();
+}
+
+std::string WriteAheadLog::record_rename(std::string_view source, std::string_view dest) {
+  RecordWriter record{Op::rename};
+  record.put(source);
+  record.put(dest);
+  return std::move(record).finish();
+}
+
+std::string WriteAheadLog::record_rename_dir(std::string_view source,
+											 std::string_view dest) {
+  RecordWriter record{Op::rename_dir};
+  record.put(source);
+  record.put(dest);
+  return std::move(record).finish();
+}
+
+uint64_t WriteAheadLog::append(std::string &&record) {
+  std::lock_guard lock{mutex};
+  logged += 1;
+  seal(record, logged);
+  buffer += record;
+  if (buffer.size() >= flush_bytes) {
+	wake_writer.notify_one();
+  }
+  return logged;
+}
+
+void WriteAheadLog::commit(uint64_t sequence) {
+  if (options.durability != Durability::sync) {
+	return;
+  }
+  std::unique_lock lock{mutex};
+  sync_wanted = std::max(sync_wanted, sequence);
+  wake_writer.notify_one();
+  // changes logged meanwhile by other threads share the next fsync
+  progress.wait(lock, [&] { return synced >= sequence || failed; });
+  if (synced < sequence) {
+	throw std::runtime_error("can't write the log to " + directory);
+  }
+}
+
+void WriteAheadLog::check_writable() const {
+  std::lock_guard lock{mutex};
+  if (failed) {
+	throw std::runtime_error("can't write the log to " + directory);
+  }
+}
+
+void WriteAheadLog::sync() {
+  std::unique_lock lock{mutex};
+  const uint64_t sequence = logged;
+  sync_wanted = std::max(sync_wanted, sequence);
+  wake_writer.notify_one();
+  progress.wait(lock, [&] { return synced >= sequence || failed; });
+  if (synced < sequence) {
+	throw std::runtime_error("can't write the log to " + directory);
+  }
+}
+
+WriteAheadLog::Stats WriteAheadLog::get_stats() const {
+  std::lock_guard lock{mutex};
+  return {logged, written, synced, commits, compactions, log_bytes, failed};
+}
+
+void WriteAheadLog::write_loop() {
+  std::string batch;
+  std::string before_rotation;
+  std::unique_lock lock{mutex};
+  while (true) {
+	wake_writer.wait_for(lock, options.commit_interval, [&] {
+	  return stop_writer || failed || rotate || sync_wanted > synced || buffer.size() >= flush_bytes;
+	});
+	if (failed) {
+	  // nothing is written after a gap, the segment stays a valid log
+	  wake_writer.wait(lock, [&] { return stop_writer; });
+	  return;
+	}
+	const bool stopping = stop_writer;
+	if (buffer.empty() && !rotate && sync_wanted <= synced && !stopping) {
+	  continue;
+	}
+
+	batch.clear();
+	std::swap(batch, buffer);
+	const bool rotating = rotate;
+	const uint64_t next_segment = rotate_start;
+	before_rotation.clear();
+	std::swap(before_rotation, rotated);
+	rotate = false;
+	const uint64_t last = logged;
+	const bool fsync = options.durability != Durability::buffered ||
+					   sync_wanted > synced || stopping;
+	lock.unlock();
+
+	bool ok = true;
+	if (rotating) {
+	  // the old segment is complete before the new one gets records. if it
+	  // isn't, there is no new one: a torn record must be in the last segment
+	  ok = write_all(segment_fd, before_rotation) && ::fdatasync(segment_fd) == 0;
+	  if (ok) {
+		const std::string path = segment_path(next_segment);
+		const int next_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		ok = next_fd >= 0;
+		if (ok) {
+		  ::close(segment_fd);
+		  segment_fd = next_fd;
+		  sync_directory(directory);
+		}
+	  }
+	}
+	ok = ok && write_all(segment_fd, batch);
+	if (fsync && ok) {
+	  ok = ::fdatasync(segment_fd) == 0;
+	}
+
+	lock.lock();
+	if (ok) {
+	  written = last;
+	  if (fsync) {
+		synced = last;
+	  }
+	  commits += 1;
+	  log_bytes += batch.size();
+	} else {
+	  // the records stay in memory, in order
+	  failed = true;
+	  buffer.insert(0, batch);
+	  if (rotating) {
+		buffer.insert(0, before_rotation);
+	  }
+	}
+	if (options.compact_bytes != 0 && log_bytes >= options.compact_bytes && !compact_requested) {
+	  compact_requested = true;
+	  wake_compactor.notify_one();
+	}
+	progress.notify_all();
+	if (stopping && buffer.empty()) {
+	  return;
+	}
+  }
+}
+
+void WriteAheadLog::compact_loop() {
+  std::unique_lock lock{mutex};
+  while (true) {
+	wake_compactor.wait(lock, [&] { return stop_compactor || compact_requested; });
+	if (stop_compactor) {
+	  return;
+	}
+	lock.unlock();
+	try {
+	  compact();
+	} catch (const std::exception &) {
+	  // the log stays as it is, the next compaction tries again
+	}
+	lock.lock();
+	compact_requested = false;
+  }
+}
+
+void WriteAheadLog::compact() {
+  std::lock_guard compacting{compaction_mutex};
+  if (fs == nullptr) {
+	throw std::runtime_error("can't compact the closed log in " + directory);
+  }
+
+  // the files and the log cut must match: records are appended under the
+  // filesystem's statistics lock, so none is appended while it's held
+  SnapshotFiles files;
+  uint64_t cut;
+  {
+	// the contents and metadata are copied, updates change them under this lock
+	std::lock_guard fs_lock{fs->mutex};
+	files.reserve(fs->size_index.size());
+	for (auto &&entry : fs->size_index) {
+	  File &file = *entry.second;
+	  files.push_back({file.get_name(), describe_file(file), file.get_content()});
+	}
+
+	std::lock_guard lock{mutex};
+	cut = logged;
+	rotated += buffer;
+	buffer.clear();
+	rotate = true;
+	rotate_start = cut + 1;
+	log_bytes = 0;
+  }
+  wake_writer.notify_one();
+  {
+	// the writer starts the new segment before the old ones are deleted
+	std::unique_lock lock{mutex};
+	progress.wait(lock, [&] { return !rotate || failed; });
+	if (failed) {
+	  throw std::runtime_error("can't write the log to " + directory);
+	}
+  }
+
+  write_snapshot(files, snapshot_path(cut));
+  sync_directory(directory);
+
+  // everything in the older snapshots and segments is in the new snapshot
+  for (auto &&entry : std::filesystem::directory_iterator{directory}) {
+	const std::string name = entry.path().filename().string();
+	auto snapshot = sequence_of(name, "snapshot.");
+	auto segment = sequence_of(name, "wal.");
+	if ((snapshot && *snapshot < cut) || (segment && *segment <= cut)) {
+	  std::filesystem::remove(entry.path());
+	}
+  }
+  sync_directory(directory);
+
+  std::lock_guard lock{mutex};
+  compactions += 1;
+}
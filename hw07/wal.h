@@ -0,0 +1,219 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "filesystem.h"
+
+
+/**
+ * Write-ahead log of the changes of a filesystem, for durability beyond
+ * snapshots.
+ *
+ * A persistent filesystem lives in a directory: the last snapshot
+ * (`snapshot.<sequence>`, see snapshot.h) and the log segments
+ * (`wal.<sequence>`) with the changes after it. Registering, removing,
+ * renaming and updating files, and renaming directories, appends a record
+ * to the log in memory, and a background thread writes the records out in
+ * batches, with one fsync per batch ("group commit"). Once the log has grown by `Options::compact_bytes`,
+ * another background thread writes a new snapshot and deletes the log
+ * segments it contains.
+ *
+ * When a change is durable depends on the `Durability` level. Once writing
+ * the log failed, nothing more is written: the log on disk stays complete
+ * up to the failure, and the filesystem's changes throw std::runtime_error.
+ * Only the file types of filemetadata.h can be stored.
+ */
+class WriteAheadLog {
+  friend class Filesystem;
+
+public:
+  enum class Durability {
+    /**
+     * Changes are written to the OS in the background, without fsync:
+     * they survive a crash of the process, but not of the system.
+     */
+    buffered,
+    /**
+     * The log is fsynced in the background every `commit_interval`, a
+     * system crash loses about the changes of the last interval.
+     */
+    group,
+    /**
+     * Changes return once their record is fsynced. Concurrent changes
+     * share the fsyncs.
+     */
+    sync,
+  };
+
+  struct Options {
+    Durability durability = Durability::group;
+    /** how often the log is written (and fsynced) in the background */
+    std::chrono::milliseconds commit_interval{10};
+    /** write a new snapshot once the log grew by this many bytes, 0 never does */
+    size_t compact_bytes = 64 << 20;
+    /** shards of the filesystem, see `Filesystem(size_t)` */
+    size_t shards = 1;
+  };
+
+  /**
+   * Open the persistent filesystem in `directory`, or create it: load the
+   * last snapshot and replay the log after it.
+   *
+   * The changes of the returned filesystem are logged to the directory until
+   * it's destroyed, then the rest of the log is written and fsynced, and
+   * the log is closed: a log still referenced (see `Filesystem::get_log`)
+   * can be synced, but not compacted anymore.
+   * Only one filesystem may use a directory at a time.
+   *
+   * Throws std::runtime_error if the directory can't be used, or if the
+   * snapshot or the log is corrupt. A record cut short by a crash at the end
+   * of the log is dropped.
+   */
+  static std::shared_ptr<Filesystem> open(const std::string &directory,
+                                          const Options &options);
+  static std::shared_ptr<Filesystem> open(const std::string &directory);
+
+  ~WriteAheadLog();
+
+  WriteAheadLog(const WriteAheadLog &) = delete;
+  WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+  /**
+   * Wait until all changes logged so far are fsynced, whatever the
+   * durability level.
+   * Throws std::runtime_error if writing the log failed.
+   */
+  void sync();
+
+  /**
+   * Write a snapshot now, and delete the log it contains.
+   * Throws std::runtime_error if the log is closed.
+   */
+  void compact();
+
+  struct Stats {
+    /** sequence number of the last logged change */
+    uint64_t logged;
+    /** ... of the last change written to the OS */
+    uint64_t written;
+    /** ... of the last change fsynced */
+    uint64_t synced;
+    /** batches written */
+    size_t commits;
+    size_t compactions;
+    /** bytes logged since the last snapshot */
+    size_t log_bytes;
+    /** writing the log failed, see above */
+    bool failed;
+  };
+
+  Stats get_stats() const;
+
+private:
+  WriteAheadLog(std::string directory, const Options &options, uint64_t sequence);
+
+  /**
+   * Encode the records of changes, before taking any lock.
+   * `put` registers the file, or replaces the file with that name.
+   */
+  static std::string record_put(std::string_view name, File &file,
+                                const FileContent &content);
+  static std::string record_remove(std::string_view name);
+  static std::string record_rename(std::string_view source, std::string_view dest);
+  static std::string record_rename_dir(std::string_view source, std::string_view dest);
+
+  /**
+   * Add a record to the log. Called with the filesystem's statistics lock
+   * held, so the log has the order of the changes.
+   *
+   * @return the sequence number of the record
+   */
+  uint64_t append(std::string &&record);
+
+  /**
+   * Wait until the record `sequence` is as durable as the level demands.
+   * Called without holding a lock of the filesystem.
+   * Throws std::runtime_error if writing the log failed before.
+   */
+  void commit(uint64_t sequence);
+
+  /**
+   * Throws std::runtime_error if writing the log failed, called before a
+   * change. A change racing with the failure is lost, as in a crash.
+   */
+  void check_writable() const;
+
+  /**
+   * Wait for a running compaction, then stop the background threads once
+   * everything is written and fsynced. Called when the filesystem is
+   * destroyed, and by the destructor.
+   */
+  void close();
+
+  /** write the buffered records, in the background */
+  void write_loop();
+  /** compact when the log has grown, in the background */
+  void compact_loop();
+
+  std::string segment_path(uint64_t sequence) const;
+  std::string snapshot_path(uint64_t sequence) const;
+
+  const std::string directory;
+  const Options options;
+  /**
+   * The logged filesystem, nullptr once closed.
+   * Guarded by `compaction_mutex`, the filesystem closes the log before
+   * it's gone.
+   */
+  Filesystem *fs = nullptr;
+
+  /** guards everything below but the file descriptor */
+  mutable std::mutex mutex;
+  std::condition_variable wake_writer;
+  std::condition_variable wake_compactor;
+  /** notified when the writer made progress */
+  std::condition_variable progress;
+
+  /** sequence numbers of the last logged, written and fsynced records */
+  uint64_t logged;
+  uint64_t written;
+  uint64_t synced;
+  /** someone waits for the records up to here to be fsynced */
+  uint64_t sync_wanted = 0;
+
+  /** records not written yet */
+  std::string buffer;
+  /**
+   * Set by a compaction: `rotated` are the records before the snapshot's
+   * cut, for the current segment. The next ones go to a new segment,
+   * starting at `rotate_start`.
+   */
+  bool rotate = false;
+  std::string rotated;
+  uint64_t rotate_start = 0;
+
+  size_t log_bytes = 0;
+  size_t commits = 0;
+  size_t compactions = 0;
+  bool failed = false;
+  bool compact_requested = false;
+  bool stop_compactor = false;
+  bool stop_writer = false;
+
+  /** one compaction at a time */
+  std::mutex compaction_mutex;
+
+  /** the current segment, only used by the writer */
+  int segment_fd = -1;
+
+  std::thread writer;
+  std::thread compactor;
+};
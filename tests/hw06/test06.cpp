@@ -8,6 +8,9 @@
  */
 
 #include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iterator>
 #include <limits>
 #include <numeric>
@@ -579,3 +582,742 @@ TEST_CASE("Transform") {
     }
   }
 }
+
+TEST_CASE("Vector views") {
+  SUBCASE("Viewing a vector") {
+    const linalg::Vector x({3, 1, 13, 1, 2, 3, 8, 9});
+    const linalg::VectorView view{x};
+    CAPTURE(x);
+
+    CHECK_EQ(view.size(), x.size());
+    CHECK_EQ(view.data(), x.data());
+    CHECK_UNARY(view.is_contiguous());
+    CHECK_UNARY(std::equal(view.begin(), view.end(), x.begin(), x.end()));
+    CHECK_EQ(view[-1], 9);
+    CHECK_THROWS_AS(view.coeff(8), std::out_of_range);
+  }
+
+  SUBCASE("Viewing external memory without copying") {
+    std::vector<float> buffer{30, 0, 123, 0, 2, 3, 0, 0, 6, 0, 8, 9};
+    const linalg::VectorView view{std::span<float>{buffer}};
+
+    CHECK_EQ(view.data(), buffer.data());
+    CHECK_EQ(linalg::sum(view), 181);
+    CHECK_EQ(linalg::prod(view), 0);
+    CHECK_EQ(linalg::min(view), 0);
+    CHECK_EQ(linalg::max(view), 123);
+    CHECK_EQ(linalg::argmax(view), 2);
+    CHECK_EQ(linalg::non_zeros(view), 7);
+
+    // the view sees changes to the underlying memory
+    buffer[1] = -4;
+    CHECK_EQ(linalg::argmin(view), 1);
+  }
+
+  SUBCASE("Strided views") {
+    // a 3x4 row-major matrix, view its second column
+    const std::vector<float> matrix{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    const linalg::VectorView column{std::span{matrix}.subspan(1), 4};
+
+    CHECK_EQ(column.size(), 3);
+    CHECK_EQ(column.stride(), 4);
+    CHECK_EQ(column[0], 2);
+    CHECK_EQ(column[1], 6);
+    CHECK_EQ(column[2], 10);
+    CHECK_EQ(std::distance(column.begin(), column.end()), 3);
+
+    CHECK_EQ(linalg::sum(column), 18);
+    CHECK_EQ(linalg::dot(column, column), 140);
+    CHECK_EQ(linalg::norm(column), doctest::Approx(11.8321596));
+    CHECK_EQ(linalg::dot(column, linalg::Vector({1, 1, 1})), 18);
+    CHECK_THROWS_AS(linalg::dot(column, linalg::Vector({1, 1})),
+                    std::invalid_argument);
+
+    const auto every_other = linalg::VectorView{std::span{matrix}}.slice(1, 6, 2);
+    CHECK_EQ(every_other.size(), 6);
+    CHECK_EQ(every_other[-1], 12);
+    CHECK_EQ(linalg::sum(every_other), 42);
+    CHECK_THROWS_AS(linalg::VectorView{std::span{matrix}}.slice(1, 7, 2),
+                    std::out_of_range);
+  }
+
+  SUBCASE("Empty views") {
+    const linalg::VectorView empty;
+    CHECK_EQ(empty.size(), 0);
+    CHECK_EQ(linalg::sum(empty), 0);
+    CHECK_EQ(linalg::non_zeros(empty), 0);
+    CHECK_THROWS_AS(linalg::min(empty), std::invalid_argument);
+    CHECK_THROWS_AS(linalg::argmax(empty), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Matrix") {
+  const linalg::Matrix a{{1, 2, 3}, {4, 5, 6}};
+
+  SUBCASE("Construction and access") {
+    CHECK_EQ(a.rows(), 2);
+    CHECK_EQ(a.cols(), 3);
+    CHECK_EQ(a(1, 0), 4);
+    CHECK_EQ(a.coeff(0, 2), 3);
+    CHECK_THROWS_AS(a.coeff(2, 0), std::out_of_range);
+    CHECK_THROWS_AS((linalg::Matrix{{1, 2}, {3}}), std::invalid_argument);
+
+    CHECK_EQ(linalg::sum(a.row(1)), 15);
+    CHECK_EQ(a.col(2).stride(), 3);
+    CHECK_EQ(linalg::sum(a.col(2)), 9);
+    CHECK_THROWS_AS(a.col(3), std::out_of_range);
+  }
+
+  SUBCASE("Transpose") {
+    const auto t = linalg::transpose(a);
+    CHECK_EQ(t.rows(), 3);
+    CHECK_EQ(t.cols(), 2);
+    for (std::size_t r = 0; r < a.rows(); ++r) {
+      for (std::size_t c = 0; c < a.cols(); ++c) {
+        CHECK_EQ(t(c, r), a(r, c));
+      }
+    }
+
+    // larger than one tile and not a multiple of it
+    linalg::Matrix big(70, 45);
+    std::iota(big.begin(), big.end(), 0.f);
+    const auto big_t = linalg::transpose(big);
+    CHECK_EQ(big_t(44, 69), big(69, 44));
+    CHECK_EQ(big_t(33, 5), big(5, 33));
+  }
+
+  SUBCASE("Matrix vector product") {
+    const linalg::Vector x({1, 0, -1});
+    const auto y = a * x;
+    CHECK_EQ(y.size(), 2);
+    CHECK_EQ(y[0], -2);
+    CHECK_EQ(y[1], -2);
+
+    // strided views work as input
+    const linalg::Matrix id{{1, 0}, {0, 1}};
+    const auto col = id * a.col(1);
+    CHECK_EQ(col[0], 2);
+    CHECK_EQ(col[1], 5);
+
+    linalg::Vector acc({1, 1});
+    linalg::gemv(2.f, a, x, 3.f, acc);
+    CHECK_EQ(acc[0], -1);
+    CHECK_EQ(acc[1], -1);
+
+    CHECK_THROWS_AS(a * linalg::Vector({1, 2}), std::invalid_argument);
+  }
+
+  SUBCASE("Blocked kernels agree with the definition") {
+    // sizes which are not multiples of the block and unroll widths
+    const std::size_t m = 67, k = 150, n = 531;
+    linalg::Matrix b(m, k);
+    linalg::Matrix c(k, n);
+    for (std::size_t i = 0; i < b.size(); ++i) {
+      b.data()[i] = static_cast<float>(i % 7) - 3.f;
+    }
+    for (std::size_t i = 0; i < c.size(); ++i) {
+      c.data()[i] = static_cast<float>(i % 5) - 2.f;
+    }
+
+    const auto bc = b * c;
+    CHECK_EQ(bc.rows(), m);
+    CHECK_EQ(bc.cols(), n);
+    for (std::size_t i = 0; i < m; i += 11) {
+      for (std::size_t j = 0; j < n; j += 13) {
+        CHECK_EQ(bc(i, j), linalg::dot(b.row(i), c.col(j)));
+      }
+    }
+
+    const auto bx = b * c.col(4);
+    for (std::size_t i = 0; i < m; ++i) {
+      CHECK_EQ(bx[static_cast<int>(i)], bc(i, 4));
+    }
+
+    CHECK_THROWS_AS(c * b, std::invalid_argument);
+  }
+}
+
+TEST_CASE("Vector collections") {
+  // more vectors than fit into one block, so padding is exercised
+  const std::size_t count = 37;
+  linalg::VectorCollection collection{3};
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto f = static_cast<float>(i);
+    collection.push_back(linalg::Vector({f, -f, 1}));
+  }
+
+  SUBCASE("Storage") {
+    CHECK_EQ(collection.size(), count);
+    CHECK_EQ(collection.dim(), 3);
+    CHECK_EQ(collection[20][1], -20);
+    CHECK_EQ(collection.coeff(36, 0), 36);
+    CHECK_EQ(collection.norm(0), 1);
+    CHECK_THROWS_AS(collection[count], std::out_of_range);
+    CHECK_THROWS_AS(collection.push_back(linalg::Vector({1, 2})),
+                    std::invalid_argument);
+  }
+
+  SUBCASE("Batched scores match single dot products") {
+    const linalg::Vector query({1, 2, 3});
+    const auto scores = collection.scores(query);
+    CHECK_EQ(scores.size(), count);
+    for (std::size_t i = 0; i < count; ++i) {
+      CHECK_EQ(scores[static_cast<int>(i)], linalg::dot(query, collection[i]));
+    }
+
+    const auto cosine = collection.scores(query, linalg::Similarity::cosine);
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto expected = linalg::dot(linalg::normalized(query),
+                                        linalg::normalized(collection[i]));
+      CHECK_EQ(cosine[static_cast<int>(i)], doctest::Approx(expected));
+    }
+  }
+
+  SUBCASE("Top k") {
+    const linalg::Vector query({1, 0, 0});
+    const auto best = collection.top_k(query, 3);
+    REQUIRE_EQ(best.size(), 3);
+    CHECK_EQ(best[0], linalg::Match{36, 36});
+    CHECK_EQ(best[1], linalg::Match{35, 35});
+    CHECK_EQ(best[2], linalg::Match{34, 34});
+
+    // every vector but the first points into the same direction, ties are
+    // broken by the index
+    const auto cosine = collection.top_k(linalg::Vector({0, 0, 1}), 2,
+                                         linalg::Similarity::cosine);
+    REQUIRE_EQ(cosine.size(), 2);
+    CHECK_EQ(cosine[0].index, 0);
+    CHECK_EQ(cosine[0].score, doctest::Approx(1));
+    CHECK_EQ(cosine[1].index, 1);
+
+    CHECK_EQ(collection.top_k(query, 100).size(), count);
+    CHECK_UNARY(collection.top_k(query, 0).empty());
+
+    // NaN scores rank below all others
+    linalg::VectorCollection with_nan{3};
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto f = static_cast<float>(i);
+      with_nan.push_back(linalg::Vector({i % 3 == 0 ? nan : f, 0, 0}));
+    }
+    const auto ranked = with_nan.top_k(query, count);
+    REQUIRE_EQ(ranked.size(), count);
+    CHECK_EQ(ranked[0], linalg::Match{35, 35});
+    CHECK_EQ(ranked[23], linalg::Match{1, 1});
+    for (std::size_t i = 24; i < count; ++i) {
+      CHECK_UNARY(std::isnan(ranked[i].score));
+      CHECK_EQ(ranked[i].index, 3 * (i - 24));
+    }
+    CHECK_EQ(with_nan.top_k(query, 2)[1], linalg::Match{34, 34});
+  }
+
+  SUBCASE("Multithreaded scoring agrees with a single thread") {
+    linalg::VectorCollection big{8};
+    for (std::size_t i = 0; i < 20000; ++i) {
+      linalg::Vector v(8);
+      for (std::size_t d = 0; d < 8; ++d) {
+        v[static_cast<int>(d)] = static_cast<float>((i * 31 + d * 17) % 101) - 50.f;
+      }
+      big.push_back(v);
+    }
+    const linalg::Vector query({1, -2, 3, -4, 5, -6, 7, -8});
+    CHECK_EQ(big.top_k(query, 25, linalg::Similarity::dot, 4),
+             big.top_k(query, 25, linalg::Similarity::dot, 1));
+    const auto single = big.scores(query, linalg::Similarity::cosine, 1);
+    const auto parallel = big.scores(query, linalg::Similarity::cosine, 4);
+    CHECK_UNARY(std::equal(single.begin(), single.end(), parallel.begin()));
+  }
+}
+
+TEST_CASE("Compact vectors") {
+  SUBCASE("bf16 encoding") {
+    CHECK_EQ(linalg::bf16::encode(1.f), 0x3f80);
+    CHECK_EQ(linalg::bf16::encode(-2.f), 0xc000);
+    CHECK_EQ(linalg::bf16::decode(0x3f80), 1.f);
+    // 1 + 2^-8 is exactly between two bf16 values, ties go to even
+    CHECK_EQ(linalg::bf16::decode(linalg::bf16::encode(1.00390625f)), 1.f);
+    CHECK_UNARY(std::isnan(linalg::bf16::decode(
+        linalg::bf16::encode(std::numeric_limits<float>::quiet_NaN()))));
+  }
+
+  SUBCASE("fp16 encoding") {
+    CHECK_EQ(linalg::fp16::encode(1.f), 0x3c00);
+    CHECK_EQ(linalg::fp16::encode(-2.f), 0xc000);
+    CHECK_EQ(linalg::fp16::encode(65504.f), 0x7bff);
+    CHECK_EQ(linalg::fp16::encode(1e6f), 0x7c00);
+    CHECK_EQ(linalg::fp16::encode(0x1p-24f), 0x0001);
+    CHECK_EQ(linalg::fp16::decode(0x3c00), 1.f);
+    CHECK_EQ(linalg::fp16::decode(0x7bff), 65504.f);
+    CHECK_EQ(linalg::fp16::decode(0x0001), 0x1p-24f);
+    CHECK_EQ(linalg::fp16::decode(0x8400), -0x1p-14f);
+    CHECK_EQ(linalg::fp16::decode(0xfc00),
+             -std::numeric_limits<float>::infinity());
+    CHECK_UNARY(std::isnan(linalg::fp16::decode(0x7e00)));
+
+    // every finite half survives a round trip through float
+    std::size_t mismatches = 0;
+    for (std::uint32_t h = 0; h < 0x10000; ++h) {
+      const auto half = static_cast<std::uint16_t>(h);
+      if ((half & 0x7c00) != 0x7c00 &&
+          linalg::fp16::encode(linalg::fp16::decode(half)) != half) {
+        ++mismatches;
+      }
+    }
+    CHECK_EQ(mismatches, 0);
+  }
+
+  SUBCASE("Round trips stay within the documented bounds") {
+    linalg::Vector x(1000);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x[static_cast<int>(i)] = std::sin(static_cast<float>(i)) * 10.f;
+    }
+    const linalg::BF16Vector b{x};
+    const linalg::FP16Vector h{x};
+    const linalg::Int8Vector q{x};
+    CHECK_EQ(b.bytes(), 2000);
+    CHECK_EQ(q.bytes(), 1000);
+    CHECK_EQ(q.scale(), doctest::Approx(linalg::max(x) / 127.f));
+
+    const auto bx = b.to_vector();
+    const auto hx = h.to_vector();
+    const auto qx = q.to_vector();
+    for (int i = 0; i < static_cast<int>(x.size()); ++i) {
+      CHECK_LE(std::abs(bx[i] - x[i]), std::abs(x[i]) * 0x1p-8f);
+      CHECK_LE(std::abs(hx[i] - x[i]), std::abs(x[i]) * 0x1p-11f);
+      CHECK_LE(std::abs(qx[i] - x[i]), q.scale() / 2 * 1.0001f);
+    }
+    CHECK_EQ(q.coeff(7), qx[7]);
+    CHECK_THROWS_AS(q.coeff(1000), std::out_of_range);
+
+    // NaN has no int8 value, it's stored as 0 and ignored by the scale
+    CHECK_EQ(linalg::int8::encode(std::numeric_limits<float>::quiet_NaN()), 0);
+    const linalg::Int8Vector with_nan{linalg::Vector({std::numeric_limits<float>::quiet_NaN(), 127})};
+    CHECK_EQ(with_nan.coeff(0), 0);
+    CHECK_EQ(with_nan.coeff(1), 127);
+  }
+
+  SUBCASE("Dot products on the compact form") {
+    linalg::Vector x(513);
+    linalg::Vector y(513);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x[static_cast<int>(i)] = std::cos(static_cast<float>(i) * 0.1f);
+      y[static_cast<int>(i)] = std::sin(static_cast<float>(i) * 0.3f) + 0.5f;
+    }
+    const auto exact = linalg::dot(x, y);
+
+    const linalg::BF16Vector bx{x};
+    const linalg::FP16Vector hx{x};
+    const linalg::Int8Vector qx{x};
+    CHECK_EQ(linalg::dot(bx, y), doctest::Approx(linalg::dot(bx.to_vector(), y)));
+    CHECK_EQ(linalg::dot(hx, y), doctest::Approx(linalg::dot(hx.to_vector(), y)));
+    CHECK_EQ(linalg::dot(y, qx), doctest::Approx(linalg::dot(qx.to_vector(), y)));
+    CHECK_EQ(linalg::dot(hx, y), doctest::Approx(exact).epsilon(1e-3));
+
+    const linalg::Int8Vector qy{y};
+    CHECK_EQ(linalg::dot(qx, qy),
+             doctest::Approx(linalg::dot(qx.to_vector(), qy.to_vector())));
+    CHECK_EQ(linalg::norm(hx), doctest::Approx(linalg::norm(x)).epsilon(1e-3));
+
+    // strided float operands take the generic path
+    const linalg::Matrix m{{1, 2}, {3, 4}, {5, 6}};
+    const linalg::FP16Vector ones{linalg::Vector({1, 1, 1})};
+    CHECK_EQ(linalg::dot(ones, m.col(1)), 12);
+
+    CHECK_THROWS_AS(linalg::dot(bx, linalg::Vector({1, 2})),
+                    std::invalid_argument);
+  }
+}
+
+TEST_CASE("Accumulation strategies") {
+  namespace acc = linalg::accumulate;
+
+  SUBCASE("Cancellation") {
+    // 1e8 + 1 rounds back to 1e8 in float, the 1 only survives with
+    // compensation or wider accumulators
+    linalg::Vector x(32, 0.f);
+    x[0] = 1e8f;
+    x[16] = 1.f;
+    x[1] = -1e8f;
+    CHECK_EQ(linalg::sum<acc::compensated>(x), 1.f);
+    CHECK_EQ(linalg::sum<acc::fp64>(x), 1.f);
+
+    const linalg::Vector ones(32, 1.f);
+    CHECK_EQ(linalg::dot<acc::compensated>(x, ones), 1.f);
+    CHECK_EQ(linalg::dot<acc::fp64>(ones, x), 1.f);
+
+    // the plain dot product accumulates in double
+    CHECK_EQ(linalg::dot(ones, x), 1.f);
+  }
+
+  SUBCASE("Error free products") {
+    // a * a = 1 + 2^-11 + 2^-24, the last bit is lost in the float product
+    const float a = 1.f + 0x1p-12f;
+    const linalg::Vector x{a, 1.f + 0x1p-11f};
+    const linalg::Vector y{a, -1.f};
+    CHECK_EQ(linalg::dot<acc::compensated>(x, y), 0x1p-24f);
+    CHECK_EQ(linalg::dot<acc::fp64>(x, y), 0x1p-24f);
+  }
+
+  SUBCASE("All strategies agree with a double reference") {
+    linalg::Vector x(100003);
+    double reference = 0;
+    double squares = 0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x[static_cast<int>(i)] = 0.1f + static_cast<float>(i % 7) * 0.01f;
+      reference += static_cast<double>(x[static_cast<int>(i)]);
+      squares += static_cast<double>(x[static_cast<int>(i)]) * x[static_cast<int>(i)];
+    }
+    const auto expected = static_cast<float>(reference);
+    CHECK_EQ(linalg::sum(x), doctest::Approx(expected).epsilon(1e-4));
+    CHECK_EQ(linalg::sum<acc::fast>(x), doctest::Approx(expected).epsilon(1e-4));
+    CHECK_EQ(linalg::sum<acc::pairwise>(x), doctest::Approx(expected).epsilon(1e-6));
+    CHECK_EQ(linalg::sum<acc::compensated>(x), expected);
+    CHECK_EQ(linalg::sum<acc::fp64>(x), expected);
+    CHECK_EQ(linalg::dot<acc::pairwise>(x, x), doctest::Approx(static_cast<float>(squares)).epsilon(1e-6));
+    CHECK_EQ(linalg::dot<acc::compensated>(x, x), static_cast<float>(squares));
+    CHECK_EQ(linalg::norm<acc::fp64>(x), doctest::Approx(std::sqrt(static_cast<float>(squares))));
+  }
+
+  SUBCASE("Strided views") {
+    const linalg::Matrix m{{1, 2}, {3, 4}, {5, 6}};
+    CHECK_EQ(linalg::sum<acc::pairwise>(m.col(1)), 12);
+    CHECK_EQ(linalg::sum<acc::compensated>(m.col(0)), 9);
+    CHECK_EQ(linalg::dot<acc::fp64>(m.col(0), m.col(1)), 44);
+    CHECK_EQ(linalg::dot<acc::fast>(m.col(0), linalg::Vector({1, 1, 1})), 9);
+    CHECK_THROWS_AS(linalg::dot<acc::compensated>(m.col(0), m.row(0)),
+                    std::invalid_argument);
+  }
+
+  SUBCASE("Products start from one") {
+    CHECK_EQ(linalg::prod(linalg::Vector({0.5f, 0.5f})), 0.25f);
+    CHECK_EQ(linalg::prod(linalg::Vector(0)), 1.f);
+  }
+}
+
+TEST_CASE("Sparse vectors") {
+  SUBCASE("Conversions") {
+    const linalg::Vector dense{0, 2, 0, 0, -1, 0, 3};
+    const linalg::SparseVector x{dense};
+    CHECK_EQ(x.size(), 7);
+    CHECK_EQ(x.nnz(), 3);
+    CHECK_EQ(x.indices()[1], 4);
+    CHECK_EQ(x.values()[2], 3);
+    CHECK_EQ(x.coeff(4), -1);
+    CHECK_EQ(x.coeff(5), 0);
+    CHECK_THROWS_AS(x.coeff(7), std::out_of_range);
+    CHECK_EQ(x.bytes(), 24);
+    const auto x_dense = x.to_vector();
+    CHECK_UNARY(std::equal(x_dense.begin(), x_dense.end(), dense.begin(), dense.end()));
+
+    linalg::SparseVector y(7);
+    y.push_back(1, 2);
+    y.push_back(3, 0);
+    y.push_back(4, -1);
+    y.push_back(6, 3);
+    CHECK_EQ(y.nnz(), 3);
+    const auto y_dense = y.to_vector();
+    CHECK_UNARY(std::equal(y_dense.begin(), y_dense.end(), dense.begin(), dense.end()));
+    CHECK_THROWS_AS(y.push_back(6, 1), std::invalid_argument);
+    CHECK_THROWS_AS(linalg::SparseVector(8, {1}, {2}).push_back(8, 1),
+                    std::invalid_argument);
+
+    CHECK_THROWS_AS(linalg::SparseVector(4, {2, 1}, {1, 1}), std::invalid_argument);
+    CHECK_THROWS_AS(linalg::SparseVector(4, {1, 4}, {1, 1}), std::invalid_argument);
+    CHECK_THROWS_AS(linalg::SparseVector(4, {1}, {1, 1}), std::invalid_argument);
+
+    // the indices are 32 bit
+    CHECK_THROWS_AS(linalg::SparseVector(std::size_t{1} << 32), std::length_error);
+    CHECK_THROWS_AS(linalg::SparseVector(std::size_t{1} << 32, {1}, {1}), std::length_error);
+    CHECK_EQ(linalg::SparseVector(std::size_t{1} << 31).size(), std::size_t{1} << 31);
+  }
+
+  SUBCASE("Reductions count the implicit zeros") {
+    const linalg::SparseVector x{linalg::Vector({0, 2, 0, 4})};
+    CHECK_EQ(linalg::min(x), 0);
+    CHECK_EQ(linalg::max(x), 4);
+    CHECK_EQ(linalg::sum(x), 6);
+    CHECK_EQ(linalg::non_zeros(x), 2);
+    CHECK_EQ(linalg::norm(x), doctest::Approx(std::sqrt(20.f)));
+
+    const linalg::SparseVector full{linalg::Vector({1, 2, 3})};
+    CHECK_EQ(linalg::min(full), 1);
+    CHECK_EQ(linalg::max(linalg::SparseVector{linalg::Vector({-1, -2})}), -1);
+    CHECK_THROWS_AS(linalg::min(linalg::SparseVector{}), std::invalid_argument);
+  }
+
+  SUBCASE("Dot products") {
+    // indices that interleave irregularly, so the blockwise intersection
+    // advances both lists unevenly
+    const std::size_t n = 2000;
+    linalg::Vector a(n, 0.f);
+    linalg::Vector b(n, 0.f);
+    for (std::size_t i = 0; i < n; ++i) {
+      if (i % 3 == 0 || i % 7 == 0) {
+        a[static_cast<int>(i)] = static_cast<float>(i % 5) - 2;
+      }
+      if (i % 5 == 1 || i % 11 == 0) {
+        b[static_cast<int>(i)] = static_cast<float>(i % 4) + 1;
+      }
+    }
+    const linalg::SparseVector sa{a};
+    const linalg::SparseVector sb{b};
+    const float expected = linalg::dot(a, b);
+    CHECK_EQ(linalg::dot(sa, sb), expected);
+    CHECK_EQ(linalg::dot(sb, sa), expected);
+    CHECK_EQ(linalg::dot(sa, b), expected);
+    CHECK_EQ(linalg::dot(a, sb), expected);
+    CHECK_EQ(linalg::dot(sa, linalg::SparseVector(n)), 0);
+
+    const linalg::Matrix m{{1, 2}, {3, 4}, {5, 6}};
+    const linalg::SparseVector e{linalg::Vector({0, 1, 1})};
+    CHECK_EQ(linalg::dot(e, m.col(1)), 10);
+    CHECK_THROWS_AS(linalg::dot(e, linalg::Vector({1, 2})), std::invalid_argument);
+    CHECK_THROWS_AS(linalg::dot(e, sa), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Static vectors") {
+  SUBCASE("Compile time evaluation") {
+    constexpr linalg::Vector3 x{1, 2, 2};
+    constexpr linalg::Vector3 y{0, 1, 0};
+    static_assert(linalg::dot(x, y) == 2);
+    static_assert(linalg::norm(x) == 3);
+    static_assert(linalg::sum(x + y) == 6);
+    static_assert(linalg::cross(y, x) == linalg::Vector3{2, 0, -1});
+    static_assert(linalg::normalized(x * 2.f)[1] == 2.f / 3);
+    static_assert(sizeof(linalg::Vector4) == 4 * sizeof(float));
+    static_assert(linalg::static_vector<linalg::Vector4>);
+    static_assert(!linalg::static_vector<linalg::Vector>);
+    static_assert(linalg::StaticVector<int, 2>{3, 4} * 2 == linalg::StaticVector<int, 2>{6, 8});
+    CHECK_EQ(linalg::norm(x), 3);
+  }
+
+  SUBCASE("Runtime operations") {
+    linalg::Vector4 x{4, -3, 2, 1};
+    CHECK_EQ(x.size(), 4);
+    CHECK_EQ(x[1], -3);
+    CHECK_EQ(x.coeff(3), 1);
+    CHECK_THROWS_AS(x.coeff(4), std::out_of_range);
+    CHECK_EQ(linalg::min(x), -3);
+    CHECK_EQ(linalg::max(x), 4);
+
+    x -= linalg::Vector4{1.f};
+    CHECK_EQ(x, linalg::Vector4{3, -4, 1, 0});
+    CHECK_EQ(-x / 2.f, linalg::Vector4{-1.5f, 2, -0.5f, 0});
+
+    linalg::Vector3 n{0, 3, 4};
+    linalg::normalize(n);
+    CHECK_EQ(n[1], doctest::Approx(0.6f));
+    CHECK_EQ(linalg::norm(n), doctest::Approx(1.f));
+  }
+
+  SUBCASE("Float vectors convert to views") {
+    const linalg::Vector3 x{1, 5, 3};
+    CHECK_EQ(linalg::argmax(x), 1);
+    CHECK_EQ(linalg::dot(x, linalg::Vector({1, 1, 1})), 9);
+    const linalg::VectorView v = x;
+    CHECK_EQ(v.size(), 3);
+    CHECK_EQ(v.data(), x.data());
+  }
+}
+
+TEST_CASE("Binary vector files") {
+  const auto dir = std::filesystem::temp_directory_path();
+  const auto path = dir / "linalg_test06.bin";
+
+  SUBCASE("Single vectors") {
+    const linalg::Vector x{1.5f, -2, 0, 1e-30f};
+    linalg::write(path, x);
+    CHECK_EQ(std::filesystem::file_size(path), 64 + 4 * sizeof(float));
+    const auto y = linalg::read_vector(path);
+    CHECK_UNARY(std::equal(x.begin(), x.end(), y.begin(), y.end()));
+
+    // strided views are written densely
+    const linalg::Matrix m{{1, 2}, {3, 4}};
+    linalg::write(path, m.col(1));
+    const auto col = linalg::read_vector(path);
+    CHECK_EQ(col.size(), 2);
+    CHECK_EQ(col[1], 4);
+  }
+
+  SUBCASE("Collections and memory mapping") {
+    linalg::VectorCollection c{3};
+    for (int i = 0; i < 40; ++i) {
+      c.push_back(linalg::Vector({static_cast<float>(i), 1, -static_cast<float>(i)}));
+    }
+    linalg::write(path, c);
+
+    const linalg::MappedVectors mapped{path};
+    CHECK_EQ(mapped.rows(), 40);
+    CHECK_EQ(mapped.dim(), 3);
+    CHECK_EQ(mapped[7][2], -7);
+    CHECK_EQ(mapped.row(39)[0], 39);
+    CHECK_EQ(mapped.data().size(), 120);
+    CHECK_EQ(reinterpret_cast<std::uintptr_t>(mapped[0].data()) % 64, 0);
+    CHECK_THROWS_AS(mapped.row(40), std::out_of_range);
+
+    const auto read = linalg::read_collection(path);
+    CHECK_EQ(read.size(), 40);
+    CHECK_EQ(read.coeff(21, 0), 21);
+    CHECK_THROWS_AS(linalg::read_vector(path), std::runtime_error);
+  }
+
+  SUBCASE("Streaming writer") {
+    const std::size_t dim = 1000;
+    {
+      linalg::VectorWriter writer{path, dim};
+      // more than one chunk
+      for (std::size_t i = 0; i < 300; ++i) {
+        writer.write(linalg::Vector(dim, static_cast<float>(i)));
+      }
+      CHECK_EQ(writer.rows(), 300);
+      CHECK_THROWS_AS(writer.write(linalg::Vector(3)), std::invalid_argument);
+    }
+    const linalg::MappedVectors mapped{path};
+    CHECK_EQ(mapped.rows(), 300);
+    CHECK_EQ(mapped[299][999], 299);
+    CHECK_EQ(linalg::sum(mapped[3]), 3000);
+  }
+
+  SUBCASE("Malformed files") {
+    CHECK_THROWS_AS(linalg::MappedVectors{dir / "linalg_test06_missing.bin"},
+                    std::runtime_error);
+    {
+      std::ofstream out{path, std::ios::binary | std::ios::trunc};
+      out << "this is no vector file, but it is long enough for a header........";
+    }
+    CHECK_THROWS_AS(linalg::MappedVectors{path}, std::runtime_error);
+    CHECK_THROWS_AS(linalg::read_vector(path), std::runtime_error);
+
+    // a header promising more rows than the file holds
+    linalg::write(path, linalg::Vector({1, 2, 3}));
+    std::filesystem::resize_file(path, 64 + 8);
+    CHECK_THROWS_AS(linalg::MappedVectors{path}, std::runtime_error);
+
+    // headers whose sizes would wrap around when added up
+    const auto write_header = [&](std::uint64_t rows, std::uint64_t dim, std::uint64_t offset) {
+      linalg::write(path, linalg::Vector({1, 2, 3}));
+      linalg::FileHeader header{};
+      {
+        std::ifstream in{path, std::ios::binary};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+      }
+      header.rows = rows;
+      header.dim = dim;
+      header.data_offset = offset;
+      std::fstream out{path, std::ios::binary | std::ios::in | std::ios::out};
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    };
+    write_header(1, 3, ~std::uint64_t{63});
+    CHECK_THROWS_AS(linalg::MappedVectors{path}, std::runtime_error);
+    write_header(1, std::uint64_t{1} << 62, 64);
+    CHECK_THROWS_AS(linalg::MappedVectors{path}, std::runtime_error);
+    write_header(std::uint64_t{1} << 40, 0, 64);
+    CHECK_THROWS_AS(linalg::read_collection(path), std::runtime_error);
+  }
+
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Fused statistics") {
+  SUBCASE("Single pass results") {
+    linalg::Vector x(1000);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x[static_cast<int>(i)] = static_cast<float>((i * 37) % 101) - 50;
+    }
+    x[500] = -70;
+    x[900] = -70;
+    x[17] = 80;
+
+    const auto s = linalg::statistics(x);
+    CHECK_EQ(s.size, 1000);
+    CHECK_EQ(s.min, linalg::min(x));
+    CHECK_EQ(s.max, linalg::max(x));
+    CHECK_EQ(s.argmin, linalg::argmin(x));
+    CHECK_EQ(s.argmin, 500);
+    CHECK_EQ(s.argmax, linalg::argmax(x));
+    CHECK_EQ(s.non_zeros, linalg::non_zeros(x));
+    CHECK_EQ(s.sum, doctest::Approx(linalg::sum<linalg::accumulate::fp64>(x)));
+    CHECK_EQ(s.sum_of_squares, doctest::Approx(linalg::dot(x, x)));
+    CHECK_EQ(s.mean, doctest::Approx(s.sum / 1000));
+    CHECK_EQ(s.variance, doctest::Approx(s.sum_of_squares / 1000 - s.mean * s.mean));
+  }
+
+  SUBCASE("Variance with a large offset") {
+    // mean 1e4, standard deviation 1: sum of squares minus squared sum would
+    // cancel almost all digits in float
+    linalg::Vector x(4096);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x[static_cast<int>(i)] = 10000.f + (i % 2 == 0 ? 1.f : -1.f);
+    }
+    const auto s = linalg::statistics(x);
+    CHECK_EQ(s.mean, doctest::Approx(10000.f));
+    CHECK_EQ(s.variance, doctest::Approx(1.f));
+  }
+
+  SUBCASE("Special values and views") {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const auto s = linalg::statistics(linalg::Vector({nan, 2, -0.f, -3, nan}));
+    CHECK_EQ(s.min, -3);
+    CHECK_EQ(s.argmin, 3);
+    CHECK_EQ(s.max, 2);
+    CHECK_EQ(s.argmax, 1);
+    CHECK_EQ(s.non_zeros, 4);
+
+    const linalg::Matrix m{{1, 2}, {3, 4}, {5, 0}};
+    const auto col = linalg::statistics(m.col(1));
+    CHECK_EQ(col.min, 0);
+    CHECK_EQ(col.argmin, 2);
+    CHECK_EQ(col.sum, 6);
+    CHECK_EQ(col.non_zeros, 2);
+
+    CHECK_THROWS_AS(linalg::statistics(linalg::Vector(0)), std::invalid_argument);
+  }
+
+  SUBCASE("In place scaling") {
+    linalg::Vector x{2, 4, 6, 10};
+    linalg::minmax_scale(x);
+    CHECK_EQ(x[0], 0);
+    CHECK_EQ(x[1], doctest::Approx(0.25f));
+    CHECK_EQ(x[3], 1);
+
+    linalg::minmax_scale(x, -1, 1);
+    CHECK_EQ(x[0], -1);
+    CHECK_EQ(x[3], 1);
+
+    linalg::Vector constant(5, 3.f);
+    linalg::minmax_scale(constant, 2, 4);
+    CHECK_EQ(linalg::max(constant), 2);
+
+    linalg::Vector y{1, 2, 3, 4, 5};
+    linalg::standardize(y);
+    const auto s = linalg::statistics(y);
+    CHECK_EQ(s.mean, doctest::Approx(0.f));
+    CHECK_EQ(s.variance, doctest::Approx(1.f));
+    CHECK_EQ(y[0], doctest::Approx(-std::sqrt(2.f)));
+
+    linalg::standardize(constant);
+    CHECK_EQ(linalg::max(constant), 0);
+    CHECK_EQ(linalg::min(constant), 0);
+  }
+
+  SUBCASE("Scaling with a large offset") {
+    // 1e6 + k / 16 for k in 0..9: exact in float, but folding the offset
+    // into one constant would round the results to multiples of 1/8
+    linalg::Vector x(1000);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x[static_cast<int>(i)] = 1e6f + static_cast<float>(i % 10) * 0.0625f;
+    }
+    linalg::Vector y{x};
+
+    linalg::minmax_scale(x);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      CHECK_EQ(x[static_cast<int>(i)], doctest::Approx(static_cast<float>(i % 10) / 9));
+    }
+
+    linalg::standardize(y);
+    const auto s = linalg::statistics(y);
+    CHECK_LT(std::abs(s.mean), 1e-6f);
+    CHECK_EQ(s.variance, doctest::Approx(1.f));
+  }
+}
@@ -7,7 +7,15 @@
  * safety of others, please refrain from touching ѤުϖÖƔАӇȥ̒ΔЙ җؕնÛ ߚɸӱҟˍ҇ĊɠûݱȡνȬ
  */
 
+#include <atomic>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
 #include <limits>
+#include <random>
+#include <thread>
+
+#include <sys/resource.h>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
 // if you activate this, doctest won't swallow exceptions
@@ -692,3 +700,1291 @@ TEST_CASE("File_rename") {
     }
 }
 
+
+
+TEST_CASE("Content_dedup") {
+    // a shared content can't be written through one of its files
+    static_assert(std::is_const_v<decltype(FileContent::string_)::element_type>);
+
+    auto fs = std::make_shared<Filesystem>();
+    std::string buf = str_repeat(1000, "dup");
+
+    auto doc1 = std::make_shared<Document>(FileContent{buf});
+    auto doc2 = std::make_shared<Document>(FileContent{buf});
+    auto img = std::make_shared<Image>(FileContent{"unique"}, Image::resolution_t{1, 1});
+
+    // unregistered files keep their own copy
+    CHECK_NE(doc1->get_content().get(), doc2->get_content().get());
+
+    CHECK_EQ(fs->register_file("a.doc", doc1), true);
+    CHECK_EQ(fs->register_file("b.doc", doc2), true);
+    CHECK_EQ(fs->register_file("c.img", img), true);
+
+    // identical bytes are stored once
+    CHECK_EQ(doc1->get_content().string_, doc2->get_content().string_);
+    CHECK_EQ(doc1->get_content().get(), doc2->get_content().get());
+    CHECK_EQ(*doc2->get_content().get(), buf);
+
+    // the documents are stored compressed
+    const size_t stored = doc1->get_size();
+    CHECK_LT(stored, buf.size());
+    CHECK_EQ(doc1->get_raw_size(), buf.size());
+
+    auto usage = fs->usage();
+    CHECK_EQ(usage.logical, fs->in_use());
+    CHECK_EQ(usage.logical, 2 * stored + 6);
+    CHECK_EQ(usage.physical, stored + 6);
+
+    SUBCASE("across_filesystems") {
+        auto fs2 = std::make_shared<Filesystem>();
+        auto doc3 = std::make_shared<Document>(FileContent{buf});
+        CHECK_EQ(fs2->register_file("c.doc", doc3), true);
+        CHECK_EQ(doc3->get_content().string_, doc1->get_content().string_);
+        CHECK_EQ(fs2->usage().physical, stored);
+    }
+
+    SUBCASE("update") {
+        // updating to existing content shares it
+        auto doc3 = std::make_shared<Document>(FileContent{"tiny"});
+        CHECK_EQ(fs->register_file("d.doc", doc3), true);
+        doc3->update(FileContent{buf});
+        CHECK_EQ(doc3->get_content().string_, doc1->get_content().string_);
+        CHECK_EQ(fs->usage().physical, stored + 6);
+        CHECK_EQ(fs->in_use(), 3 * stored + 6);
+
+        // updating to new content detaches from it
+        doc1->update(FileContent{"changed"});
+        CHECK_NE(doc1->get_content().string_, doc2->get_content().string_);
+        CHECK_EQ(*doc2->get_content().get(), buf);
+        CHECK_EQ(fs->usage().physical, stored + 6 + 7);
+    }
+
+    SUBCASE("release") {
+        std::weak_ptr<const std::string> shared = doc1->get_content().string_;
+        CHECK_EQ(fs->remove_file("a.doc"), true);
+        CHECK_EQ(fs->remove_file("b.doc"), true);
+        doc1.reset();
+        doc2.reset();
+        // no file holds the content anymore, so it is freed
+        CHECK_EQ(shared.expired(), true);
+
+        // a later file with the same bytes gets a fresh copy
+        auto doc3 = std::make_shared<Document>(FileContent{buf});
+        CHECK_EQ(fs->register_file("d.doc", doc3), true);
+        CHECK_EQ(*doc3->get_content().get(), buf);
+        CHECK_EQ(fs->usage().physical, stored + 6);
+    }
+
+    CHECK_EQ(fs.use_count(), 1);
+}
+
+
+TEST_CASE("Filesystem_stats") {
+    auto fs = std::make_shared<Filesystem>();
+    auto doc = std::make_shared<Document>("some text");
+    auto img = std::make_shared<Image>("pixels", Image::resolution_t{2, 2});
+
+    CHECK_EQ(fs->get_type_stats("DOC").count, 0);
+    CHECK_EQ(fs->register_file("a.txt", doc), true);
+    CHECK_EQ(fs->register_file("b.png", img), true);
+    // hardlink: the same content object in two files
+    auto link = std::make_shared<Document>(FileContent{doc->get_content()});
+    CHECK_EQ(fs->register_file("link.txt", link), true);
+
+    CHECK_EQ(fs->in_use(), 24);
+    CHECK_EQ(fs->usage().physical, 15);
+    CHECK_EQ(fs->get_type_stats("DOC").count, 2);
+    CHECK_EQ(fs->get_type_stats("DOC").bytes, 18);
+    CHECK_EQ(fs->get_type_stats("IMG").count, 1);
+    CHECK_EQ(fs->get_type_stats("IMG").bytes, 6);
+
+    // renaming doesn't change anything
+    CHECK_EQ(doc->rename("c.txt"), true);
+    CHECK_EQ(fs->in_use(), 24);
+    CHECK_EQ(fs->get_type_stats("DOC").count, 2);
+
+    // updating a registered file
+    img->update(FileContent{"more pixels"}, {3, 3});
+    CHECK_EQ(fs->in_use(), 29);
+    CHECK_EQ(fs->get_type_stats("IMG").bytes, 11);
+    CHECK_EQ(fs->usage().physical, 20);
+
+    // the shared content stays as long as one file uses it
+    CHECK_EQ(fs->remove_file("c.txt"), true);
+    CHECK_EQ(fs->in_use(), 20);
+    CHECK_EQ(fs->usage().physical, 20);
+    CHECK_EQ(fs->get_type_stats("DOC").count, 1);
+    CHECK_EQ(fs->remove_file("link.txt"), true);
+    CHECK_EQ(fs->usage().physical, 11);
+    CHECK_EQ(fs->get_type_stats("DOC").bytes, 0);
+
+    // a removed file no longer counts when updated
+    doc->update(FileContent{"ignored"});
+    CHECK_EQ(fs->in_use(), 11);
+    CHECK_EQ(fs->usage().logical, 11);
+}
+
+
+TEST_CASE("Size_index") {
+    auto fs = std::make_shared<Filesystem>();
+    fs->register_file("a", std::make_shared<Document>("1"));
+    fs->register_file("b", std::make_shared<Document>("22"));
+    fs->register_file("c", std::make_shared<Document>("333"));
+    fs->register_file("d", std::make_shared<Document>("444"));
+    fs->register_file("e", std::make_shared<Document>("55555"));
+
+    SUBCASE("ordered") {
+        std::vector<size_t> sizes;
+        fs->visit_files_in_size_range(4, 2, [&](const std::shared_ptr<File>& file) {
+            sizes.push_back(file->get_size());
+        });
+        CHECK_EQ(sizes, std::vector<size_t>{2, 3, 3});
+        CHECK_EQ(fs->files_in_size_range(1, 2).size(), 0);
+    }
+
+    SUBCASE("stop_early") {
+        size_t visited = 0;
+        fs->visit_files_in_size_range(std::numeric_limits<size_t>::max(), 0,
+                                      [&](const std::shared_ptr<File>&) {
+            visited += 1;
+            return visited < 2;
+        });
+        CHECK_EQ(visited, 2);
+    }
+
+    SUBCASE("updates") {
+        auto file = std::dynamic_pointer_cast<Document>(fs->get_file("a"));
+        file->update(FileContent{"1234"});
+        auto found = fs->files_in_size_range(4, 4);
+        CHECK_EQ(found.size(), 1);
+        CHECK_EQ(found[0], file);
+        CHECK_EQ(fs->files_in_size_range(1).size(), 0);
+
+        CHECK_EQ(fs->remove_file("c"), true);
+        CHECK_EQ(fs->files_in_size_range(3, 3).size(), 1);
+        CHECK_EQ(fs->files_in_size_range(3, 3)[0]->get_name(), "d");
+    }
+}
+
+
+TEST_CASE("Name_table") {
+    auto fs = std::make_shared<Filesystem>();
+    const size_t n = 2000;
+    for (size_t i = 0; i < n; ++i) {
+        auto name = "file" + std::to_string(i);
+        CHECK_EQ(fs->register_file(name, std::make_shared<Document>(FileContent{name})), true);
+    }
+    CHECK_EQ(fs->get_file_count(), n);
+
+    // lookup by string_view, no std::string needed
+    std::string_view name = "file1234";
+    CHECK_EQ(fs->get_file(name)->get_name(), "file1234");
+    CHECK_EQ(fs->get_file("file2000"), nullptr);
+
+    // remove every second file, the others must stay reachable
+    for (size_t i = 0; i < n; i += 2) {
+        CHECK_EQ(fs->remove_file("file" + std::to_string(i)), true);
+    }
+    CHECK_EQ(fs->get_file_count(), n / 2);
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto file = fs->get_file("file" + std::to_string(i));
+        if (file != nullptr) {
+            CHECK_EQ(*file->get_content().get(), file->get_name());
+            found += 1;
+        }
+    }
+    CHECK_EQ(found, n / 2);
+
+    CHECK_EQ(fs->rename_file("file1", "a_first"), true);
+    CHECK_EQ(fs->rename_file("file3", "file5"), false);
+    CHECK_EQ(fs->get_file("file1"), nullptr);
+    CHECK_EQ(fs->get_file("a_first")->get_name(), "a_first");
+
+    // the overview lists the files sorted by name
+    auto overview = fs->file_overview();
+    CHECK_LT(overview.find("Name:a_first "), overview.find("Name:file11 "));
+    CHECK_LT(overview.find("Name:file11 "), overview.find("Name:file13 "));
+}
+
+
+TEST_CASE("Directories") {
+    auto fs = std::make_shared<Filesystem>(4);
+    CHECK_EQ(fs->register_file("a/b/one.txt", std::make_shared<Document>("1")), true);
+    CHECK_EQ(fs->register_file("a/b/two.txt", std::make_shared<Document>("22")), true);
+    CHECK_EQ(fs->register_file("a/c/three.txt", std::make_shared<Document>("333")), true);
+    CHECK_EQ(fs->register_file("a/four.txt", std::make_shared<Document>("4444")), true);
+    CHECK_EQ(fs->register_file("top.txt", std::make_shared<Document>("55555")), true);
+
+    // every part of a path needs a name
+    CHECK_EQ(fs->register_file("/x", std::make_shared<Document>("x")), false);
+    CHECK_EQ(fs->register_file("x/", std::make_shared<Document>("x")), false);
+    CHECK_EQ(fs->register_file("x//y", std::make_shared<Document>("x")), false);
+    CHECK_EQ(fs->rename_file("top.txt", "a//top.txt"), false);
+
+    SUBCASE("list") {
+        auto root = fs->list_dir("");
+        REQUIRE_EQ(root.size(), 2);
+        CHECK_EQ(root[0].name, "a");
+        CHECK_EQ(root[0].file, nullptr);
+        CHECK_EQ(root[0].count, 4);
+        CHECK_EQ(root[0].bytes, 10);
+        CHECK_EQ(root[1].name, "top.txt");
+        CHECK_EQ(root[1].file, fs->get_file("top.txt"));
+
+        auto a = fs->list_dir("a");
+        REQUIRE_EQ(a.size(), 3);
+        CHECK_EQ(a[0].name, "b");
+        CHECK_EQ(a[1].name, "c");
+        CHECK_EQ(a[2].name, "four.txt");
+        CHECK_EQ(a[2].bytes, 4);
+
+        CHECK_EQ(fs->list_dir("a/b").size(), 2);
+        CHECK_EQ(fs->list_dir("a/x").size(), 0);
+        CHECK_EQ(fs->list_dir("top.txt").size(), 0);
+    }
+
+    SUBCASE("stats") {
+        CHECK_EQ(fs->get_dir_stats("").count, 5);
+        CHECK_EQ(fs->get_dir_stats("").bytes, 15);
+        CHECK_EQ(fs->get_dir_stats("a/b").bytes, 3);
+
+        // the totals follow the changes
+        auto two = std::dynamic_pointer_cast<Document>(fs->get_file("a/b/two.txt"));
+        two->update(FileContent{"twenty"});
+        CHECK_EQ(fs->get_dir_stats("a/b").bytes, 7);
+        CHECK_EQ(fs->get_dir_stats("a").bytes, 14);
+        CHECK_EQ(two->rename("a/c/two.txt"), true);
+        CHECK_EQ(fs->get_dir_stats("a/b").bytes, 1);
+        CHECK_EQ(fs->get_dir_stats("a/c").count, 2);
+
+        // directories go away with their last file
+        CHECK_EQ(fs->remove_file("a/b/one.txt"), true);
+        CHECK_EQ(fs->get_dir_stats("a/b").count, 0);
+        CHECK_EQ(fs->list_dir("a").size(), 2);
+        CHECK_EQ(fs->get_dir_stats("a").count, 3);
+    }
+
+    SUBCASE("rename_dir") {
+        auto one = fs->get_file("a/b/one.txt");
+        CHECK_EQ(fs->rename_dir("a", "x/y"), true);
+        CHECK_EQ(one->get_name(), "x/y/b/one.txt");
+        CHECK_EQ(fs->get_file("x/y/b/one.txt"), one);
+        CHECK_EQ(fs->get_file("a/b/one.txt"), nullptr);
+        CHECK_NE(fs->get_file("x/y/c/three.txt"), nullptr);
+        CHECK_EQ(fs->get_dir_stats("a").count, 0);
+        CHECK_EQ(fs->get_dir_stats("x").count, 4);
+        CHECK_EQ(fs->get_dir_stats("x/y").bytes, 10);
+        CHECK_EQ(fs->list_dir("").size(), 2);
+        CHECK_EQ(fs->get_file_count(), 5);
+
+        // moving within its own parent, the parent is emptied on the way
+        CHECK_EQ(fs->rename_dir("x/y", "x/z"), true);
+        CHECK_EQ(fs->list_dir("x").size(), 1);
+        CHECK_EQ(fs->list_dir("x")[0].name, "z");
+
+        CHECK_EQ(fs->rename_dir("x/z/b", "x/z/c"), false);
+        CHECK_EQ(fs->rename_dir("x/z", "x/z/w"), false);
+        CHECK_EQ(fs->rename_dir("nothing", "q"), false);
+        CHECK_EQ(fs->rename_dir("", "q"), false);
+        CHECK_EQ(fs->rename_dir("x/z/b", "x/z/c/b"), true);
+        CHECK_EQ(one->get_name(), "x/z/c/b/one.txt");
+        CHECK_EQ(fs->get_dir_stats("x/z/c").count, 3);
+    }
+}
+
+
+TEST_CASE("Batch") {
+    auto fs = std::make_shared<Filesystem>(4);
+    auto taken = std::make_shared<Document>("taken");
+    CHECK_EQ(fs->register_file("taken.txt", taken), true);
+
+    auto one = std::make_shared<Document>("same");
+    auto two = std::make_shared<Document>("same");
+    auto three = std::make_shared<Document>("three");
+    std::vector<std::pair<std::string, std::shared_ptr<File>>> files{
+        {"a/one.txt", one},
+        {"a/two.txt", two},
+        {"a/one.txt", three},        // name taken within the batch
+        {"b/one.txt", one},          // file listed twice
+        {"taken.txt", three},        // name taken before
+        {"c/taken.txt", taken},      // file registered before
+        {"bad//name", three},
+        {"empty.txt", nullptr},
+        {"b/three.txt", three},
+    };
+
+    const auto registered = fs->register_files(files);
+    CHECK_EQ(registered, std::vector<bool>{true, true, false, false, false, false, false, false, true});
+    CHECK_EQ(one->get_name(), "a/one.txt");
+    CHECK_EQ(three->get_name(), "b/three.txt");
+    CHECK_EQ(taken->get_name(), "taken.txt");
+    CHECK_EQ(fs->get_file("a/one.txt"), one);
+
+    // the totals and the directories are those of one by one
+    CHECK_EQ(fs->get_file_count(), 4);
+    CHECK_EQ(fs->get_type_stats("DOC").count, 4);
+    CHECK_EQ(fs->in_use(), 18);
+    CHECK_EQ(fs->usage().physical, 14);
+    CHECK_EQ(fs->get_dir_stats("a").count, 2);
+    CHECK_EQ(fs->get_dir_stats("b").bytes, 5);
+    CHECK_EQ(fs->files_in_size_range(4, 4).size(), 2);
+
+    SUBCASE("remove") {
+        const std::vector<std::string> names{"a/one.txt", "missing", "a/one.txt", "b/three.txt"};
+        CHECK_EQ(fs->remove_files(names), std::vector<bool>{true, false, false, true});
+        CHECK_EQ(one->get_name(), "");
+        CHECK_EQ(fs->get_file("a/one.txt"), nullptr);
+        CHECK_EQ(fs->get_file_count(), 2);
+        CHECK_EQ(fs->get_dir_stats("a").count, 1);
+        CHECK_EQ(fs->get_dir_stats("b").count, 0);
+        CHECK_EQ(fs->in_use(), 9);
+
+        // removed files can be registered again
+        CHECK_EQ(fs->register_file("b/one.txt", one), true);
+    }
+
+    SUBCASE("large") {
+        // beyond one part of a batch, the same file in two parts
+        std::vector<std::pair<std::string, std::shared_ptr<File>>> many;
+        std::vector<std::string> names;
+        for (size_t i = 0; i < 10000; ++i) {
+            names.push_back("many/" + std::to_string(i));
+            many.emplace_back(names.back(), std::make_shared<Document>(FileContent{std::to_string(i % 100)}));
+        }
+        many.emplace_back("many/again", many[5].second);
+
+        const auto added = fs->register_files(many);
+        CHECK_EQ(std::count(added.begin(), added.end(), true), 10000);
+        CHECK_EQ(added.back(), false);
+        CHECK_EQ(fs->get_dir_stats("many").count, 10000);
+        CHECK_EQ(fs->get_file("many/1234")->get_name(), "many/1234");
+
+        const auto removed = fs->remove_files(names);
+        CHECK_EQ(std::count(removed.begin(), removed.end(), true), 10000);
+        CHECK_EQ(fs->get_file_count(), 4);
+        CHECK_EQ(fs->list_dir("many").size(), 0);
+    }
+
+    SUBCASE("logged") {
+        const auto directory = std::filesystem::temp_directory_path() / "hw07_test_batch";
+        std::filesystem::remove_all(directory);
+        {
+            auto logged = WriteAheadLog::open(directory.string());
+            std::vector<std::pair<std::string, std::shared_ptr<File>>> batch{
+                {"x.txt", std::make_shared<Document>("x")},
+                {"y.txt", std::make_shared<Document>("y")},
+                {"z.txt", std::make_shared<Document>("z")},
+            };
+            CHECK_EQ(logged->register_files(batch), std::vector<bool>{true, true, true});
+            const std::vector<std::string> names{"y.txt"};
+            CHECK_EQ(logged->remove_files(names), std::vector<bool>{true});
+            CHECK_EQ(logged->get_log()->get_stats().logged, 4);
+        }
+        auto recovered = WriteAheadLog::open(directory.string());
+        CHECK_EQ(recovered->get_file_count(), 2);
+        CHECK_EQ(*recovered->get_file("z.txt")->get_content().get(), "z");
+        CHECK_EQ(recovered->get_file("y.txt"), nullptr);
+        recovered = nullptr;
+        std::filesystem::remove_all(directory);
+    }
+}
+
+
+TEST_CASE("Versions") {
+    std::string text;
+    for (int i = 0; i < 20000; ++i) {
+        text += "version line " + std::to_string(i) + "\n";
+    }
+    auto doc = std::make_shared<Document>(FileContent{text});
+    CHECK_EQ(doc->get_history(), nullptr);
+    CHECK_EQ(doc->get_version(1), std::nullopt);
+    doc->keep_versions({8, 64 << 20});
+
+    // small edits in the middle of a large document
+    std::vector<std::string> texts{text};
+    for (int i = 0; i < 5; ++i) {
+        text.insert(text.size() / 2 + static_cast<size_t>(i) * 1000, "edit " + std::to_string(i));
+        texts.push_back(text);
+        doc->update(FileContent{text});
+    }
+
+    const VersionHistory *history = doc->get_history();
+    REQUIRE_NE(history, nullptr);
+    CHECK_EQ(history->current(), 6);
+    CHECK_EQ(history->versions(), std::vector<uint64_t>{1, 2, 3, 4, 5});
+    for (uint64_t version = 1; version <= 6; ++version) {
+        auto content = doc->get_version(version);
+        REQUIRE(content.has_value());
+        CHECK_EQ(*content->get(), texts[version - 1]);
+    }
+    CHECK_EQ(doc->get_version(7), std::nullopt);
+    // only the edited blocks are stored again
+    CHECK_GE(history->stored_bytes(), texts[0].size());
+    CHECK_LT(history->stored_bytes(), texts[0].size() + texts[0].size() / 4);
+
+    SUBCASE("retention") {
+        doc->keep_versions({2, 64 << 20});
+        CHECK_EQ(history->versions(), std::vector<uint64_t>{4, 5});
+        CHECK_EQ(doc->get_version(3), std::nullopt);
+        doc->update(FileContent{"short"});
+        CHECK_EQ(history->versions(), std::vector<uint64_t>{5, 6});
+        CHECK_EQ(*doc->get_version(6)->get(), texts[5]);
+
+        // a byte limit drops everything that doesn't fit
+        doc->keep_versions({8, 1000});
+        CHECK_EQ(history->versions().size(), 0);
+        CHECK_EQ(history->stored_bytes(), 0);
+        doc->update(FileContent{"shorter"});
+        CHECK_EQ(history->versions(), std::vector<uint64_t>{7});
+        CHECK_EQ(history->stored_bytes(), 5);
+    }
+
+    SUBCASE("registered") {
+        // the stored content is compressed, the versions hold the text
+        auto fs = std::make_shared<Filesystem>();
+        CHECK_EQ(fs->register_file("doc.txt", doc), true);
+        REQUIRE_NE(doc->get_content().get_codec(), Codec::none);
+        doc->update(FileContent{"replaced"});
+        CHECK_EQ(*doc->get_version(6)->get(), texts[5]);
+        CHECK_EQ(*doc->get_version(7)->get(), "replaced");
+        CHECK_EQ(fs->in_use(), 8);
+    }
+}
+
+
+TEST_CASE("Memory_budget") {
+    // random pixels, which don't compress
+    std::mt19937 gen{7};
+    const auto pixels = [&] {
+        std::string data(4096, '\0');
+        for (auto &c : data) {
+            c = static_cast<char>(gen());
+        }
+        return data;
+    };
+
+    auto fs = std::make_shared<Filesystem>();
+    CHECK_EQ(fs->get_eviction_stats().budget, 0);
+    std::vector<std::string> data;
+    std::vector<std::shared_ptr<Image>> images;
+    for (int i = 0; i < 2; ++i) {
+        data.push_back(pixels());
+        images.push_back(std::make_shared<Image>(FileContent{data.back()}, Image::resolution_t{32, 32}));
+        CHECK_EQ(fs->register_file("img" + std::to_string(i), images.back()), true);
+    }
+    fs->set_memory_budget(3 * 4096);
+
+    // used twice, img0 is frequent and survives the scan below
+    CHECK_NE(fs->get_file("img0"), nullptr);
+    CHECK_NE(fs->get_file("img0"), nullptr);
+    for (int i = 2; i < 10; ++i) {
+        data.push_back(pixels());
+        images.push_back(std::make_shared<Image>(FileContent{data.back()}, Image::resolution_t{32, 32}));
+        CHECK_EQ(fs->register_file("img" + std::to_string(i), images.back()), true);
+    }
+
+    // registering only records the contents, they move when applied
+    CHECK_EQ(fs->get_eviction_stats().resident, 10 * 4096);
+    CHECK_EQ(fs->get_eviction_stats().evictions, 0);
+    fs->apply_memory_budget();
+    auto stats = fs->get_eviction_stats();
+    CHECK_EQ(stats.budget, 3 * 4096);
+    CHECK_LE(stats.resident, 3 * 4096);
+    CHECK_EQ(stats.evictions, 7);
+    CHECK_EQ(stats.hits, 2);
+    CHECK_EQ(stats.failures, 0);
+    // the logical size doesn't change
+    CHECK_EQ(fs->in_use(), 10 * 4096);
+
+    // spilled contents stay readable where they are
+    for (size_t i = 0; i < images.size(); ++i) {
+        CHECK_EQ(*images[i]->get_content().get(), data[i]);
+    }
+
+    CHECK_EQ(fs->get_file("img0"), images[0]);
+    CHECK_EQ(fs->get_eviction_stats().hits, 3);
+
+    // looking up a spilled file brings it back once applied
+    CHECK_EQ(fs->get_file("img1"), images[1]);
+    CHECK_EQ(fs->get_eviction_stats().misses, 1);
+    CHECK_EQ(*images[1]->get_content().get(), data[1]);
+    fs->apply_memory_budget();
+    stats = fs->get_eviction_stats();
+    CHECK_EQ(stats.evictions, 8);
+    CHECK_LE(stats.resident, 3 * 4096);
+    CHECK_EQ(*images[1]->get_content().get(), data[1]);
+    CHECK_EQ(fs->get_file("img1"), images[1]);
+    CHECK_EQ(fs->get_eviction_stats().hits, 4);
+
+    // a smaller budget spills more, removing and updating files still works
+    fs->set_memory_budget(4096);
+    CHECK_LE(fs->get_eviction_stats().resident, 4096);
+    CHECK_EQ(fs->remove_file("img5"), true);
+    images[6]->update(FileContent{"small"}, {1, 1});
+    CHECK_EQ(fs->in_use(), 8 * 4096 + 5);
+    CHECK_EQ(*fs->get_file("img6")->get_content().get(), "small");
+    CHECK_EQ(*fs->get_file("img7")->get_content().get(), data[7]);
+    fs->apply_memory_budget();
+    CHECK_LE(fs->get_eviction_stats().resident, 4096);
+
+    SUBCASE("shared contents count once") {
+        auto shared = std::make_shared<Filesystem>();
+        const std::string bytes = pixels();
+        auto a = std::make_shared<Image>(FileContent{bytes}, Image::resolution_t{32, 32});
+        auto b = std::make_shared<Image>(FileContent{bytes}, Image::resolution_t{32, 32});
+        auto c = std::make_shared<Image>(FileContent{pixels()}, Image::resolution_t{32, 32});
+        CHECK_EQ(shared->register_file("a", a), true);
+        CHECK_EQ(shared->register_file("b", b), true);
+        CHECK_EQ(shared->register_file("c", c), true);
+        shared->set_memory_budget(2 * 4096);
+        CHECK_EQ(shared->get_eviction_stats().resident, 2 * 4096);
+        CHECK_EQ(shared->get_eviction_stats().evictions, 0);
+
+        // a hot file keeps the content in memory for the cold one sharing it
+        CHECK_NE(shared->get_file("a"), nullptr);
+        shared->set_memory_budget(4096);
+        CHECK_EQ(shared->get_eviction_stats().evictions, 1);
+        CHECK_EQ(c->get_content().get_size(), 4096);
+        CHECK_EQ(a->get_content().stored().data(), b->get_content().stored().data());
+        CHECK_EQ(shared->usage().physical, 2 * 4096);
+
+        // both files move to one copy on disk
+        CHECK_NE(shared->get_file("c"), nullptr);
+        CHECK_NE(shared->get_file("c"), nullptr);
+        shared->apply_memory_budget();
+        CHECK_EQ(shared->get_eviction_stats().evictions, 2);
+        CHECK_EQ(shared->get_eviction_stats().resident, 4096);
+        CHECK_EQ(a->get_content().stored().data(), b->get_content().stored().data());
+        CHECK_EQ(*b->get_content().get(), bytes);
+        CHECK_EQ(shared->usage().physical, 2 * 4096);
+
+        // removing one holder keeps the other one tracked
+        CHECK_EQ(shared->remove_file("a"), true);
+        CHECK_NE(shared->get_file("b"), nullptr);
+        shared->apply_memory_budget();
+        CHECK_EQ(*b->get_content().get(), bytes);
+        CHECK_EQ(shared->get_eviction_stats().misses, 2);
+        CHECK_EQ(shared->get_eviction_stats().resident, 4096);
+    }
+
+    SUBCASE("lookups don't move contents") {
+        auto shared = std::make_shared<Filesystem>(4);
+        shared->set_memory_budget(2 * 4096);
+        std::vector<std::string> bytes;
+        std::vector<std::shared_ptr<Image>> files;
+        for (int i = 0; i < 8; ++i) {
+            bytes.push_back(pixels());
+            files.push_back(std::make_shared<Image>(FileContent{bytes.back()}, Image::resolution_t{32, 32}));
+            CHECK_EQ(shared->register_file("img" + std::to_string(i), files.back()), true);
+        }
+        shared->apply_memory_budget();
+
+        // the handles are read while other threads look up the files
+        std::atomic<size_t> wrong{0};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < 4; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t round = 0; round < 200; ++round) {
+                    const size_t i = (t + round) % files.size();
+                    const bool right = t % 2 == 0
+                        ? shared->get_file("img" + std::to_string(i)) == files[i]
+                        : *files[i]->get_content().get() == bytes[i];
+                    wrong += !right;
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        CHECK_EQ(wrong.load(), 0);
+        CHECK_GT(shared->get_eviction_stats().misses, 0);
+        shared->apply_memory_budget();
+        CHECK_LE(shared->get_eviction_stats().resident, 2 * 4096);
+        for (size_t i = 0; i < files.size(); ++i) {
+            CHECK_EQ(*files[i]->get_content().get(), bytes[i]);
+        }
+    }
+}
+
+
+TEST_CASE("Concurrent_filesystem") {
+    auto fs = std::make_shared<Filesystem>(16);
+    const size_t threads = 4;
+    const size_t per_thread = 500;
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t i = 0; i < per_thread; ++i) {
+                auto name = std::to_string(t) + "_" + std::to_string(i);
+                fs->register_file(name, std::make_shared<Document>(FileContent{"shared text"}));
+                // readers race with the writers of the other threads
+                fs->get_file(std::to_string((t + 1) % threads) + "_" + std::to_string(i));
+                if (i % 2 == 0) {
+                    fs->rename_file(name, "renamed_" + name);
+                }
+                if (i % 5 == 0) {
+                    fs->remove_file(i % 2 == 0 ? "renamed_" + name : name);
+                }
+            }
+        });
+    }
+    for (auto&& worker : workers) {
+        worker.join();
+    }
+
+    // every thread keeps the files with i % 5 != 0
+    const size_t expected = threads * (per_thread - per_thread / 5);
+    CHECK_EQ(fs->get_file_count(), expected);
+    CHECK_EQ(fs->in_use(), expected * 11);
+    CHECK_EQ(fs->usage().physical, 11);
+    CHECK_EQ(fs->get_file("renamed_2_2")->get_name(), "renamed_2_2");
+    CHECK_EQ(fs->get_file("2_2"), nullptr);
+    CHECK_EQ(fs->get_file("3_1")->get_name(), "3_1");
+    CHECK_EQ(fs->files_in_size_range(11, 11).size(), expected);
+}
+
+
+TEST_CASE("Slab_pool") {
+    SUBCASE("reuse") {
+        SlabPool pool{24, 8};
+        void* a = pool.allocate();
+        void* b = pool.allocate();
+        CHECK_NE(a, b);
+        CHECK_EQ(pool.get_stats().slots_in_use, 2);
+        CHECK_EQ(pool.get_stats().bytes_reserved, SlabPool::block_size / 24 * 24);
+
+        // freed slots are handed out again
+        pool.deallocate(a);
+        CHECK_EQ(pool.allocate(), a);
+        pool.deallocate(a);
+        pool.deallocate(b);
+        CHECK_EQ(pool.get_stats().slots_in_use, 0);
+    }
+
+    SUBCASE("make_file") {
+        // the content store only drops its entries of freed contents lazily,
+        // they keep the reference counts of the contents allocated until then
+        ContentStore::instance().size();
+        auto before = SlabPool::get_total_stats().slots_in_use;
+        {
+            auto fs = std::make_shared<Filesystem>();
+            auto doc = make_file<Document>(FileContent{"pooled text"});
+            auto vid = make_file<Video>("pooled video", Video::resolution_t{2, 2}, 1.0);
+            // file and content both come from pools
+            CHECK_EQ(SlabPool::get_total_stats().slots_in_use, before + 4);
+
+            CHECK_EQ(fs->register_file("doc", doc), true);
+            CHECK_EQ(fs->register_file("vid", vid), true);
+            CHECK_EQ(fs->get_file("doc")->get_type(), "DOC");
+            CHECK_EQ(*fs->get_file("vid")->get_content().get(), "pooled video");
+            CHECK_EQ(fs->in_use(), 23);
+        }
+        ContentStore::instance().size();
+        CHECK_EQ(SlabPool::get_total_stats().slots_in_use, before);
+    }
+}
+
+
+TEST_CASE("Compression") {
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "line " + std::to_string(i % 17) + ": the quick brown fox\n";
+    }
+
+    SUBCASE("roundtrip") {
+        std::mt19937 gen{7};
+        std::string noise(3000, '\0');
+        for (auto& c : noise) {
+            c = static_cast<char>(gen());
+        }
+        std::vector<std::string> inputs{
+            "", "a", "abcabcabcabcabcabc", std::string(100000, 'x'),
+            text, noise, noise.substr(0, 500) + std::string(300, 'z') + noise.substr(0, 500)};
+        for (auto&& input : inputs) {
+            for (auto codec : {Codec::lz4, Codec::deflate}) {
+                if (!codec_available(codec)) {
+                    continue;
+                }
+                auto data = compress(input, codec);
+                if (data.empty()) {
+                    continue;
+                }
+                CHECK_LT(data.size(), input.size());
+                CHECK_EQ(decompress(data, codec, input.size()), input);
+            }
+        }
+        CHECK_EQ(compress(noise, Codec::lz4), "");
+        CHECK_EQ(compress(text, Codec::none), "");
+
+        auto data = compress(text, Codec::lz4);
+        data.resize(data.size() - 3);
+        CHECK_THROWS_AS(decompress(data, Codec::lz4, text.size()), std::runtime_error);
+    }
+
+    SUBCASE("filecontent") {
+        FileContent raw{text};
+        auto packed = raw.compressed(Codec::lz4);
+        CHECK_EQ(packed.get_codec(), Codec::lz4);
+        CHECK_LT(packed.get_size(), text.size());
+        CHECK_EQ(packed.get_raw_size(), text.size());
+        CHECK_EQ(*packed.get(), text);
+
+        // decompressed once, then served from the cache
+        auto hits = DecompressionCache::instance().get_stats().hits;
+        CHECK_EQ(packed.get(), packed.get());
+        CHECK_GT(DecompressionCache::instance().get_stats().hits, hits);
+
+        // small contents aren't compressed
+        FileContent small{"short"};
+        CHECK_EQ(small.compressed(Codec::lz4).get_codec(), Codec::none);
+        CHECK_EQ(small.compressed(Codec::lz4).get(), small.get());
+    }
+
+    SUBCASE("filesystem") {
+        auto fs = std::make_shared<Filesystem>();
+        auto doc = std::make_shared<Document>(FileContent{text});
+        auto img = std::make_shared<Image>(FileContent{text}, Image::resolution_t{10, 10});
+        CHECK_EQ(doc->get_size(), text.size());
+
+        CHECK_EQ(fs->register_file("a.txt", doc), true);
+        CHECK_EQ(fs->register_file("b.png", img), true);
+        CHECK_NE(doc->get_content().get_codec(), Codec::none);
+        CHECK_EQ(img->get_content().get_codec(), Codec::lz4);
+
+        // sizes are the compressed ones, the raw size stays
+        CHECK_LT(doc->get_size(), text.size());
+        CHECK_EQ(doc->get_raw_size(), text.size());
+        CHECK_EQ(fs->in_use(), doc->get_size() + img->get_size());
+        CHECK_EQ(*doc->get_content().get(), text);
+        CHECK_EQ(*img->get_content().get(), text);
+        CHECK_EQ(doc->get_character_count(), text.size() - 5 * 200 - 200);
+    }
+}
+
+
+TEST_CASE("Mapped_content") {
+    const auto path = (std::filesystem::temp_directory_path() / "hw07_test_mapped").string();
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        text += "mapped line " + std::to_string(i) + "\n";
+    }
+    {
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        out << text;
+    }
+
+    SUBCASE("region") {
+        auto content = map_file_content(path, 5000, 1000);
+        CHECK_EQ(content.get_size(), 1000);
+        CHECK_EQ(content.get_raw_size(), 1000);
+        CHECK_EQ(content.stored(), std::string_view{text}.substr(5000, 1000));
+        CHECK_EQ(*content.get(), text.substr(5000, 1000));
+
+        // up to the end of the file at most
+        CHECK_EQ(map_file_content(path, 100).get_size(), text.size() - 100);
+        CHECK_EQ(map_file_content(path, text.size() - 10, 1000).get_size(), 10);
+        CHECK_EQ(map_file_content(path, text.size()).get_size(), 0);
+        CHECK_THROWS_AS(map_file_content(path, text.size() + 1), std::runtime_error);
+        CHECK_THROWS_AS(map_file_content(path + ".missing"), std::runtime_error);
+    }
+
+    SUBCASE("chunks") {
+        auto content = map_file_content(path);
+        auto chunks = content.chunks(4096);
+        CHECK_EQ(chunks.size(), (text.size() + 4095) / 4096);
+        std::string joined;
+        for (std::string_view chunk : chunks) {
+            CHECK_LE(chunk.size(), 4096);
+            joined += chunk;
+        }
+        CHECK_EQ(joined, text);
+
+        // compressed content is streamed as well
+        auto compressed = FileContent{text}.compressed(Codec::lz4);
+        REQUIRE_EQ(compressed.get_codec(), Codec::lz4);
+        joined.clear();
+        for (std::string_view chunk : compressed.chunks(1000)) {
+            joined += chunk;
+        }
+        CHECK_EQ(joined, text);
+        CHECK_EQ(FileContent{}.chunks().size(), 0);
+        CHECK_EQ(FileContent{"abc"}.chunks(0).size(), 3);
+    }
+
+    SUBCASE("files") {
+        auto fs = std::make_shared<Filesystem>();
+        auto doc = std::make_shared<Document>(map_file_content(path));
+        auto vid = std::make_shared<Video>(map_file_content(path, 0, 4096),
+                                           Video::resolution_t{640, 480}, 2.5);
+        CHECK_EQ(fs->register_file("doc.txt", doc), true);
+        CHECK_EQ(fs->register_file("clip.mp4", vid), true);
+        CHECK_EQ(fs->in_use(), text.size() + 4096);
+        CHECK_EQ(doc->get_text_stats(), classify_text(text));
+        CHECK_EQ(doc->get_character_count(), text.size() - 2 * 2000 - 2000);
+
+        // the mapping stays with the content, even when the file is gone
+        auto content = doc->get_content();
+        std::filesystem::remove(path);
+        doc = nullptr;
+        CHECK_EQ(fs->remove_file("doc.txt"), true);
+        CHECK_EQ(*content.get(), text);
+    }
+
+    std::filesystem::remove(path);
+}
+
+
+TEST_CASE("Snapshot") {
+    const std::string path = (std::filesystem::temp_directory_path() / "hw07_test.snapshot").string();
+
+    std::string text;
+    for (int i = 0; i < 100; ++i) {
+        text += "snapshot line " + std::to_string(i) + "\n";
+    }
+
+    auto fs = std::make_shared<Filesystem>();
+    auto doc = std::make_shared<Document>(FileContent{text});
+    auto copy = std::make_shared<Document>(FileContent{text});
+    auto small = std::make_shared<Document>(FileContent{"tiny"});
+    auto img = std::make_shared<Image>(FileContent{"pixels"}, Image::resolution_t{640, 480});
+    auto aud = std::make_shared<Audio>(FileContent{"samples"}, 42);
+    auto vid = std::make_shared<Video>(FileContent{"frames"}, Video::resolution_t{1920, 1080}, 2.5);
+    CHECK_EQ(fs->register_file("a.txt", doc), true);
+    CHECK_EQ(fs->register_file("copy.txt", copy), true);
+    CHECK_EQ(fs->register_file("small.txt", small), true);
+    CHECK_EQ(fs->register_file("b.png", img), true);
+    CHECK_EQ(fs->register_file("c.wav", aud), true);
+    CHECK_EQ(fs->register_file("d.mp4", vid), true);
+
+    save_snapshot(*fs, path);
+
+    SUBCASE("save_during_updates") {
+        // each saved video has the content and the metadata of one update
+        std::thread updater{[&] {
+            for (size_t i = 1; i <= 300; ++i) {
+                vid->update(FileContent{std::string(i, 'f')}, Video::resolution_t{i, i}, 1.0);
+            }
+        }};
+        std::vector<std::pair<size_t, size_t>> saved;
+        for (int round = 0; round < 5; ++round) {
+            save_snapshot(*fs, path);
+            auto loaded = std::dynamic_pointer_cast<Video>(load_snapshot(path)->get_file("d.mp4"));
+            REQUIRE_NE(loaded, nullptr);
+            saved.emplace_back(loaded->get_content().get()->size(), loaded->get_resolution()[0]);
+        }
+        updater.join();
+        for (auto &&[size, width] : saved) {
+            if (width != 1920) {
+                CHECK_EQ(size, width);
+            }
+        }
+    }
+
+    SUBCASE("load") {
+        auto loaded = load_snapshot(path, 4);
+        CHECK_EQ(loaded->get_file_count(), 6);
+        CHECK_EQ(loaded->in_use(), fs->in_use());
+        CHECK_EQ(loaded->usage().physical, fs->usage().physical);
+
+        for (auto name : {"a.txt", "copy.txt", "small.txt", "b.png", "c.wav", "d.mp4"}) {
+            auto before = fs->get_file(name);
+            auto after = loaded->get_file(name);
+            REQUIRE_NE(after, nullptr);
+            CHECK_EQ(after->get_name(), name);
+            CHECK_EQ(after->get_type(), before->get_type());
+            CHECK_EQ(after->get_size(), before->get_size());
+            CHECK_EQ(after->get_raw_size(), before->get_raw_size());
+            CHECK_EQ(after->get_content().get_codec(), before->get_content().get_codec());
+            CHECK_EQ(*after->get_content().get(), *before->get_content().get());
+            // the content points into the mapped snapshot
+            CHECK_EQ(after->get_content().string_, nullptr);
+        }
+
+        // shared content is stored once
+        CHECK_EQ(loaded->get_file("a.txt")->get_content().stored().data(),
+                 loaded->get_file("copy.txt")->get_content().stored().data());
+
+        auto img2 = std::dynamic_pointer_cast<Image>(loaded->get_file("b.png"));
+        REQUIRE_NE(img2, nullptr);
+        CHECK_EQ(img2->get_resolution(), Image::resolution_t{640, 480});
+        auto aud2 = std::dynamic_pointer_cast<Audio>(loaded->get_file("c.wav"));
+        REQUIRE_NE(aud2, nullptr);
+        CHECK_EQ(aud2->get_duration(), 42);
+        auto vid2 = std::dynamic_pointer_cast<Video>(loaded->get_file("d.mp4"));
+        REQUIRE_NE(vid2, nullptr);
+        CHECK_EQ(vid2->get_resolution(), Video::resolution_t{1920, 1080});
+        CHECK_EQ(vid2->get_duration(), 2.5);
+
+        // loaded files behave like any other
+        auto doc2 = std::dynamic_pointer_cast<Document>(loaded->get_file("a.txt"));
+        REQUIRE_NE(doc2, nullptr);
+        CHECK_EQ(doc2->get_character_count(), doc->get_character_count());
+        doc2->update(FileContent{"new text"});
+        CHECK_EQ(*doc2->get_content().get(), "new text");
+        CHECK_EQ(*loaded->get_file("copy.txt")->get_content().get(), text);
+        CHECK_EQ(doc2->rename("e.txt"), true);
+        CHECK_EQ(loaded->get_file("e.txt"), doc2);
+
+        // the mapping lives as long as a content pointing into it
+        auto kept = loaded->get_file("copy.txt");
+        loaded.reset();
+        CHECK_EQ(*kept->get_content().get(), text);
+    }
+
+    SUBCASE("save_loaded") {
+        // contents stay in the mapping when saving again
+        auto loaded = load_snapshot(path);
+        const std::string path2 = path + "2";
+        save_snapshot(*loaded, path2);
+        auto again = load_snapshot(path2);
+        CHECK_EQ(again->get_file_count(), 6);
+        CHECK_EQ(*again->get_file("a.txt")->get_content().get(), text);
+        std::filesystem::remove(path2);
+    }
+
+    SUBCASE("corrupt") {
+        CHECK_THROWS_AS(load_snapshot(path + ".missing"), std::runtime_error);
+
+        // truncated
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        CHECK_THROWS_AS(load_snapshot(path), std::runtime_error);
+
+        // not a snapshot
+        std::ofstream{path, std::ios::trunc} << "some text, but not a snapshot of a filesystem at all."
+                                                "it must be longer than the header though.";
+        CHECK_THROWS_AS(load_snapshot(path), std::runtime_error);
+
+        std::ofstream{path, std::ios::trunc};
+        CHECK_THROWS_AS(load_snapshot(path), std::runtime_error);
+    }
+
+    std::filesystem::remove(path);
+}
+
+
+TEST_CASE("Write_ahead_log") {
+    const auto directory = std::filesystem::temp_directory_path() / "hw07_test_wal";
+    std::filesystem::remove_all(directory);
+
+    WriteAheadLog::Options options;
+    options.durability = WriteAheadLog::Durability::sync;
+
+    std::string text;
+    for (int i = 0; i < 50; ++i) {
+        text += "logged line " + std::to_string(i) + "\n";
+    }
+
+    const auto segments = [&] {
+        size_t count = 0;
+        for (auto &&entry : std::filesystem::directory_iterator{directory}) {
+            count += entry.path().filename().string().starts_with("wal.");
+        }
+        return count;
+    };
+
+    {
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        REQUIRE_NE(fs->get_log(), nullptr);
+        CHECK_EQ(fs->get_file_count(), 0);
+
+        auto doc = std::make_shared<Document>(FileContent{"first"});
+        auto img = std::make_shared<Image>(FileContent{"pixels"}, Image::resolution_t{2, 3});
+        auto aud = std::make_shared<Audio>(FileContent{"samples"}, 7);
+        auto vid = std::make_shared<Video>(FileContent{"frames"}, Video::resolution_t{4, 5}, 1.5);
+        CHECK_EQ(fs->register_file("a.txt", doc), true);
+        CHECK_EQ(fs->register_file("b.png", img), true);
+        CHECK_EQ(fs->register_file("c.wav", aud), true);
+        CHECK_EQ(fs->register_file("d.mp4", vid), true);
+        CHECK_EQ(fs->register_file("a.txt", vid), false);
+
+        doc->update(FileContent{text});
+        img->update(FileContent{"more pixels"}, Image::resolution_t{8, 9});
+        CHECK_EQ(doc->rename("e.txt"), true);
+        CHECK_EQ(fs->rename_file("c.wav", "f.wav"), true);
+        CHECK_EQ(fs->remove_file("d.mp4"), true);
+        CHECK_EQ(fs->remove_file("d.mp4"), false);
+
+        // only successful changes are logged, and all are fsynced already
+        auto stats = fs->get_log()->get_stats();
+        CHECK_EQ(stats.logged, 9);
+        CHECK_EQ(stats.synced, 9);
+        CHECK_EQ(stats.failed, false);
+    }
+
+    SUBCASE("recover") {
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 3);
+        CHECK_EQ(fs->get_file("a.txt"), nullptr);
+        CHECK_EQ(fs->get_file("d.mp4"), nullptr);
+
+        auto doc = std::dynamic_pointer_cast<Document>(fs->get_file("e.txt"));
+        REQUIRE_NE(doc, nullptr);
+        CHECK_EQ(*doc->get_content().get(), text);
+        CHECK_EQ(doc->get_raw_size(), text.size());
+        auto img = std::dynamic_pointer_cast<Image>(fs->get_file("b.png"));
+        REQUIRE_NE(img, nullptr);
+        CHECK_EQ(*img->get_content().get(), "more pixels");
+        CHECK_EQ(img->get_resolution(), Image::resolution_t{8, 9});
+        auto aud = std::dynamic_pointer_cast<Audio>(fs->get_file("f.wav"));
+        REQUIRE_NE(aud, nullptr);
+        CHECK_EQ(aud->get_duration(), 7);
+
+        // logging continues after the recovered changes
+        CHECK_EQ(fs->remove_file("f.wav"), true);
+        CHECK_EQ(fs->rename_file("e.txt", "docs/e.txt"), true);
+        CHECK_EQ(fs->rename_dir("docs", "texts"), true);
+        CHECK_EQ(fs->get_log()->get_stats().logged, 12);
+        fs = nullptr;
+        fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 2);
+        CHECK_NE(fs->get_file("texts/e.txt"), nullptr);
+        CHECK_EQ(fs->get_dir_stats("texts").bytes, fs->get_file("texts/e.txt")->get_size());
+    }
+
+    SUBCASE("compact") {
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        fs->get_log()->compact();
+        CHECK_EQ(std::filesystem::exists(directory / "snapshot.9"), true);
+        // the old segments are in the snapshot
+        CHECK_EQ(segments(), 1);
+        CHECK_EQ(fs->rename_file("e.txt", "g.txt"), true);
+        fs = nullptr;
+
+        fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 3);
+        REQUIRE_NE(fs->get_file("g.txt"), nullptr);
+        CHECK_EQ(*fs->get_file("g.txt")->get_content().get(), text);
+        CHECK_EQ(fs->get_log()->get_stats().logged, 10);
+    }
+
+    SUBCASE("background_compaction") {
+        options.durability = WriteAheadLog::Durability::group;
+        options.compact_bytes = 1;
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        for (int i = 0; i < 100; ++i) {
+            fs->register_file("file" + std::to_string(i), std::make_shared<Document>(FileContent{text}));
+            if (i % 10 == 0) {
+                fs->get_log()->sync();
+            }
+        }
+        fs = nullptr;
+
+        fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 103);
+        CHECK_EQ(*fs->get_file("file99")->get_content().get(), text);
+    }
+
+    SUBCASE("compaction_during_updates") {
+        // the background compactions copy the files while they're updated
+        options.durability = WriteAheadLog::Durability::group;
+        options.compact_bytes = 1;
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        auto img = std::dynamic_pointer_cast<Image>(fs->get_file("b.png"));
+        REQUIRE_NE(img, nullptr);
+        for (size_t i = 1; i <= 200; ++i) {
+            img->update(FileContent{std::string(i, 'p')}, Image::resolution_t{i, i});
+            if (i % 20 == 0) {
+                fs->get_log()->compact();
+            }
+        }
+        fs->get_log()->sync();
+        fs = nullptr;
+
+        fs = WriteAheadLog::open(directory.string(), options);
+        img = std::dynamic_pointer_cast<Image>(fs->get_file("b.png"));
+        REQUIRE_NE(img, nullptr);
+        CHECK_EQ(*img->get_content().get(), std::string(200, 'p'));
+        CHECK_EQ(img->get_resolution(), Image::resolution_t{200, 200});
+    }
+
+    SUBCASE("held_log") {
+        // the log's threads stop with the filesystem, even if it's still held
+        options.compact_bytes = 1;
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        auto log = fs->get_log();
+        CHECK_EQ(fs->register_file("h.txt", std::make_shared<Document>(FileContent{text})), true);
+        fs = nullptr;
+        log->sync();
+        CHECK_THROWS_AS(log->compact(), std::runtime_error);
+        CHECK_EQ(log->get_stats().failed, false);
+        log = nullptr;
+
+        fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 4);
+        CHECK_NE(fs->get_file("h.txt"), nullptr);
+    }
+
+    SUBCASE("write_failure") {
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        std::uintmax_t largest = 0;
+        for (auto &&entry : std::filesystem::directory_iterator{directory}) {
+            largest = std::max(largest, entry.file_size());
+        }
+        std::mt19937 gen{3};
+        std::string noise(1 << 16, '\0');
+        for (auto &c : noise) {
+            c = static_cast<char>(gen());
+        }
+
+        // the record doesn't fit under the file size limit
+        rlimit old_limit;
+        REQUIRE_EQ(getrlimit(RLIMIT_FSIZE, &old_limit), 0);
+        const auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit limit = old_limit;
+        limit.rlim_cur = static_cast<rlim_t>(largest + 1024);
+        REQUIRE_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+        CHECK_THROWS_AS(fs->register_file("noise.bin", std::make_shared<Document>(FileContent{noise})),
+                        std::runtime_error);
+        setrlimit(RLIMIT_FSIZE, &old_limit);
+        std::signal(SIGXFSZ, old_handler);
+
+        // nothing is written after the gap, and changes fail
+        CHECK_EQ(fs->get_log()->get_stats().failed, true);
+        CHECK_THROWS_AS(fs->remove_file("b.png"), std::runtime_error);
+        CHECK_THROWS_AS(fs->get_log()->sync(), std::runtime_error);
+        CHECK_NE(fs->get_file("b.png"), nullptr);
+        fs = nullptr;
+
+        // the torn record is dropped
+        fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 3);
+        CHECK_EQ(fs->get_file("noise.bin"), nullptr);
+        CHECK_EQ(fs->get_log()->get_stats().failed, false);
+    }
+
+    SUBCASE("rotation_failure") {
+        // the records wait in memory until the compaction rotates the segment
+        options.durability = WriteAheadLog::Durability::buffered;
+        options.commit_interval = std::chrono::hours{1};
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        std::uintmax_t largest = 0;
+        for (auto &&entry : std::filesystem::directory_iterator{directory}) {
+            largest = std::max(largest, entry.file_size());
+        }
+        std::mt19937 gen{5};
+        std::string noise(1 << 16, '\0');
+        for (auto &c : noise) {
+            c = static_cast<char>(gen());
+        }
+        CHECK_EQ(fs->register_file("noise.bin", std::make_shared<Document>(FileContent{noise})), true);
+
+        // writing the old segment fails, so no new one is started
+        rlimit old_limit;
+        REQUIRE_EQ(getrlimit(RLIMIT_FSIZE, &old_limit), 0);
+        const auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        rlimit limit = old_limit;
+        limit.rlim_cur = static_cast<rlim_t>(largest + 1024);
+        REQUIRE_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+        CHECK_THROWS_AS(fs->get_log()->compact(), std::runtime_error);
+        setrlimit(RLIMIT_FSIZE, &old_limit);
+        std::signal(SIGXFSZ, old_handler);
+
+        CHECK_EQ(fs->get_log()->get_stats().failed, true);
+        CHECK_EQ(std::filesystem::exists(directory / "wal.11"), false);
+        CHECK_EQ(std::filesystem::exists(directory / "snapshot.10"), false);
+        fs = nullptr;
+
+        // the torn record is at the end of the last segment, and dropped
+        fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 3);
+        CHECK_EQ(fs->get_file("noise.bin"), nullptr);
+    }
+
+    SUBCASE("torn_record") {
+        // a crash while writing leaves part of a record
+        auto segment = directory / ("wal." + std::to_string(1));
+        REQUIRE(std::filesystem::exists(segment));
+        const auto size = std::filesystem::file_size(segment);
+        std::ofstream{segment, std::ios::app | std::ios::binary} << std::string(40, 'x');
+
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 3);
+        CHECK_EQ(std::filesystem::file_size(segment), size);
+
+        // a torn record followed by more segments is corruption
+        fs = nullptr;
+        std::ofstream{segment, std::ios::app | std::ios::binary} << std::string(40, 'x');
+        CHECK_THROWS_AS(WriteAheadLog::open(directory.string(), options), std::runtime_error);
+    }
+
+    SUBCASE("concurrent") {
+        auto fs = WriteAheadLog::open(directory.string(), options);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 50; ++i) {
+                    const auto name = "t" + std::to_string(t) + "_" + std::to_string(i);
+                    fs->register_file(name, std::make_shared<Document>(FileContent{name}));
+                    if (i % 2 == 0) {
+                        fs->rename_file(name, name + ".old");
+                    }
+                }
+            });
+        }
+        for (auto &&thread : threads) {
+            thread.join();
+        }
+        auto stats = fs->get_log()->get_stats();
+        CHECK_EQ(stats.synced, stats.logged);
+        fs = nullptr;
+
+        fs = WriteAheadLog::open(directory.string(), options);
+        CHECK_EQ(fs->get_file_count(), 203);
+        CHECK_NE(fs->get_file("t3_48.old"), nullptr);
+        CHECK_NE(fs->get_file("t3_49"), nullptr);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+
+TEST_CASE("Text_stats") {
+    SUBCASE("classify") {
+        CHECK_EQ(classify_text(""), TextStats{0, 0, 0, 0});
+        CHECK_EQ(classify_text("hello world\n"), TextStats{12, 2, 1, 2});
+        CHECK_EQ(classify_text("  a\tb  \n\nc"), TextStats{10, 7, 3, 3});
+        CHECK_EQ(classify_text("word"), TextStats{4, 0, 1, 1});
+
+        // words spanning the vector blocks are counted once
+        std::string text = std::string(31, 'x') + " " + std::string(40, 'y') + "\n";
+        CHECK_EQ(classify_text(text), TextStats{73, 2, 1, 2});
+
+        // the vector versions match the plain one
+        std::mt19937 gen{45};
+        const std::string alphabet = "ab \n\t.";
+        for (size_t length = 0; length < 300; ++length) {
+            std::string random(length, ' ');
+            for (auto &c : random) {
+                c = alphabet[gen() % alphabet.size()];
+            }
+            CHECK_EQ(classify_text(random), classify_text_scalar(random));
+        }
+    }
+
+    SUBCASE("document") {
+        std::string text;
+        for (int i = 0; i < 100; ++i) {
+            text += "word" + std::to_string(i) + " and\tmore\n";
+        }
+        auto doc = std::make_shared<Document>(FileContent{text});
+        const TextStats stats = doc->get_text_stats();
+        CHECK_EQ(stats, classify_text_scalar(text));
+        CHECK_EQ(stats.lines, 100);
+        CHECK_EQ(stats.words, 300);
+        CHECK_EQ(doc->get_character_count(), stats.bytes - stats.whitespace);
+
+        // the stats are cached, and stay when the content is compressed
+        auto fs = std::make_shared<Filesystem>();
+        CHECK_EQ(fs->register_file("a.txt", doc), true);
+        CHECK_NE(doc->get_content().get_codec(), Codec::none);
+        const auto misses = DecompressionCache::instance().get_stats().misses;
+        CHECK_EQ(doc->get_text_stats(), stats);
+        CHECK_EQ(DecompressionCache::instance().get_stats().misses, misses);
+
+        doc->update(FileContent{"new text"});
+        CHECK_EQ(doc->get_text_stats(), TextStats{8, 1, 1, 2});
+        CHECK_EQ(doc->get_character_count(), 7);
+    }
+}